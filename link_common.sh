@@ -62,6 +62,16 @@ ln -s ../../src/common/connector.cpp src/$DESTDIR/connector.cpp
 rm -f src/$DESTDIR/connector.h
 ln -s ../../src/common/connector.h src/$DESTDIR/connector.h
 
+rm -f src/$DESTDIR/dspkernels.cpp
+ln -s ../../src/common/dspkernels.cpp src/$DESTDIR/dspkernels.cpp
+rm -f src/$DESTDIR/dspkernels.h
+ln -s ../../src/common/dspkernels.h src/$DESTDIR/dspkernels.h
+
+rm -f src/$DESTDIR/encodedpacket.cpp
+ln -s ../../src/common/encodedpacket.cpp src/$DESTDIR/encodedpacket.cpp
+rm -f src/$DESTDIR/encodedpacket.h
+ln -s ../../src/common/encodedpacket.h src/$DESTDIR/encodedpacket.h
+
 rm -f src/$DESTDIR/guiapplication.cpp
 ln -s ../../src/common/guiapplication.cpp src/$DESTDIR/guiapplication.cpp
 rm -f src/$DESTDIR/guiapplication.h
@@ -24,18 +24,18 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <samplerate.h>
-
 #include "audiodevice.h"
+#include "dspkernels.h"
 #include "logging.h"
 
 AudioDevice::AudioDevice(unsigned chans,unsigned samprate,
-			 Ringbuffer *ring,QObject *parent)
+			 BroadcastRingbuffer *ring,QObject *parent)
   : QObject(parent)
 {
   audio_ring=ring;
   audio_channels=chans;
   audio_samplerate=samprate;
+  audio_latency_target=0;
 }
 
 
@@ -50,12 +50,86 @@ bool AudioDevice::isAvailable() const
 }
 
 
+bool AudioDevice::isOffline() const
+{
+  return false;
+}
+
+
+Ringbuffer::Layout AudioDevice::nativeLayout() const
+{
+  //
+  // The layout in which the device delivers audio.  Planar devices
+  // should write with writeRingBufferPlanar().
+  //
+  return Ringbuffer::Interleaved;
+}
+
+
 unsigned AudioDevice::deviceSamplerate() const
 {
   return audio_samplerate;
 }
 
 
+unsigned AudioDevice::latencyTarget() const
+{
+  return audio_latency_target;
+}
+
+
+void AudioDevice::setLatencyTarget(unsigned msecs)
+{
+  audio_latency_target=msecs;
+}
+
+
+unsigned AudioDevice::capturePeriodSize() const
+{
+  return captureBufferSize()/LATENCY_CAPTURE_PERIODS;
+}
+
+
+unsigned AudioDevice::captureBufferSize() const
+{
+  //
+  // Half of the latency budget goes to the capture device, divided into
+  // LATENCY_CAPTURE_PERIODS periods.  This is in frames at the rate the
+  // device actually runs at, so devices that negotiate their rate must
+  // not call it until they have done so.  Zero means no target was set.
+  //
+  uint64_t frames;
+
+  if(audio_latency_target==0) {
+    return 0;
+  }
+  frames=(uint64_t)deviceSamplerate()*audio_latency_target/2000;
+  if(frames<(LATENCY_MIN_CAPTURE_PERIOD*LATENCY_CAPTURE_PERIODS)) {
+    frames=LATENCY_MIN_CAPTURE_PERIOD*LATENCY_CAPTURE_PERIODS;
+  }
+  return frames;
+}
+
+
+unsigned AudioDevice::ringbufferSize() const
+{
+  //
+  // The capture ringbuffer gets the whole latency budget, in bytes at
+  // the rate the device actually runs at (see captureBufferSize()).
+  //
+  uint64_t frames;
+
+  if(audio_latency_target==0) {
+    return RINGBUFFER_SIZE;
+  }
+  frames=(uint64_t)deviceSamplerate()*audio_latency_target/1000;
+  if(frames<LATENCY_MIN_RINGBUFFER_FRAMES) {
+    frames=LATENCY_MIN_RINGBUFFER_FRAMES;
+  }
+  return frames*audio_channels*sizeof(float);
+}
+
+
 void AudioDevice::meterLevels(int *lvls) const
 {
   for(unsigned i=0;i<MAX_AUDIO_CHANNELS;i++) {
@@ -196,12 +270,38 @@ void AudioDevice::updateMeterLevels(int *lvls)
   }
 }
 
-Ringbuffer *AudioDevice::ringBuffer()
+BroadcastRingbuffer *AudioDevice::ringBuffer()
 {
   return audio_ring;
 }
 
 
+void AudioDevice::allocateRingBuffer()
+{
+  //
+  // Devices call this from start(), once the sample rate is settled and
+  // before the first block is written
+  //
+  audio_ring->setSize(ringbufferSize());
+}
+
+
+void AudioDevice::writeRingBuffer(float *pcm,unsigned nframes)
+{
+  //
+  // Written once, read independently by each codec
+  //
+  audio_ring->write(pcm,nframes);
+}
+
+
+void AudioDevice::writeRingBufferPlanar(const float *const *pcm,
+					unsigned nframes)
+{
+  audio_ring->writePlanar(pcm,nframes);
+}
+
+
 unsigned AudioDevice::channels() const
 {
   return audio_channels;
@@ -222,16 +322,11 @@ void AudioDevice::remixChannels(float *pcm_out,unsigned chans_out,float *pcm_in,
     return;
   }
   if((chans_in==1)&&(chans_out==2)) {
-    for(unsigned i=0;i<nframes;i++) {
-      pcm_out[2*i]=pcm_in[i];
-      pcm_out[2*i+1]=pcm_in[i];
-    }
+    DspKernels::monoToStereo(pcm_out,pcm_in,nframes);
     return;
   }
   if((chans_in==2)&&(chans_out==1)) {
-    for(unsigned i=0;i<nframes;i++) {
-      pcm_out[i]=(pcm_in[2*i]+pcm_in[2*i+1])/2.0;
-    }
+    DspKernels::stereoToMono(pcm_out,pcm_in,nframes);
     return;
   }
   Log(LOG_ERR,
@@ -249,12 +344,11 @@ void AudioDevice::convertToFloat(float *pcm_out,const void *pcm_in,
     break;
 
   case AudioDevice::S16_LE:
-    src_short_to_float_array((const short *)pcm_in,pcm_out,nframes*chans);
+    DspKernels::s16ToFloat(pcm_out,(const int16_t *)pcm_in,nframes*chans);
     break;
 
   case AudioDevice::S32_LE:
-    src_int_to_float_array((const int *)pcm_in,pcm_out,nframes*chans);
-
+    DspKernels::s32ToFloat(pcm_out,(const int32_t *)pcm_in,nframes*chans);
     break;
 
   case AudioDevice::LastFormat:
@@ -266,16 +360,15 @@ void AudioDevice::convertToFloat(float *pcm_out,const void *pcm_in,
 void AudioDevice::peakLevels(float *lvls,const float *pcm,unsigned nframes,
 			     unsigned chans)
 {
-  for(unsigned i=0;i<chans;i++) {
-    lvls[i]=0.0;
-  }
+  DspKernels::absPeaks(lvls,pcm,nframes,chans);
+}
 
-  for(unsigned i=0;i<nframes;i+=chans) {
-    for(unsigned j=0;j<chans;j++) {
-      if(pcm[i+j]>lvls[j]) {
-	lvls[j]=pcm[i+j];
-      }
-    }
+
+void AudioDevice::peakLevelsPlanar(float *lvls,const float *const *pcm,
+				   unsigned nframes,unsigned chans)
+{
+  for(unsigned i=0;i<chans;i++) {
+    DspKernels::absPeaks(lvls+i,pcm[i],nframes,1);
   }
 }
 
@@ -38,13 +38,20 @@ class AudioDevice : public QObject
   enum DeviceType {Alsa=0,AsiHpi=1,File=2,Jack=3,LastType=4};
   enum Format {FLOAT=0,S16_LE=1,S32_LE=2,LastFormat=3};
   AudioDevice(unsigned chans,unsigned samprate,
-	      Ringbuffer *ring,QObject *parent=0);
+	      BroadcastRingbuffer *ring,QObject *parent=0);
   ~AudioDevice();
   virtual bool isAvailable() const;
+  virtual bool isOffline() const;
+  virtual Ringbuffer::Layout nativeLayout() const;
   virtual bool processOptions(QString *err,const QStringList &keys,
 			      const QStringList &values)=0;
   virtual bool start(QString *err)=0;
   virtual unsigned deviceSamplerate() const;
+  unsigned latencyTarget() const;
+  void setLatencyTarget(unsigned msecs);
+  unsigned capturePeriodSize() const;
+  unsigned captureBufferSize() const;
+  unsigned ringbufferSize() const;
   void meterLevels(int *lvls) const;
   static QString deviceTypeText(AudioDevice::DeviceType type);
   static QString optionKeyword(AudioDevice::DeviceType type);
@@ -61,7 +68,10 @@ class AudioDevice : public QObject
   void setMeterLevels(float *lvls);
   void setMeterLevels(int *lvls);
   void updateMeterLevels(int *lvls);
-  Ringbuffer *ringBuffer();
+  BroadcastRingbuffer *ringBuffer();
+  void allocateRingBuffer();
+  void writeRingBuffer(float *pcm,unsigned nframes);
+  void writeRingBufferPlanar(const float *const *pcm,unsigned nframes);
   unsigned channels() const;
   unsigned samplerate() const;
   void remixChannels(float *pcm_out,unsigned chans_out,
@@ -70,11 +80,14 @@ class AudioDevice : public QObject
 		      unsigned nframes,unsigned chans);
   void peakLevels(float *lvls,const float *pcm,unsigned nframes,unsigned chans);
   void peakLevels(int *lvls,const float *pcm,unsigned nframes,unsigned chans);
+  void peakLevelsPlanar(float *lvls,const float *const *pcm,unsigned nframes,
+			unsigned chans);
 
  private:
-  Ringbuffer *audio_ring;
+  BroadcastRingbuffer *audio_ring;
   unsigned audio_channels;
   unsigned audio_samplerate;
+  unsigned audio_latency_target;
   int audio_meter_levels[MAX_AUDIO_CHANNELS];
 };
 
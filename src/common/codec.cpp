@@ -21,8 +21,42 @@
 #include "codec.h"
 #include "logging.h"
 
+void *CodecEncoderThread(void *ptr)
+{
+  Codec *codec=(Codec *)ptr;
+
+  //
+  // Allow for a full codec frame on top of the nominal timeout, so that
+  // large frames at low sample rates don't register as underruns.
+  //
+  int timeout=codec->codec_wake_timeout+
+    1000*codec->pcmFrames()/codec->codec_source_samplerate;
+
+  while(codec->codec_encoder_running) {
+    codec->codec_ring1->waitForData(timeout);
+
+    //
+    // Anything taken from the ringbuffer is counted as in flight until
+    // the connector has it, so that isDrained() can't be fooled by a
+    // block that is neither in the ringbuffer nor in the hand-off queue.
+    //
+    codec->codec_in_flight.fetch_add(1,std::memory_order_acq_rel);
+    codec->encode(codec->codec_encoder_connector);
+    if(codec->codec_draining.load(std::memory_order_acquire)&&
+       (!codec->codec_drained.load(std::memory_order_relaxed))) {
+      codec->Drain(codec->codec_encoder_connector);
+      codec->codec_drained.store(true,std::memory_order_release);
+    }
+    codec->codec_in_flight.fetch_sub(1,std::memory_order_acq_rel);
+  }
+
+  return NULL;
+}
+
+
 Codec::Codec(Codec::Type type,Ringbuffer *ring,QObject *parent)
 {
+  codec_type=type;
   codec_ring1=ring;
   codec_bitrate=128;
   codec_channels=2;
@@ -30,12 +64,24 @@ Codec::Codec(Codec::Type type,Ringbuffer *ring,QObject *parent)
   codec_source_samplerate=48000;
   codec_stream_samplerate=48000;
   codec_complete_frames=false;
+  codec_ringbuffer_size=RINGBUFFER_SIZE;
+  codec_wake_timeout=CODEC_WAKE_TIMEOUT;
   codec_ring2=NULL;
+  codec_encoder_connector=NULL;
+  codec_encoder_running=false;
+  codec_in_flight=0;
+  codec_draining=false;
+  codec_drained=false;
+  codec_packet=new EncodedPacket(MAX_AUDIO_BUFFER);
+  codec_packet_pts=0;
+  codec_overruns=0;
+  codec_frames_dropped=0;
 }
 
 
 Codec::~Codec()
 {
+  stopEncoder();
   if(codec_src_state!=NULL) {
     src_delete(codec_src_state);
   }
@@ -45,6 +91,13 @@ Codec::~Codec()
   if((codec_ring2!=codec_ring1)&&(codec_ring2!=NULL)) {
     delete codec_ring2;
   }
+  delete codec_packet;
+}
+
+
+Codec::Type Codec::type() const
+{
+  return codec_type;
 }
 
 
@@ -120,6 +173,30 @@ void Codec::setCompleteFrames(bool state)
 }
 
 
+unsigned Codec::ringbufferSize() const
+{
+  return codec_ringbuffer_size;
+}
+
+
+void Codec::setRingbufferSize(unsigned bytes)
+{
+  codec_ringbuffer_size=bytes;
+}
+
+
+int Codec::wakeTimeout() const
+{
+  return codec_wake_timeout;
+}
+
+
+void Codec::setWakeTimeout(int msecs)
+{
+  codec_wake_timeout=msecs;
+}
+
+
 QByteArray Codec::streamPrologue() const
 {
   return QByteArray();
@@ -129,6 +206,8 @@ QByteArray Codec::streamPrologue() const
 bool Codec::start()
 {
   int err;
+  double ratio=(double)codec_stream_samplerate/(double)codec_source_samplerate;
+  unsigned src_size;
 
   if(codec_source_samplerate==codec_stream_samplerate) {
     codec_pcm_buffer[0]=new float[MAX_AUDIO_CHANNELS*MAX_AUDIO_BUFFER];
@@ -153,14 +232,90 @@ bool Codec::start()
     codec_src_data->data_in=codec_pcm_buffer[0];
     codec_src_data->data_out=codec_pcm_buffer[1];
     codec_src_data->output_frames=MAX_AUDIO_BUFFER*6;
-    codec_src_data->src_ratio=
-      (double)codec_stream_samplerate/(double)codec_source_samplerate;
-    codec_ring2=new Ringbuffer(262144,codec_channels);
+    codec_src_data->src_ratio=ratio;
+
+    //
+    // Sized from the latency budget at the stream rate, but always leave
+    // room for the output of a full-sized conversion plus a partial codec
+    // frame.  This ring is drained on every pass, so its size adds no
+    // latency.
+    //
+    src_size=MAX_AUDIO_BUFFER*(ratio+1.0)*codec_channels*sizeof(float);
+    if(codec_ringbuffer_size>src_size) {
+      src_size=codec_ringbuffer_size;
+    }
+    codec_ring2=new Ringbuffer(src_size,codec_channels);
+  }
+  for(unsigned i=0;i<MAX_AUDIO_CHANNELS;i++) {
+    codec_pcm_planes[i]=codec_pcm_in+i*MAX_AUDIO_BUFFER;
   }
   return startCodec();
 }
 
 
+bool Codec::startEncoder(Connector *conn)
+{
+  struct sched_param sp;
+
+  //
+  // Move encoding off of the event loop thread.  The encoder wakes
+  // whenever the audio device has delivered a full codec frame, and
+  // passes its output to the connector through the connector's
+  // lock-free hand-off queue.
+  //
+  conn->enableHandoff();
+  codec_encoder_connector=conn;
+  codec_packet_pts=0;
+  codec_overruns=codec_ring1->overruns();
+  codec_frames_dropped=codec_ring1->framesDropped();
+  codec_ring1->setWakeThreshold(pcmFrames());
+  codec_encoder_running=true;
+  if(pthread_create(&codec_encoder_thread,NULL,CodecEncoderThread,this)!=0) {
+    codec_encoder_running=false;
+    Log(LOG_ERR,"unable to start encoder thread");
+    return false;
+  }
+
+  //
+  // Try for realtime scheduling, but carry on without it if refused
+  //
+  memset(&sp,0,sizeof(sp));
+  sp.sched_priority=CODEC_ENCODER_PRIORITY;
+  pthread_setschedparam(codec_encoder_thread,SCHED_FIFO,&sp);
+
+  return true;
+}
+
+
+void Codec::stopEncoder()
+{
+  if(codec_encoder_running) {
+    codec_encoder_running=false;
+    codec_ring1->wake();
+    pthread_join(codec_encoder_thread,NULL);
+  }
+}
+
+
+void Codec::drain()
+{
+  //
+  // Call once the source has stopped for good.  The encoder thread pads
+  // out and encodes the final partial frame, then flushes whatever the
+  // encoder library is still holding.
+  //
+  codec_draining.store(true,std::memory_order_release);
+  codec_ring1->wake();
+}
+
+
+bool Codec::isDrained() const
+{
+  return codec_drained.load(std::memory_order_acquire)&&
+    (codec_in_flight.load(std::memory_order_acquire)==0);
+}
+
+
 QString Codec::codecTypeText(Codec::Type type)
 {
   QString ret=tr("Unknown");
@@ -249,16 +404,56 @@ Codec::Type Codec::codecType(const QString &key)
 }
 
 
+Ringbuffer::Layout Codec::inputLayout(Codec::Type type)
+{
+  //
+  // The channel layout in which the encoder library takes its input
+  //
+  Ringbuffer::Layout ret=Ringbuffer::Interleaved;
+
+  switch(type) {
+  case Codec::TypeVorbis:
+    ret=Ringbuffer::Planar;
+    break;
+
+  case Codec::TypeFdk:
+  case Codec::TypeMpegL2:
+  case Codec::TypeMpegL3:
+  case Codec::TypeOpus:
+  case Codec::TypePcm16:
+  case Codec::TypeLast:
+    break;
+  }
+
+  return ret;
+}
+
+
 void Codec::encode(Connector *conn)
 {
   int n;
   int err=0;
-
+  unsigned frames;
+  const float *pcm;
+  const float *planes[MAX_AUDIO_CHANNELS];
+
+  //
+  // The capture ringbuffer is shared with the other renditions and the
+  // writer never waits for us, so a span taken from it can be
+  // overwritten while the encoder is still chewing on it.  Always copy
+  // out of it (read() discards torn copies), and hand blocks over in
+  // place only from our own SRC ringbuffer, which has no other reader.
+  //
   if(codec_src_state!=NULL) {
     while(codec_ring1->readSpace()>=pcmFrames()) {
       n=codec_ring1->read(codec_pcm_in,pcmFrames());
+      if(n==0) {
+	continue;  // Overrun, so try again from the resync point
+      }
+      codec_src_data->data_in=codec_pcm_in;
       codec_src_data->input_frames=n;
-      if((err=src_process(codec_src_state,codec_src_data))!=0) {
+      err=src_process(codec_src_state,codec_src_data);
+      if(err!=0) {
 	Log(LOG_WARNING,QString().sprintf("SRC error [%s]",src_strerror(err)));
 	continue;
       }
@@ -267,9 +462,61 @@ void Codec::encode(Connector *conn)
     }
   }
   while(codec_ring2->readSpace()>=pcmFrames()) {
-    n=codec_ring2->read(codec_pcm_in,pcmFrames());
-    encodeData(conn,codec_pcm_in,n);
+    if((codec_ring2->layout()==Ringbuffer::Planar)&&
+       (inputLayout(codec_type)==Ringbuffer::Planar)) {
+      if((codec_ring2!=codec_ring1)&&
+	 codec_ring2->readPlanarSpan(planes,&frames)&&
+	 (frames>=pcmFrames())) {
+	encodePlanarData(conn,planes,pcmFrames());
+	codec_ring2->readAdvance(pcmFrames());
+      }
+      else {
+	if((n=codec_ring2->readPlanar(codec_pcm_planes,pcmFrames()))>0) {
+	  encodePlanarData(conn,codec_pcm_planes,n);
+	}
+      }
+      continue;
+    }
+    if((codec_ring2!=codec_ring1)&&
+       ((pcm=codec_ring2->readSpan(&frames))!=NULL)&&
+       (frames>=pcmFrames())) {
+      encodeData(conn,pcm,pcmFrames());
+      codec_ring2->readAdvance(pcmFrames());
+    }
+    else {
+      if((n=codec_ring2->read(codec_pcm_in,pcmFrames()))>0) {
+	encodeData(conn,codec_pcm_in,n);
+      }
+    }
+  }
+}
+
+
+void Codec::encodePlanarData(Connector *conn,const float *const *pcm,
+			     int len)
+{
+  //
+  // Only reached by codecs that declare a planar inputLayout() without
+  // overriding this.
+  //
+  float data[MAX_AUDIO_CHANNELS*MAX_AUDIO_BUFFER];
+
+  for(int i=0;i<len;i++) {
+    for(unsigned j=0;j<codec_channels;j++) {
+      data[codec_channels*i+j]=pcm[j][i];
+    }
   }
+  encodeData(conn,data,len);
+}
+
+
+void Codec::flushEncoder(Connector *)
+{
+  //
+  // For encoders that hold back audio (look-ahead, bit reservoirs and
+  // the like), emit whatever is left.  Called once, from the encoder
+  // thread, at the end of the stream.
+  //
 }
 
 
@@ -277,3 +524,84 @@ Ringbuffer *Codec::ring()
 {
   return codec_ring1;
 }
+
+
+EncodedPacket *Codec::packet()
+{
+  return codec_packet;
+}
+
+
+void Codec::Drain(Connector *conn)
+{
+  int n;
+
+  //
+  // Push the tail of the input through SRC, then encode any complete
+  // frames that yields
+  //
+  if(codec_src_state!=NULL) {
+    n=codec_ring1->read(codec_pcm_in,pcmFrames());
+    codec_src_data->data_in=codec_pcm_in;
+    codec_src_data->input_frames=n;
+    codec_src_data->end_of_input=1;
+    if(src_process(codec_src_state,codec_src_data)==0) {
+      codec_ring2->write(codec_pcm_out,codec_src_data->output_frames_gen);
+    }
+  }
+  encode(conn);
+
+  //
+  // Pad the last partial frame with silence
+  //
+  if((n=codec_ring2->read(codec_pcm_in,pcmFrames()))>0) {
+    memset(codec_pcm_in+n*codec_channels,0,
+	   (pcmFrames()-n)*codec_channels*sizeof(float));
+    encodeData(conn,codec_pcm_in,pcmFrames());
+  }
+  flushEncoder(conn);
+}
+
+
+int64_t Codec::writePacket(Connector *conn,unsigned duration,unsigned flags)
+{
+  //
+  // Send whatever the codec has put into packet(), stamped with the
+  // stream position reached so far.  Durations are summed rather than
+  // taken from the amount of PCM fed in, as encoders buffer internally
+  // and so emit output that lags their input.
+  //
+  int64_t ret=0;
+  uint64_t overruns=codec_ring1->overruns();
+  uint64_t dropped;
+
+  //
+  // Audio has gone missing since the last packet (and, as the renditions
+  // read in lockstep, from all of them at once), so tell the connector
+  // that the stream doesn't carry on seamlessly from here, and move the
+  // timestamps on past the gap.
+  //
+  if((overruns!=codec_overruns)&&(codec_packet->size()>0)&&
+     ((flags&EncodedPacket::Header)==0)) {
+    dropped=codec_ring1->framesDropped();
+    Log(LOG_WARNING,
+	QString().sprintf("%u kbps rendition lost %lu frames to overruns, marking a discontinuity",
+			  codec_bitrate,
+			  (unsigned long)(dropped-codec_frames_dropped)));
+    codec_packet_pts+=(dropped-codec_frames_dropped)*
+      codec_stream_samplerate/codec_source_samplerate;
+    codec_overruns=overruns;
+    codec_frames_dropped=dropped;
+    flags|=EncodedPacket::Discontinuity;
+  }
+  if(codec_packet->size()>0) {
+    codec_packet->setPts(codec_packet_pts);
+    codec_packet->setDuration(duration);
+    codec_packet->setFlags(flags);
+    ret=conn->writePacket(codec_packet);
+  }
+  codec_packet_pts+=duration;
+  codec_packet->clear();
+
+  return ret;
+}
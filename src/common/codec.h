@@ -21,10 +21,12 @@
 #ifndef CODEC_H
 #define CODEC_H
 
+#include <atomic>
 #include <queue>
 #include <vector>
 
 #include <dlfcn.h>
+#include <pthread.h>
 #include <syslog.h>
 
 #include <samplerate.h>
@@ -33,10 +35,13 @@
 #include <QObject>
 
 #include "connector.h"
+#include "encodedpacket.h"
 #include "glasslimits.h"
 #include "ringbuffer.h"
 
 #define MAX_AUDIO_BUFFER 4096
+#define CODEC_WAKE_TIMEOUT 100
+#define CODEC_ENCODER_PRIORITY 10
 
 class Codec : public QObject
 {
@@ -46,6 +51,7 @@ class Codec : public QObject
 	     TypeVorbis=3,TypePcm16=4,TypeOpus=5,TypeLast=6};
   Codec(Codec::Type type,Ringbuffer *ring,QObject *parent=0);
   ~Codec();
+  Codec::Type type() const;
   unsigned bitrate() const;
   void setBitrate(unsigned rate);
   unsigned channels() const;
@@ -58,6 +64,10 @@ class Codec : public QObject
   void setStreamSamplerate(unsigned rate);
   bool completeFrames() const;
   void setCompleteFrames(bool state);
+  unsigned ringbufferSize() const;
+  void setRingbufferSize(unsigned bytes);
+  int wakeTimeout() const;
+  void setWakeTimeout(int msecs);
   virtual QByteArray streamPrologue() const;
   virtual bool isAvailable() const=0;
   virtual QString contentType() const=0;
@@ -65,19 +75,31 @@ class Codec : public QObject
   virtual QString defaultExtension() const=0;
   virtual QString formatIdentifier() const=0;
   virtual bool start();
+  bool startEncoder(Connector *conn);
+  void stopEncoder();
+  void drain();
+  bool isDrained() const;
   static QString codecTypeText(Codec::Type type);
   static QString optionKeyword(Codec::Type type);
   static Codec::Type codecType(const QString &key);
+  static Ringbuffer::Layout inputLayout(Codec::Type type);
 
  public slots:
   virtual void encode(Connector *conn);
 
  protected:
   virtual void encodeData(Connector *conn,const float *pcm,int len)=0;
+  virtual void encodePlanarData(Connector *conn,const float *const *pcm,
+				int len);
   virtual bool startCodec()=0;
+  virtual void flushEncoder(Connector *conn);
   Ringbuffer *ring();
+  EncodedPacket *packet();
+  int64_t writePacket(Connector *conn,unsigned duration,unsigned flags);
 
  private:
+  void Drain(Connector *conn);
+  Codec::Type codec_type;
   Ringbuffer *codec_ring1;
   Ringbuffer *codec_ring2;
   unsigned codec_bitrate;
@@ -86,11 +108,25 @@ class Codec : public QObject
   unsigned codec_source_samplerate;
   unsigned codec_stream_samplerate;
   bool codec_complete_frames;
+  unsigned codec_ringbuffer_size;
+  int codec_wake_timeout;
   SRC_STATE *codec_src_state;
   SRC_DATA *codec_src_data;
   float *codec_pcm_in;
   float *codec_pcm_out;
   float *codec_pcm_buffer[2];
+  float *codec_pcm_planes[MAX_AUDIO_CHANNELS];
+  EncodedPacket *codec_packet;
+  int64_t codec_packet_pts;
+  uint64_t codec_overruns;
+  uint64_t codec_frames_dropped;
+  pthread_t codec_encoder_thread;
+  Connector *codec_encoder_connector;
+  std::atomic<bool> codec_encoder_running;
+  std::atomic<unsigned> codec_in_flight;
+  std::atomic<bool> codec_draining;
+  std::atomic<bool> codec_drained;
+  friend void *CodecEncoderThread(void *ptr);
 };
 
 
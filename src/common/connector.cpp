@@ -20,12 +20,24 @@
 
 #include <ctype.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include <QStringList>
 
 #include "connector.h"
 #include "logging.h"
 
+//
+// Header prepended to each block passed through the encoder hand-off
+//
+struct HandoffHeader {
+  int64_t pts;
+  uint32_t duration;
+  uint32_t flags;
+  int64_t len;
+};
+
 Connector::Connector(QObject *parent)
   : QObject(parent)
 {
@@ -54,10 +66,14 @@ Connector::Connector(QObject *parent)
   conn_script_down_process=NULL;
   conn_dump_headers=false;
   conn_is_stopping=false;
-
-  conn_data_timer=new QTimer(this);
-  connect(conn_data_timer,SIGNAL(timeout()),this,SLOT(dataTimeoutData()));
-  conn_data_timer->start(RINGBUFFER_SERVICE_INTERVAL);
+  conn_handoff_ring=NULL;
+  conn_handoff_packet=NULL;
+  conn_handoff_fd=-1;
+  conn_handoff_notifier=NULL;
+  conn_handoff_drops=0;
+  conn_handoff_blocking=false;
+  conn_handoff_aborted=false;
+  conn_handoff_reported_drops=0;
 
   conn_watchdog_timer=new QTimer(this);
   conn_watchdog_timer->setSingleShot(true);
@@ -83,7 +99,12 @@ Connector::Connector(QObject *parent)
 Connector::~Connector()
 {
   delete conn_stop_timer;
-  delete conn_data_timer;
+  if(conn_handoff_ring!=NULL) {
+    delete conn_handoff_notifier;
+    close(conn_handoff_fd);
+    glass_ringbuffer_free(conn_handoff_ring);
+    delete conn_handoff_packet;
+  }
 }
 
 
@@ -413,15 +434,112 @@ void Connector::connectToServer(const QUrl &url)
 }
 
 
-int64_t Connector::writeData(int frames,const unsigned char *data,int64_t len)
+int64_t Connector::writePacket(const EncodedPacket *pkt)
+{
+  struct HandoffHeader hdr;
+  int64_t len=pkt->size();
+
+  if(conn_handoff_ring==NULL) {
+    return writePacketConnector(pkt);
+  }
+
+  //
+  // Called from the encoder thread.  Queue the block for the event loop
+  // thread, dropping it whole if there is no room, unless we're in
+  // blocking mode, in which case wait for the event loop to catch up.
+  // A block that could never fit is dropped straight away, as is
+  // everything once the hand-off has been aborted.
+  //
+  if((sizeof(hdr)+(size_t)len)>=CONNECTOR_HANDOFF_SIZE) {
+    conn_handoff_drops++;
+    return 0;
+  }
+  while(glass_ringbuffer_write_space(conn_handoff_ring)<
+	(sizeof(hdr)+(size_t)len)) {
+    if((!conn_handoff_blocking)||conn_handoff_aborted) {
+      conn_handoff_drops++;
+      return 0;
+    }
+    usleep(CONNECTOR_HANDOFF_WAIT);
+  }
+  hdr.pts=pkt->pts();
+  hdr.duration=pkt->duration();
+  hdr.flags=pkt->flags();
+  hdr.len=len;
+  glass_ringbuffer_write(conn_handoff_ring,(const char *)&hdr,sizeof(hdr));
+  glass_ringbuffer_write(conn_handoff_ring,(const char *)pkt->data(),len);
+  eventfd_write(conn_handoff_fd,1);
+
+  return len;
+}
+
+
+bool Connector::handoffEnabled() const
+{
+  return conn_handoff_ring!=NULL;
+}
+
+
+void Connector::enableHandoff()
+{
+  if(conn_handoff_ring==NULL) {
+    conn_handoff_packet=new EncodedPacket(CONNECTOR_HANDOFF_SIZE);
+    conn_handoff_ring=glass_ringbuffer_create(CONNECTOR_HANDOFF_SIZE);
+
+    //
+    // The encoder thread signals each queued block
+    //
+    conn_handoff_fd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    conn_handoff_notifier=
+      new QSocketNotifier(conn_handoff_fd,QSocketNotifier::Read,this);
+    connect(conn_handoff_notifier,SIGNAL(activated(int)),
+	    this,SLOT(handoffActivatedData(int)));
+  }
+}
+
+
+bool Connector::handoffBlocking() const
+{
+  return conn_handoff_blocking;
+}
+
+
+void Connector::setHandoffBlocking(bool state)
+{
+  //
+  // In blocking mode, writePacket() waits for room in the hand-off queue
+  // rather than dropping data.  Used for faster-than-realtime sources,
+  // where the encoder can easily outrun the connector.
+  //
+  conn_handoff_blocking=state;
+}
+
+
+bool Connector::handoffPending() const
+{
+  if(conn_handoff_ring==NULL) {
+    return false;
+  }
+  return glass_ringbuffer_read_space(conn_handoff_ring)>0;
+}
+
+
+void Connector::abortHandoff()
 {
-  return writeDataConnector(frames,data,len);
+  //
+  // Releases an encoder thread waiting in writePacket(), which it
+  // notices within CONNECTOR_HANDOFF_WAIT uS.  Must be called before
+  // joining that thread from the event loop thread, which is the only
+  // one that could otherwise make room for it.
+  //
+  conn_handoff_aborted=true;
 }
 
 
 void Connector::stop()
 {
   conn_is_stopping=true;
+  abortHandoff();  // So as not to strand the encoder thread
   startStopping();
   setConnected(false);
 
@@ -596,6 +714,31 @@ bool Connector::requiresServerUrl(Connector::ServerType type)
 }
 
 
+bool Connector::supportsMultipleRenditions(Connector::ServerType type)
+{
+  bool ret=false;
+
+  switch(type) {
+  case Connector::HlsServer:
+  case Connector::Icecast2Server:
+  case Connector::FileServer:
+  case Connector::FileArchiveServer:
+    ret=true;
+    break;
+
+  case Connector::Shoutcast1Server:
+  case Connector::Shoutcast2Server:
+  case Connector::IcecastStreamerServer:
+  case Connector::IcecastOutServer:
+  case Connector::LastServer:
+    ret=false;
+    break;
+  }
+
+  return ret;
+}
+
+
 Connector::ServerType Connector::serverType(const QString &key)
 {
   Connector::ServerType ret=Connector::LastServer;
@@ -612,14 +755,17 @@ Connector::ServerType Connector::serverType(const QString &key)
 
 QString Connector::subMountpointName(const QString &mntpt,unsigned bitrate)
 {
-  QStringList f0=mntpt.split(".");
-  int offset=0;
+  //
+  // The bitrate goes ahead of any extension, so that clients sniffing
+  // the type from the name still get it right
+  //
+  int slash=mntpt.lastIndexOf("/");
+  int dot=mntpt.lastIndexOf(".");
 
-  if((f0[f0.size()-1]=="m3u")||(f0[f0.size()-1]=="m3u8")) {
-    offset=1;
+  if(dot>(slash+1)) {
+    return mntpt.left(dot)+QString().sprintf(".%u",bitrate)+mntpt.mid(dot);
   }
-  f0.insert(f0.begin()+f0.size()-offset,QString().sprintf("%u",bitrate));
-  return f0.join(".");
+  return mntpt+QString().sprintf(".%u",bitrate);
 }
 
 
@@ -638,9 +784,12 @@ QString Connector::basePart(const QString &fullpath)
 }
 
 
-void Connector::dataTimeoutData()
+void Connector::handoffActivatedData(int fd)
 {
-  emit dataRequested(this);
+  eventfd_t count;
+
+  eventfd_read(fd,&count);
+  ServiceHandoff();
 }
 
 
@@ -1642,3 +1791,32 @@ void Connector::sendMetadata(MetaEvent *e)
 void Connector::setStreamPrologue(const QByteArray &data)
 {
 }
+
+
+void Connector::ServiceHandoff()
+{
+  struct HandoffHeader hdr;
+  uint64_t drops=conn_handoff_drops;
+
+  while(glass_ringbuffer_peek(conn_handoff_ring,(char *)&hdr,sizeof(hdr))==
+	sizeof(hdr)) {
+    if(glass_ringbuffer_read_space(conn_handoff_ring)<
+       (sizeof(hdr)+(size_t)hdr.len)) {
+      break;  // Payload not yet fully written
+    }
+    glass_ringbuffer_read_advance(conn_handoff_ring,sizeof(hdr));
+    glass_ringbuffer_read(conn_handoff_ring,
+			  (char *)conn_handoff_packet->data(),hdr.len);
+    conn_handoff_packet->setSize(hdr.len);
+    conn_handoff_packet->setPts(hdr.pts);
+    conn_handoff_packet->setDuration(hdr.duration);
+    conn_handoff_packet->setFlags(hdr.flags);
+    writePacketConnector(conn_handoff_packet);
+  }
+  if(drops!=conn_handoff_reported_drops) {
+    Log(LOG_WARNING,
+	QString().sprintf("connector fell behind encoder, dropped %lu blocks",
+			  (unsigned long)(drops-conn_handoff_reported_drops)));
+    conn_handoff_reported_drops=drops;
+  }
+}
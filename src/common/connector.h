@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <vector>
 
 #include <QAbstractSocket>
@@ -32,11 +33,15 @@
 #include <QTimer>
 #include <QProcess>
 #include <QProcessEnvironment>
+#include <QSocketNotifier>
 #include <QUrl>
 
+#include "encodedpacket.h"
 #include "metaevent.h"
+#include "ringbuffer.h"
 
-#define RINGBUFFER_SERVICE_INTERVAL 50
+#define CONNECTOR_HANDOFF_SIZE 1048576
+#define CONNECTOR_HANDOFF_WAIT 1000
 
 class Connector : public QObject
 {
@@ -102,7 +107,13 @@ class Connector : public QObject
   void setFormatIdentifier(const QString &str);
   QUrl serverUrl() const;
   virtual void connectToServer(const QUrl &url);
-  virtual int64_t writeData(int frames,const unsigned char *data,int64_t len);
+  virtual int64_t writePacket(const EncodedPacket *pkt);
+  bool handoffEnabled() const;
+  void enableHandoff();
+  bool handoffBlocking() const;
+  void setHandoffBlocking(bool state);
+  bool handoffPending() const;
+  void abortHandoff();
   void stop();
   QString scriptUp() const;
   void setScriptUp(const QString &cmd);
@@ -114,6 +125,7 @@ class Connector : public QObject
   static QString serverTypeText(Connector::ServerType);
   static QString optionKeyword(Connector::ServerType type);
   static bool requiresServerUrl(Connector::ServerType type);
+  static bool supportsMultipleRenditions(Connector::ServerType type);
   static Connector::ServerType serverType(const QString &key);
   static QString subMountpointName(const QString &mntpt,unsigned bitrate);
   static QString pathPart(const QString &fullpath);
@@ -136,12 +148,11 @@ class Connector : public QObject
  signals:
   void connected(bool state);
   void unmuteRequested();
-  void dataRequested(Connector *conn);
   void error(QAbstractSocket::SocketError err);
   void stopped();
 
  private slots:
-  void dataTimeoutData();
+  void handoffActivatedData(int fd);
   void watchdogTimeoutData();
   void stopTimeoutData();
   void scriptErrorData(QProcess::ProcessError err);
@@ -156,8 +167,7 @@ class Connector : public QObject
   void setError(QAbstractSocket::SocketError err);
   virtual void connectToHostConnector(const QUrl &url)=0;
   virtual void disconnectFromHostConnector()=0;
-  virtual int64_t writeDataConnector(int frames,const unsigned char *data,
-				     int64_t len)=0;
+  virtual int64_t writePacketConnector(const EncodedPacket *pkt)=0;
 
  private:
   bool conn_server_exit_on_last;
@@ -184,7 +194,6 @@ class Connector : public QObject
   int conn_stream_timestamp_offset;
   QString conn_extension;
   QString conn_format_identifier;
-  QTimer *conn_data_timer;
   QTimer *conn_watchdog_timer;
   bool conn_watchdog_active;
   bool conn_connected;
@@ -201,6 +210,15 @@ class Connector : public QObject
   bool conn_dump_headers;
   QTimer *conn_script_down_garbage_timer;
   bool conn_is_stopping;
+  void ServiceHandoff();
+  glass_ringbuffer_t *conn_handoff_ring;
+  EncodedPacket *conn_handoff_packet;
+  int conn_handoff_fd;
+  QSocketNotifier *conn_handoff_notifier;
+  std::atomic<uint64_t> conn_handoff_drops;
+  std::atomic<bool> conn_handoff_blocking;
+  std::atomic<bool> conn_handoff_aborted;
+  uint64_t conn_handoff_reported_drops;
 };
 
 
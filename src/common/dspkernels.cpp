@@ -0,0 +1,754 @@
+// dspkernels.cpp
+//
+// Vectorized sample conversion, remix and metering kernels.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <math.h>
+#include <string.h>
+
+#include <atomic>
+
+#if defined(__x86_64__)||defined(__i386__)
+#define DSPKERNELS_X86
+#include <immintrin.h>
+#endif  // __x86_64__ || __i386__
+
+#if defined(__aarch64__)||defined(__ARM_NEON)
+#define DSPKERNELS_NEON
+#include <arm_neon.h>
+#endif  // __aarch64__ || __ARM_NEON
+
+#include "dspkernels.h"
+
+//
+// Scale factors, matching those of libsamplerate's conversion functions
+//
+#define DSP_S16_SCALE (1.0f/32768.0f)
+#define DSP_S32_SCALE (1.0f/2147483648.0f)
+
+struct DspKernelTable
+{
+  DspKernels::Type type;
+  void (*s16_to_float)(float *,const int16_t *,unsigned);
+  void (*s32_to_float)(float *,const int32_t *,unsigned);
+  void (*mono_to_stereo)(float *,const float *,unsigned);
+  void (*stereo_to_mono)(float *,const float *,unsigned);
+  void (*abs_peaks)(float *,const float *,unsigned,unsigned);
+  void (*swap16)(int16_t *,unsigned);
+  void (*deinterleave)(float **,const float *,unsigned,unsigned);
+};
+
+
+//
+// Scalar Kernels
+//
+// These also handle the leftover samples at the end of the vectorized
+// versions.
+//
+static void ScalarS16ToFloat(float *out,const int16_t *in,unsigned samples)
+{
+  for(unsigned i=0;i<samples;i++) {
+    out[i]=(float)in[i]*DSP_S16_SCALE;
+  }
+}
+
+
+static void ScalarS32ToFloat(float *out,const int32_t *in,unsigned samples)
+{
+  for(unsigned i=0;i<samples;i++) {
+    out[i]=(float)in[i]*DSP_S32_SCALE;
+  }
+}
+
+
+static void ScalarMonoToStereo(float *out,const float *in,unsigned frames)
+{
+  for(unsigned i=0;i<frames;i++) {
+    out[2*i]=in[i];
+    out[2*i+1]=in[i];
+  }
+}
+
+
+static void ScalarStereoToMono(float *out,const float *in,unsigned frames)
+{
+  for(unsigned i=0;i<frames;i++) {
+    out[i]=(in[2*i]+in[2*i+1])*0.5f;
+  }
+}
+
+
+static void ScalarAbsPeaks(float *lvls,const float *pcm,unsigned frames,
+			   unsigned chans)
+{
+  float v;
+
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<chans;j++) {
+      if((v=fabsf(pcm[chans*i+j]))>lvls[j]) {
+	lvls[j]=v;
+      }
+    }
+  }
+}
+
+
+static void ScalarSwap16(int16_t *data,unsigned samples)
+{
+  uint16_t v;
+
+  for(unsigned i=0;i<samples;i++) {
+    v=(uint16_t)data[i];
+    data[i]=(int16_t)((v<<8)|(v>>8));
+  }
+}
+
+
+static void ScalarDeinterleave(float **out,const float *in,unsigned frames,
+			       unsigned chans)
+{
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<chans;j++) {
+      out[j][i]=in[chans*i+j];
+    }
+  }
+}
+
+
+static void ScalarAbsPeaksEntry(float *lvls,const float *pcm,unsigned frames,
+				unsigned chans)
+{
+  for(unsigned i=0;i<chans;i++) {
+    lvls[i]=0.0;
+  }
+  ScalarAbsPeaks(lvls,pcm,frames,chans);
+}
+
+
+static void ScalarDeinterleaveEntry(float **out,const float *in,
+				    unsigned frames,unsigned chans)
+{
+  if(chans==1) {
+    memcpy(out[0],in,frames*sizeof(float));
+    return;
+  }
+  ScalarDeinterleave(out,in,frames,chans);
+}
+
+
+static const DspKernelTable dsp_scalar_table={
+  DspKernels::Scalar,
+  ScalarS16ToFloat,
+  ScalarS32ToFloat,
+  ScalarMonoToStereo,
+  ScalarStereoToMono,
+  ScalarAbsPeaksEntry,
+  ScalarSwap16,
+  ScalarDeinterleaveEntry
+};
+
+
+//
+// Reduce a vector of per-lane peaks to per-channel peaks.  Lane 'n'
+// carries channel 'n%chans', which holds because 'chans' always divides
+// the vector width when we get here.
+//
+static void ReduceLanePeaks(float *lvls,const float *lanes,unsigned width,
+			    unsigned chans)
+{
+  for(unsigned i=0;i<chans;i++) {
+    lvls[i]=0.0;
+  }
+  for(unsigned i=0;i<width;i++) {
+    if(lanes[i]>lvls[i%chans]) {
+      lvls[i%chans]=lanes[i];
+    }
+  }
+}
+
+
+#ifdef DSPKERNELS_X86
+//
+// SSE2 Kernels
+//
+__attribute__((target("sse2")))
+static void Sse2S16ToFloat(float *out,const int16_t *in,unsigned samples)
+{
+  const __m128 scale=_mm_set1_ps(DSP_S16_SCALE);
+  unsigned i=0;
+
+  for(;(i+8)<=samples;i+=8) {
+    __m128i v=_mm_loadu_si128((const __m128i *)(in+i));
+    __m128i lo=_mm_srai_epi32(_mm_unpacklo_epi16(v,v),16);
+    __m128i hi=_mm_srai_epi32(_mm_unpackhi_epi16(v,v),16);
+    _mm_storeu_ps(out+i,_mm_mul_ps(_mm_cvtepi32_ps(lo),scale));
+    _mm_storeu_ps(out+i+4,_mm_mul_ps(_mm_cvtepi32_ps(hi),scale));
+  }
+  ScalarS16ToFloat(out+i,in+i,samples-i);
+}
+
+
+__attribute__((target("sse2")))
+static void Sse2S32ToFloat(float *out,const int32_t *in,unsigned samples)
+{
+  const __m128 scale=_mm_set1_ps(DSP_S32_SCALE);
+  unsigned i=0;
+
+  for(;(i+4)<=samples;i+=4) {
+    __m128i v=_mm_loadu_si128((const __m128i *)(in+i));
+    _mm_storeu_ps(out+i,_mm_mul_ps(_mm_cvtepi32_ps(v),scale));
+  }
+  ScalarS32ToFloat(out+i,in+i,samples-i);
+}
+
+
+__attribute__((target("sse2")))
+static void Sse2MonoToStereo(float *out,const float *in,unsigned frames)
+{
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {
+    __m128 v=_mm_loadu_ps(in+i);
+    _mm_storeu_ps(out+2*i,_mm_unpacklo_ps(v,v));
+    _mm_storeu_ps(out+2*i+4,_mm_unpackhi_ps(v,v));
+  }
+  ScalarMonoToStereo(out+2*i,in+i,frames-i);
+}
+
+
+__attribute__((target("sse2")))
+static void Sse2StereoToMono(float *out,const float *in,unsigned frames)
+{
+  const __m128 half=_mm_set1_ps(0.5f);
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {
+    __m128 a=_mm_loadu_ps(in+2*i);
+    __m128 b=_mm_loadu_ps(in+2*i+4);
+    __m128 l=_mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0));
+    __m128 r=_mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1));
+    _mm_storeu_ps(out+i,_mm_mul_ps(_mm_add_ps(l,r),half));
+  }
+  ScalarStereoToMono(out+i,in+2*i,frames-i);
+}
+
+
+__attribute__((target("sse2")))
+static void Sse2AbsPeaks(float *lvls,const float *pcm,unsigned frames,
+			 unsigned chans)
+{
+  const __m128 mask=_mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+  __m128 peak=_mm_setzero_ps();
+  float lanes[4];
+  unsigned samples=frames*chans;
+  unsigned i=0;
+
+  if((chans==0)||((4%chans)!=0)) {
+    ScalarAbsPeaksEntry(lvls,pcm,frames,chans);
+    return;
+  }
+  for(;(i+4)<=samples;i+=4) {
+    peak=_mm_max_ps(peak,_mm_and_ps(_mm_loadu_ps(pcm+i),mask));
+  }
+  _mm_storeu_ps(lanes,peak);
+  ReduceLanePeaks(lvls,lanes,4,chans);
+  ScalarAbsPeaks(lvls,pcm+i,(samples-i)/chans,chans);
+}
+
+
+__attribute__((target("sse2")))
+static void Sse2Swap16(int16_t *data,unsigned samples)
+{
+  unsigned i=0;
+
+  for(;(i+8)<=samples;i+=8) {
+    __m128i v=_mm_loadu_si128((const __m128i *)(data+i));
+    v=_mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8));
+    _mm_storeu_si128((__m128i *)(data+i),v);
+  }
+  ScalarSwap16(data+i,samples-i);
+}
+
+
+__attribute__((target("sse2")))
+static void Sse2Deinterleave(float **out,const float *in,unsigned frames,
+			     unsigned chans)
+{
+  unsigned i=0;
+
+  if(chans!=2) {
+    ScalarDeinterleaveEntry(out,in,frames,chans);
+    return;
+  }
+  for(;(i+4)<=frames;i+=4) {
+    __m128 a=_mm_loadu_ps(in+2*i);
+    __m128 b=_mm_loadu_ps(in+2*i+4);
+    _mm_storeu_ps(out[0]+i,_mm_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0)));
+    _mm_storeu_ps(out[1]+i,_mm_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1)));
+  }
+  for(;i<frames;i++) {
+    out[0][i]=in[2*i];
+    out[1][i]=in[2*i+1];
+  }
+}
+
+
+static const DspKernelTable dsp_sse2_table={
+  DspKernels::Sse2,
+  Sse2S16ToFloat,
+  Sse2S32ToFloat,
+  Sse2MonoToStereo,
+  Sse2StereoToMono,
+  Sse2AbsPeaks,
+  Sse2Swap16,
+  Sse2Deinterleave
+};
+
+
+//
+// AVX2 Kernels
+//
+__attribute__((target("avx2")))
+static void Avx2S16ToFloat(float *out,const int16_t *in,unsigned samples)
+{
+  const __m256 scale=_mm256_set1_ps(DSP_S16_SCALE);
+  unsigned i=0;
+
+  for(;(i+8)<=samples;i+=8) {
+    __m256i v=
+      _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in+i)));
+    _mm256_storeu_ps(out+i,_mm256_mul_ps(_mm256_cvtepi32_ps(v),scale));
+  }
+  ScalarS16ToFloat(out+i,in+i,samples-i);
+}
+
+
+__attribute__((target("avx2")))
+static void Avx2S32ToFloat(float *out,const int32_t *in,unsigned samples)
+{
+  const __m256 scale=_mm256_set1_ps(DSP_S32_SCALE);
+  unsigned i=0;
+
+  for(;(i+8)<=samples;i+=8) {
+    __m256i v=_mm256_loadu_si256((const __m256i *)(in+i));
+    _mm256_storeu_ps(out+i,_mm256_mul_ps(_mm256_cvtepi32_ps(v),scale));
+  }
+  ScalarS32ToFloat(out+i,in+i,samples-i);
+}
+
+
+__attribute__((target("avx2")))
+static void Avx2MonoToStereo(float *out,const float *in,unsigned frames)
+{
+  unsigned i=0;
+
+  for(;(i+8)<=frames;i+=8) {
+    __m256 v=_mm256_loadu_ps(in+i);
+    __m256 lo=_mm256_unpacklo_ps(v,v);
+    __m256 hi=_mm256_unpackhi_ps(v,v);
+    _mm256_storeu_ps(out+2*i,_mm256_permute2f128_ps(lo,hi,0x20));
+    _mm256_storeu_ps(out+2*i+8,_mm256_permute2f128_ps(lo,hi,0x31));
+  }
+  ScalarMonoToStereo(out+2*i,in+i,frames-i);
+}
+
+
+//
+// Gather the even and odd floats of sixteen interleaved stereo samples
+// into two eight-sample vectors.
+//
+__attribute__((target("avx2")))
+static inline void Avx2Split(__m256 *l,__m256 *r,const float *in)
+{
+  __m256 a=_mm256_loadu_ps(in);
+  __m256 b=_mm256_loadu_ps(in+8);
+
+  *l=_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(
+	_mm256_shuffle_ps(a,b,_MM_SHUFFLE(2,0,2,0))),_MM_SHUFFLE(3,1,2,0)));
+  *r=_mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(
+	_mm256_shuffle_ps(a,b,_MM_SHUFFLE(3,1,3,1))),_MM_SHUFFLE(3,1,2,0)));
+}
+
+
+__attribute__((target("avx2")))
+static void Avx2StereoToMono(float *out,const float *in,unsigned frames)
+{
+  const __m256 half=_mm256_set1_ps(0.5f);
+  __m256 l;
+  __m256 r;
+  unsigned i=0;
+
+  for(;(i+8)<=frames;i+=8) {
+    Avx2Split(&l,&r,in+2*i);
+    _mm256_storeu_ps(out+i,_mm256_mul_ps(_mm256_add_ps(l,r),half));
+  }
+  ScalarStereoToMono(out+i,in+2*i,frames-i);
+}
+
+
+__attribute__((target("avx2")))
+static void Avx2AbsPeaks(float *lvls,const float *pcm,unsigned frames,
+			 unsigned chans)
+{
+  const __m256 mask=_mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+  __m256 peak=_mm256_setzero_ps();
+  float lanes[8];
+  unsigned samples=frames*chans;
+  unsigned i=0;
+
+  if((chans==0)||((8%chans)!=0)) {
+    ScalarAbsPeaksEntry(lvls,pcm,frames,chans);
+    return;
+  }
+  for(;(i+8)<=samples;i+=8) {
+    peak=_mm256_max_ps(peak,_mm256_and_ps(_mm256_loadu_ps(pcm+i),mask));
+  }
+  _mm256_storeu_ps(lanes,peak);
+  ReduceLanePeaks(lvls,lanes,8,chans);
+  ScalarAbsPeaks(lvls,pcm+i,(samples-i)/chans,chans);
+}
+
+
+__attribute__((target("avx2")))
+static void Avx2Swap16(int16_t *data,unsigned samples)
+{
+  unsigned i=0;
+
+  for(;(i+16)<=samples;i+=16) {
+    __m256i v=_mm256_loadu_si256((const __m256i *)(data+i));
+    v=_mm256_or_si256(_mm256_slli_epi16(v,8),_mm256_srli_epi16(v,8));
+    _mm256_storeu_si256((__m256i *)(data+i),v);
+  }
+  ScalarSwap16(data+i,samples-i);
+}
+
+
+__attribute__((target("avx2")))
+static void Avx2Deinterleave(float **out,const float *in,unsigned frames,
+			     unsigned chans)
+{
+  __m256 l;
+  __m256 r;
+  unsigned i=0;
+
+  if(chans!=2) {
+    ScalarDeinterleaveEntry(out,in,frames,chans);
+    return;
+  }
+  for(;(i+8)<=frames;i+=8) {
+    Avx2Split(&l,&r,in+2*i);
+    _mm256_storeu_ps(out[0]+i,l);
+    _mm256_storeu_ps(out[1]+i,r);
+  }
+  for(;i<frames;i++) {
+    out[0][i]=in[2*i];
+    out[1][i]=in[2*i+1];
+  }
+}
+
+
+static const DspKernelTable dsp_avx2_table={
+  DspKernels::Avx2,
+  Avx2S16ToFloat,
+  Avx2S32ToFloat,
+  Avx2MonoToStereo,
+  Avx2StereoToMono,
+  Avx2AbsPeaks,
+  Avx2Swap16,
+  Avx2Deinterleave
+};
+#endif  // DSPKERNELS_X86
+
+
+#ifdef DSPKERNELS_NEON
+//
+// NEON Kernels
+//
+static void NeonS16ToFloat(float *out,const int16_t *in,unsigned samples)
+{
+  unsigned i=0;
+
+  for(;(i+8)<=samples;i+=8) {
+    int16x8_t v=vld1q_s16(in+i);
+    vst1q_f32(out+i,
+	      vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))),
+			  DSP_S16_SCALE));
+    vst1q_f32(out+i+4,
+	      vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))),
+			  DSP_S16_SCALE));
+  }
+  ScalarS16ToFloat(out+i,in+i,samples-i);
+}
+
+
+static void NeonS32ToFloat(float *out,const int32_t *in,unsigned samples)
+{
+  unsigned i=0;
+
+  for(;(i+4)<=samples;i+=4) {
+    vst1q_f32(out+i,vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(in+i)),
+				DSP_S32_SCALE));
+  }
+  ScalarS32ToFloat(out+i,in+i,samples-i);
+}
+
+
+static void NeonMonoToStereo(float *out,const float *in,unsigned frames)
+{
+  float32x4x2_t v;
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {
+    v.val[0]=vld1q_f32(in+i);
+    v.val[1]=v.val[0];
+    vst2q_f32(out+2*i,v);
+  }
+  ScalarMonoToStereo(out+2*i,in+i,frames-i);
+}
+
+
+static void NeonStereoToMono(float *out,const float *in,unsigned frames)
+{
+  float32x4x2_t v;
+  unsigned i=0;
+
+  for(;(i+4)<=frames;i+=4) {
+    v=vld2q_f32(in+2*i);
+    vst1q_f32(out+i,vmulq_n_f32(vaddq_f32(v.val[0],v.val[1]),0.5f));
+  }
+  ScalarStereoToMono(out+i,in+2*i,frames-i);
+}
+
+
+static void NeonAbsPeaks(float *lvls,const float *pcm,unsigned frames,
+			 unsigned chans)
+{
+  float32x4_t peak=vdupq_n_f32(0.0f);
+  float lanes[4];
+  unsigned samples=frames*chans;
+  unsigned i=0;
+
+  if((chans==0)||((4%chans)!=0)) {
+    ScalarAbsPeaksEntry(lvls,pcm,frames,chans);
+    return;
+  }
+  for(;(i+4)<=samples;i+=4) {
+    peak=vmaxq_f32(peak,vabsq_f32(vld1q_f32(pcm+i)));
+  }
+  vst1q_f32(lanes,peak);
+  ReduceLanePeaks(lvls,lanes,4,chans);
+  ScalarAbsPeaks(lvls,pcm+i,(samples-i)/chans,chans);
+}
+
+
+static void NeonSwap16(int16_t *data,unsigned samples)
+{
+  unsigned i=0;
+
+  for(;(i+8)<=samples;i+=8) {
+    uint8x16_t v=vld1q_u8((const uint8_t *)(data+i));
+    vst1q_u8((uint8_t *)(data+i),vrev16q_u8(v));
+  }
+  ScalarSwap16(data+i,samples-i);
+}
+
+
+static void NeonDeinterleave(float **out,const float *in,unsigned frames,
+			     unsigned chans)
+{
+  float32x4x2_t v;
+  unsigned i=0;
+
+  if(chans!=2) {
+    ScalarDeinterleaveEntry(out,in,frames,chans);
+    return;
+  }
+  for(;(i+4)<=frames;i+=4) {
+    v=vld2q_f32(in+2*i);
+    vst1q_f32(out[0]+i,v.val[0]);
+    vst1q_f32(out[1]+i,v.val[1]);
+  }
+  for(;i<frames;i++) {
+    out[0][i]=in[2*i];
+    out[1][i]=in[2*i+1];
+  }
+}
+
+
+static const DspKernelTable dsp_neon_table={
+  DspKernels::Neon,
+  NeonS16ToFloat,
+  NeonS32ToFloat,
+  NeonMonoToStereo,
+  NeonStereoToMono,
+  NeonAbsPeaks,
+  NeonSwap16,
+  NeonDeinterleave
+};
+#endif  // DSPKERNELS_NEON
+
+
+//
+// Dispatch
+//
+static std::atomic<const DspKernelTable *> dsp_table(NULL);
+
+static const DspKernelTable *KernelTable(DspKernels::Type type)
+{
+  switch(type) {
+  case DspKernels::Scalar:
+    return &dsp_scalar_table;
+
+  case DspKernels::Sse2:
+#ifdef DSPKERNELS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")) {
+      return &dsp_sse2_table;
+    }
+#endif  // DSPKERNELS_X86
+    break;
+
+  case DspKernels::Avx2:
+#ifdef DSPKERNELS_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+      return &dsp_avx2_table;
+    }
+#endif  // DSPKERNELS_X86
+    break;
+
+  case DspKernels::Neon:
+#ifdef DSPKERNELS_NEON
+    return &dsp_neon_table;
+#endif  // DSPKERNELS_NEON
+    break;
+
+  case DspKernels::LastType:
+    break;
+  }
+  return NULL;
+}
+
+
+static const DspKernelTable *Kernels()
+{
+  const DspKernelTable *table=dsp_table.load(std::memory_order_acquire);
+
+  if(table==NULL) {
+    for(int i=DspKernels::LastType-1;i>=0;i--) {
+      if((table=KernelTable((DspKernels::Type)i))!=NULL) {
+	break;
+      }
+    }
+    dsp_table.store(table,std::memory_order_release);
+  }
+  return table;
+}
+
+
+DspKernels::Type DspKernels::type()
+{
+  return Kernels()->type;
+}
+
+
+bool DspKernels::setType(DspKernels::Type type)
+{
+  const DspKernelTable *table=KernelTable(type);
+
+  if(table==NULL) {
+    return false;
+  }
+  dsp_table.store(table,std::memory_order_release);
+  return true;
+}
+
+
+bool DspKernels::isAvailable(DspKernels::Type type)
+{
+  return KernelTable(type)!=NULL;
+}
+
+
+const char *DspKernels::typeText(DspKernels::Type type)
+{
+  switch(type) {
+  case DspKernels::Scalar:
+    return "scalar";
+
+  case DspKernels::Sse2:
+    return "sse2";
+
+  case DspKernels::Avx2:
+    return "avx2";
+
+  case DspKernels::Neon:
+    return "neon";
+
+  case DspKernels::LastType:
+    break;
+  }
+  return "unknown";
+}
+
+
+void DspKernels::s16ToFloat(float *out,const int16_t *in,unsigned samples)
+{
+  Kernels()->s16_to_float(out,in,samples);
+}
+
+
+void DspKernels::s32ToFloat(float *out,const int32_t *in,unsigned samples)
+{
+  Kernels()->s32_to_float(out,in,samples);
+}
+
+
+void DspKernels::monoToStereo(float *out,const float *in,unsigned frames)
+{
+  Kernels()->mono_to_stereo(out,in,frames);
+}
+
+
+void DspKernels::stereoToMono(float *out,const float *in,unsigned frames)
+{
+  Kernels()->stereo_to_mono(out,in,frames);
+}
+
+
+void DspKernels::absPeaks(float *lvls,const float *pcm,unsigned frames,
+			  unsigned chans)
+{
+  //
+  // Per-channel peak absolute sample value, over every frame
+  //
+  Kernels()->abs_peaks(lvls,pcm,frames,chans);
+}
+
+
+void DspKernels::swap16(int16_t *data,unsigned samples)
+{
+  Kernels()->swap16(data,samples);
+}
+
+
+void DspKernels::deinterleave(float **out,const float *in,unsigned frames,
+			      unsigned chans)
+{
+  Kernels()->deinterleave(out,in,frames,chans);
+}
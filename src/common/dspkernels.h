@@ -0,0 +1,51 @@
+// dspkernels.h
+//
+// Vectorized sample conversion, remix and metering kernels.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef DSPKERNELS_H
+#define DSPKERNELS_H
+
+#include <stdint.h>
+
+//
+// The best implementation supported by the running CPU is selected the
+// first time any kernel is called.  All of these are safe to call from
+// realtime audio threads: they neither allocate nor block.
+//
+class DspKernels
+{
+ public:
+  enum Type {Scalar=0,Sse2=1,Avx2=2,Neon=3,LastType=4};
+  static DspKernels::Type type();
+  static bool setType(DspKernels::Type type);
+  static bool isAvailable(DspKernels::Type type);
+  static const char *typeText(DspKernels::Type type);
+  static void s16ToFloat(float *out,const int16_t *in,unsigned samples);
+  static void s32ToFloat(float *out,const int32_t *in,unsigned samples);
+  static void monoToStereo(float *out,const float *in,unsigned frames);
+  static void stereoToMono(float *out,const float *in,unsigned frames);
+  static void absPeaks(float *lvls,const float *pcm,unsigned frames,
+		       unsigned chans);
+  static void swap16(int16_t *data,unsigned samples);
+  static void deinterleave(float **out,const float *in,unsigned frames,
+			   unsigned chans);
+};
+
+
+#endif  // DSPKERNELS_H
@@ -0,0 +1,196 @@
+// encodedpacket.cpp
+//
+// Container class for a block of encoded audio.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <string.h>
+
+#include "encodedpacket.h"
+
+EncodedPacket::EncodedPacket(int64_t capacity)
+{
+  pkt_pts=0;
+  pkt_duration=0;
+  pkt_flags=0;
+  pkt_data=NULL;
+  pkt_size=0;
+  pkt_capacity=0;
+  reserve(capacity);
+}
+
+
+EncodedPacket::~EncodedPacket()
+{
+  if(pkt_data!=NULL) {
+    delete[] pkt_data;
+  }
+}
+
+
+int64_t EncodedPacket::pts() const
+{
+  return pkt_pts;
+}
+
+
+void EncodedPacket::setPts(int64_t pts)
+{
+  pkt_pts=pts;
+}
+
+
+unsigned EncodedPacket::duration() const
+{
+  return pkt_duration;
+}
+
+
+void EncodedPacket::setDuration(unsigned samples)
+{
+  pkt_duration=samples;
+}
+
+
+int64_t EncodedPacket::endPts() const
+{
+  return pkt_pts+pkt_duration;
+}
+
+
+unsigned EncodedPacket::flags() const
+{
+  return pkt_flags;
+}
+
+
+void EncodedPacket::setFlags(unsigned flags)
+{
+  pkt_flags=flags;
+}
+
+
+bool EncodedPacket::isFrameBoundary() const
+{
+  return (pkt_flags&EncodedPacket::FrameBoundary)!=0;
+}
+
+
+bool EncodedPacket::isKeyframe() const
+{
+  return (pkt_flags&EncodedPacket::Keyframe)!=0;
+}
+
+
+bool EncodedPacket::isHeader() const
+{
+  return (pkt_flags&EncodedPacket::Header)!=0;
+}
+
+
+bool EncodedPacket::isDiscontinuity() const
+{
+  return (pkt_flags&EncodedPacket::Discontinuity)!=0;
+}
+
+
+const unsigned char *EncodedPacket::data() const
+{
+  return pkt_data;
+}
+
+
+unsigned char *EncodedPacket::data()
+{
+  return pkt_data;
+}
+
+
+int64_t EncodedPacket::size() const
+{
+  return pkt_size;
+}
+
+
+void EncodedPacket::setSize(int64_t bytes)
+{
+  //
+  // For use after writing directly into data(), so must be within the
+  // capacity already reserved
+  //
+  if(bytes<0) {
+    bytes=0;
+  }
+  if(bytes>pkt_capacity) {
+    bytes=pkt_capacity;
+  }
+  pkt_size=bytes;
+}
+
+
+int64_t EncodedPacket::capacity() const
+{
+  return pkt_capacity;
+}
+
+
+void EncodedPacket::reserve(int64_t bytes)
+{
+  unsigned char *data=NULL;
+
+  if(bytes<=pkt_capacity) {
+    return;
+  }
+  data=new unsigned char[bytes];
+  if(pkt_size>0) {
+    memcpy(data,pkt_data,pkt_size);
+  }
+  if(pkt_data!=NULL) {
+    delete[] pkt_data;
+  }
+  pkt_data=data;
+  pkt_capacity=bytes;
+}
+
+
+void EncodedPacket::setData(const unsigned char *data,int64_t len)
+{
+  pkt_size=0;
+  append(data,len);
+}
+
+
+void EncodedPacket::append(const unsigned char *data,int64_t len)
+{
+  if(len<=0) {
+    return;
+  }
+  if((pkt_size+len)>pkt_capacity) {
+    reserve(2*(pkt_size+len));
+  }
+  memcpy(pkt_data+pkt_size,data,len);
+  pkt_size+=len;
+}
+
+
+void EncodedPacket::clear()
+{
+  pkt_pts=0;
+  pkt_duration=0;
+  pkt_flags=0;
+  pkt_size=0;
+}
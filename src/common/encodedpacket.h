@@ -0,0 +1,71 @@
+// encodedpacket.h
+//
+// Container class for a block of encoded audio.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef ENCODEDPACKET_H
+#define ENCODEDPACKET_H
+
+#include <stdint.h>
+
+//
+// Timestamps and durations are in samples at the stream sample rate.
+// The payload buffer only ever grows, so a packet that is reused for each
+// block settles down to doing no allocation at all.
+//
+class EncodedPacket
+{
+ public:
+  enum Flag {FrameBoundary=0x01,Keyframe=0x02,Header=0x04,
+	     Discontinuity=0x08};
+  EncodedPacket(int64_t capacity=0);
+  ~EncodedPacket();
+  int64_t pts() const;
+  void setPts(int64_t pts);
+  unsigned duration() const;
+  void setDuration(unsigned samples);
+  int64_t endPts() const;
+  unsigned flags() const;
+  void setFlags(unsigned flags);
+  bool isFrameBoundary() const;
+  bool isKeyframe() const;
+  bool isHeader() const;
+  bool isDiscontinuity() const;
+  const unsigned char *data() const;
+  unsigned char *data();
+  int64_t size() const;
+  void setSize(int64_t bytes);
+  int64_t capacity() const;
+  void reserve(int64_t bytes);
+  void setData(const unsigned char *data,int64_t len);
+  void append(const unsigned char *data,int64_t len);
+  void clear();
+
+ private:
+  EncodedPacket(const EncodedPacket &);
+  EncodedPacket &operator=(const EncodedPacket &);
+  int64_t pkt_pts;
+  unsigned pkt_duration;
+  unsigned pkt_flags;
+  unsigned char *pkt_data;
+  int64_t pkt_size;
+  int64_t pkt_capacity;
+};
+
+
+#endif  // ENCODEDPACKET_H
@@ -27,6 +27,25 @@
 #define DEFAULT_AUDIO_DEVICE AudioDevice::Jack
 #define MAX_AUDIO_CHANNELS 2
 #define RINGBUFFER_SIZE 262144
+#define RINGBUFFER_STATS_INTERVAL 1000
+#define LATENCY_TARGET_MIN 5
+#define LATENCY_TARGET_MAX 30000
+#define LATENCY_CAPTURE_PERIODS 4
+#define LATENCY_MIN_CAPTURE_PERIOD 32
+#define LATENCY_MIN_RINGBUFFER_FRAMES 4096
+#define LATENCY_MIN_WAKE_TIMEOUT 5
 #define PROCESS_TERMINATION_TIMEOUT 30000
+#define HLS_SEGMENT_DURATION_DEFAULT 10
+#define HLS_SEGMENT_DURATION_MIN 1
+#define HLS_SEGMENT_DURATION_MAX 60
+#define HLS_WINDOW_DEFAULT 4
+#define HLS_WINDOW_MIN 3
+#define HLS_WINDOW_MAX 1000
+#define HLS_FAST_START_DURATION 1
+#define HLS_PART_DURATION_MIN 200
+#define HLS_PART_DURATION_MAX 5000
+#define SERVER_MAX_UPLOADS_DEFAULT 4
+#define SERVER_MAX_UPLOADS_MIN 1
+#define SERVER_MAX_UPLOADS_MAX 32
 
 #endif  // GLASSLIMITS_H
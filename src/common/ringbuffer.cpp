@@ -26,8 +26,13 @@
 
 #include <ringbuffer.h>
 
+#include <errno.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <new>
+#include <sys/eventfd.h>
 #ifdef USE_MLOCK
 #include <sys/mman.h>
 #endif /* USE_MLOCK */
@@ -50,6 +55,16 @@ size_t glass_ringbuffer_write(glass_ringbuffer_t *rb, const char *src,
 void glass_ringbuffer_write_advance(glass_ringbuffer_t *rb, size_t cnt);
 size_t glass_ringbuffer_write_space(const glass_ringbuffer_t *rb);
 
+/* Memory ordering: each index is only ever stored by its owning side
+   (write_ptr by the writer, read_ptr by the reader) with release
+   semantics, and the opposite index is loaded with acquire semantics.
+   That guarantees that buffer contents copied before an index update
+   are visible to the other side once it sees the new index value. */
+
+#define GLASS_RB_OWN(p) (p).load(std::memory_order_relaxed)
+#define GLASS_RB_OTHER(p) (p).load(std::memory_order_acquire)
+#define GLASS_RB_PUBLISH(p,v) (p).store((v),std::memory_order_release)
+
 /* Create a new ringbuffer to hold at least `sz' bytes of data. The
    actual buffer size is rounded up to the next power of two.  */
 
@@ -57,21 +72,25 @@ glass_ringbuffer_t *
 glass_ringbuffer_create (int sz)
 {
   	int power_of_two;
+	void *mem;
 	glass_ringbuffer_t *rb;
 
-	if ((rb = (glass_ringbuffer_t *) malloc (sizeof (glass_ringbuffer_t))) == NULL) {
+	if (posix_memalign (&mem, GLASS_RINGBUFFER_CACHE_LINE,
+			    sizeof (glass_ringbuffer_t)) != 0) {
 		return NULL;
 	}
+	rb = new (mem) glass_ringbuffer_t;
 
 	for (power_of_two = 1; 1 << power_of_two < sz; power_of_two++);
 
 	rb->size = 1 << power_of_two;
 	rb->size_mask = rb->size;
 	rb->size_mask -= 1;
-	rb->write_ptr = 0;
-	rb->read_ptr = 0;
+	rb->write_ptr.store (0, std::memory_order_relaxed);
+	rb->read_ptr.store (0, std::memory_order_relaxed);
 	if ((rb->buf = (char *) malloc (rb->size)) == NULL) {
-		free (rb);
+		rb->~glass_ringbuffer_t ();
+		free (mem);
 		return NULL;
 	}
 	rb->mlocked = 0;
@@ -90,6 +109,7 @@ glass_ringbuffer_free (glass_ringbuffer_t * rb)
 	}
 #endif /* USE_MLOCK */
 	free (rb->buf);
+	rb->~glass_ringbuffer_t ();
 	free (rb);
 }
 
@@ -113,8 +133,8 @@ glass_ringbuffer_mlock (glass_ringbuffer_t * rb)
 void
 glass_ringbuffer_reset (glass_ringbuffer_t * rb)
 {
-	rb->read_ptr = 0;
-	rb->write_ptr = 0;
+	rb->read_ptr.store (0, std::memory_order_relaxed);
+	rb->write_ptr.store (0, std::memory_order_relaxed);
     memset(rb->buf, 0, rb->size);
 }
 
@@ -127,8 +147,8 @@ glass_ringbuffer_reset_size (glass_ringbuffer_t * rb, size_t sz)
     rb->size = sz;
     rb->size_mask = rb->size;
     rb->size_mask -= 1;
-    rb->read_ptr = 0;
-    rb->write_ptr = 0;
+    rb->read_ptr.store (0, std::memory_order_relaxed);
+    rb->write_ptr.store (0, std::memory_order_relaxed);
 }
 
 /* Return the number of bytes available for reading.  This is the
@@ -140,8 +160,8 @@ glass_ringbuffer_read_space (const glass_ringbuffer_t * rb)
 {
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = GLASS_RB_OTHER (rb->write_ptr);
+	r = GLASS_RB_OTHER (rb->read_ptr);
 
 	if (w > r) {
 		return w - r;
@@ -159,8 +179,8 @@ glass_ringbuffer_write_space (const glass_ringbuffer_t * rb)
 {
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = GLASS_RB_OTHER (rb->write_ptr);
+	r = GLASS_RB_OTHER (rb->read_ptr);
 
 	if (w > r) {
 		return ((r - w + rb->size) & rb->size_mask) - 1;
@@ -181,6 +201,7 @@ glass_ringbuffer_read (glass_ringbuffer_t * rb, char *dest, size_t cnt)
 	size_t cnt2;
 	size_t to_read;
 	size_t n1, n2;
+	size_t r;
 
 	if ((free_cnt = glass_ringbuffer_read_space (rb)) == 0) {
 		return 0;
@@ -188,23 +209,25 @@ glass_ringbuffer_read (glass_ringbuffer_t * rb, char *dest, size_t cnt)
 
 	to_read = cnt > free_cnt ? free_cnt : cnt;
 
-	cnt2 = rb->read_ptr + to_read;
+	r = GLASS_RB_OWN (rb->read_ptr);
+	cnt2 = r + to_read;
 
 	if (cnt2 > rb->size) {
-		n1 = rb->size - rb->read_ptr;
+		n1 = rb->size - r;
 		n2 = cnt2 & rb->size_mask;
 	} else {
 		n1 = to_read;
 		n2 = 0;
 	}
 
-	memcpy (dest, &(rb->buf[rb->read_ptr]), n1);
-	rb->read_ptr = (rb->read_ptr + n1) & rb->size_mask;
+	memcpy (dest, &(rb->buf[r]), n1);
+	r = (r + n1) & rb->size_mask;
 
 	if (n2) {
-		memcpy (dest + n1, &(rb->buf[rb->read_ptr]), n2);
-		rb->read_ptr = (rb->read_ptr + n2) & rb->size_mask;
+		memcpy (dest + n1, &(rb->buf[r]), n2);
+		r = (r + n2) & rb->size_mask;
 	}
+	GLASS_RB_PUBLISH (rb->read_ptr, r);
 
 	return to_read;
 }
@@ -222,7 +245,7 @@ glass_ringbuffer_peek (glass_ringbuffer_t * rb, char *dest, size_t cnt)
 	size_t n1, n2;
 	size_t tmp_read_ptr;
 
-	tmp_read_ptr = rb->read_ptr;
+	tmp_read_ptr = GLASS_RB_OWN (rb->read_ptr);
 
 	if ((free_cnt = glass_ringbuffer_read_space (rb)) == 0) {
 		return 0;
@@ -260,6 +283,7 @@ glass_ringbuffer_write (glass_ringbuffer_t * rb, const char *src, size_t cnt)
 	size_t cnt2;
 	size_t to_write;
 	size_t n1, n2;
+	size_t w;
 
 	if ((free_cnt = glass_ringbuffer_write_space (rb)) == 0) {
 		return 0;
@@ -267,23 +291,25 @@ glass_ringbuffer_write (glass_ringbuffer_t * rb, const char *src, size_t cnt)
 
 	to_write = cnt > free_cnt ? free_cnt : cnt;
 
-	cnt2 = rb->write_ptr + to_write;
+	w = GLASS_RB_OWN (rb->write_ptr);
+	cnt2 = w + to_write;
 
 	if (cnt2 > rb->size) {
-		n1 = rb->size - rb->write_ptr;
+		n1 = rb->size - w;
 		n2 = cnt2 & rb->size_mask;
 	} else {
 		n1 = to_write;
 		n2 = 0;
 	}
 
-	memcpy (&(rb->buf[rb->write_ptr]), src, n1);
-	rb->write_ptr = (rb->write_ptr + n1) & rb->size_mask;
+	memcpy (&(rb->buf[w]), src, n1);
+	w = (w + n1) & rb->size_mask;
 
 	if (n2) {
-		memcpy (&(rb->buf[rb->write_ptr]), src + n1, n2);
-		rb->write_ptr = (rb->write_ptr + n2) & rb->size_mask;
+		memcpy (&(rb->buf[w]), src + n1, n2);
+		w = (w + n2) & rb->size_mask;
 	}
+	GLASS_RB_PUBLISH (rb->write_ptr, w);
 
 	return to_write;
 }
@@ -293,8 +319,8 @@ glass_ringbuffer_write (glass_ringbuffer_t * rb, const char *src, size_t cnt)
 void
 glass_ringbuffer_read_advance (glass_ringbuffer_t * rb, size_t cnt)
 {
-	size_t tmp = (rb->read_ptr + cnt) & rb->size_mask;
-	rb->read_ptr = tmp;
+	size_t tmp = (GLASS_RB_OWN (rb->read_ptr) + cnt) & rb->size_mask;
+	GLASS_RB_PUBLISH (rb->read_ptr, tmp);
 }
 
 /* Advance the write pointer `cnt' places. */
@@ -302,8 +328,8 @@ glass_ringbuffer_read_advance (glass_ringbuffer_t * rb, size_t cnt)
 void
 glass_ringbuffer_write_advance (glass_ringbuffer_t * rb, size_t cnt)
 {
-	size_t tmp = (rb->write_ptr + cnt) & rb->size_mask;
-	rb->write_ptr = tmp;
+	size_t tmp = (GLASS_RB_OWN (rb->write_ptr) + cnt) & rb->size_mask;
+	GLASS_RB_PUBLISH (rb->write_ptr, tmp);
 }
 
 /* The non-copying data reader.  `vec' is an array of two places.  Set
@@ -319,8 +345,8 @@ glass_ringbuffer_get_read_vector (const glass_ringbuffer_t * rb,
 	size_t cnt2;
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = GLASS_RB_OTHER (rb->write_ptr);
+	r = GLASS_RB_OWN (rb->read_ptr);
 
 	if (w > r) {
 		free_cnt = w - r;
@@ -363,8 +389,8 @@ glass_ringbuffer_get_write_vector (const glass_ringbuffer_t * rb,
 	size_t cnt2;
 	size_t w, r;
 
-	w = rb->write_ptr;
-	r = rb->read_ptr;
+	w = GLASS_RB_OWN (rb->write_ptr);
+	r = GLASS_RB_OTHER (rb->read_ptr);
 
 	if (w > r) {
 		free_cnt = ((r - w + rb->size) & rb->size_mask) - 1;
@@ -397,18 +423,63 @@ Ringbuffer::Ringbuffer(size_t bytes,unsigned channels)
 {
   ring_channels=channels;
   ring_ring=glass_ringbuffer_create(bytes);
+  ring_wake_threshold=0;
+  ring_notify_fd=-1;
+  ring_wake_pending=false;
+  ring_frames_written=0;
+  ring_frames_dropped=0;
+  ring_overruns=0;
+  ring_underruns=0;
+  ring_high_water=0;
+}
+
+
+Ringbuffer::Ringbuffer(unsigned channels)
+{
+  ring_channels=channels;
+  ring_ring=NULL;
+  ring_wake_threshold=0;
+  ring_notify_fd=-1;
+  ring_wake_pending=false;
+  ring_frames_written=0;
+  ring_frames_dropped=0;
+  ring_overruns=0;
+  ring_underruns=0;
+  ring_high_water=0;
 }
 
 
 Ringbuffer::~Ringbuffer()
 {
-  glass_ringbuffer_free(ring_ring);
+  int fd=ring_notify_fd.load(std::memory_order_acquire);
+
+  if(fd>=0) {
+    close(fd);
+  }
+  if(ring_ring!=NULL) {
+    glass_ringbuffer_free(ring_ring);
+  }
 }
 
 
 unsigned Ringbuffer::size() const
 {
-  return 0;
+  if(ring_ring==NULL) {
+    return 0;
+  }
+  return (ring_ring->size-1)/(sizeof(float)*ring_channels);
+}
+
+
+unsigned Ringbuffer::channels() const
+{
+  return ring_channels;
+}
+
+
+Ringbuffer::Layout Ringbuffer::layout() const
+{
+  return Ringbuffer::Interleaved;
 }
 
 
@@ -420,17 +491,92 @@ unsigned Ringbuffer::read(float *data,unsigned frames)
 }
 
 
+unsigned Ringbuffer::readPlanar(float **data,unsigned frames)
+{
+  glass_ringbuffer_data_t vec[2];
+  unsigned n=0;
+  unsigned len;
+  const float *pcm;
+
+  glass_ringbuffer_get_read_vector(ring_ring,vec);
+  for(unsigned i=0;i<2;i++) {
+    pcm=(const float *)vec[i].buf;
+    len=vec[i].len/(sizeof(float)*ring_channels);
+    for(unsigned j=0;(j<len)&&(n<frames);j++) {
+      for(unsigned k=0;k<ring_channels;k++) {
+	data[k][n]=pcm[ring_channels*j+k];
+      }
+      n++;
+    }
+  }
+
+  return dump(n);
+}
+
+
 unsigned Ringbuffer::readSpace() const
 {
   return glass_ringbuffer_read_space(ring_ring)/(sizeof(float)*ring_channels);
 }
 
 
+const float *Ringbuffer::readSpan(unsigned *frames)
+{
+  //
+  // Returns a pointer to the first contiguous block of readable frames,
+  // and its length in '*frames'.  The data remains in the buffer until
+  // consumed with readAdvance().
+  //
+  glass_ringbuffer_data_t vec[2];
+
+  glass_ringbuffer_get_read_vector(ring_ring,vec);
+  *frames=vec[0].len/(sizeof(float)*ring_channels);
+  if(*frames==0) {
+    return NULL;
+  }
+  return (const float *)vec[0].buf;
+}
+
+
+bool Ringbuffer::readPlanarSpan(const float **,unsigned *frames)
+{
+  *frames=0;
+  return false;  // Always interleaved
+}
+
+
+unsigned Ringbuffer::readAdvance(unsigned frames)
+{
+  return dump(frames);
+}
+
+
 unsigned Ringbuffer::write(float *data,unsigned frames)
 {
-  return glass_ringbuffer_write(ring_ring,(const char *)data,
-			      frames*sizeof(float)*ring_channels)/
+  unsigned ret;
+  unsigned space=writeSpace();
+
+  //
+  // Only ever write whole frames, so that the read side (and readSpan()
+  // in particular) never sees a partial one.  Anything that doesn't fit
+  // is lost, and counted as an overrun.
+  //
+  if(frames>space) {
+    countOverrun(frames-space);
+    frames=space;
+  }
+  ret=glass_ringbuffer_write(ring_ring,(const char *)data,
+			     frames*sizeof(float)*ring_channels)/
     (sizeof(float)*ring_channels);
+  ring_frames_written.fetch_add(ret,std::memory_order_relaxed);
+  countFill(readSpace());
+
+  unsigned threshold=ring_wake_threshold.load(std::memory_order_acquire);
+  if((threshold>0)&&(readSpace()>=threshold)) {
+    wake();
+  }
+
+  return ret;
 }
 
 
@@ -454,3 +600,696 @@ unsigned Ringbuffer::dump(unsigned frames)
 
   return ret;
 }
+
+
+unsigned Ringbuffer::wakeThreshold() const
+{
+  return ring_wake_threshold.load(std::memory_order_acquire);
+}
+
+
+void Ringbuffer::setWakeThreshold(unsigned frames)
+{
+  //
+  // Once set to a non-zero value, notifyFd() will become readable
+  // whenever a write leaves at least 'frames' frames in the buffer.
+  //
+  // This may be called after the writer thread has started, so the
+  // eventfd is published before the threshold that makes the writer
+  // look for it.
+  //
+  if((frames>0)&&(ring_notify_fd.load(std::memory_order_acquire)<0)) {
+    int fd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    int expected=-1;
+    if((fd>=0)&&(!ring_notify_fd.compare_exchange_strong(expected,fd,
+				       std::memory_order_acq_rel))) {
+      close(fd);
+    }
+  }
+  ring_wake_threshold.store(frames,std::memory_order_release);
+}
+
+
+int Ringbuffer::notifyFd() const
+{
+  return ring_notify_fd.load(std::memory_order_acquire);
+}
+
+
+bool Ringbuffer::waitForData(int msecs)
+{
+  //
+  // Block until a writer has left at least wakeThreshold() frames in the
+  // buffer, or until 'msecs' has elapsed.  Returns false on timeout,
+  // which is counted as an underrun.
+  //
+  struct pollfd pfd;
+  int n;
+  unsigned threshold=ring_wake_threshold.load(std::memory_order_acquire);
+  int fd=ring_notify_fd.load(std::memory_order_acquire);
+
+  if((threshold>0)&&(readSpace()>=threshold)) {
+    return true;
+  }
+  if(fd<0) {
+    return false;
+  }
+  pfd.fd=fd;
+  pfd.events=POLLIN;
+  pfd.revents=0;
+  while((n=poll(&pfd,1,msecs))<0) {
+    if(errno!=EINTR) {
+      return false;
+    }
+  }
+  clearWake();
+  if((n==0)&&(readSpace()<threshold)) {
+    ring_underruns.fetch_add(1,std::memory_order_relaxed);
+  }
+
+  return n>0;
+}
+
+
+void Ringbuffer::wake()
+{
+  //
+  // Safe to call from a realtime context: only the first write after
+  // the reader has cleared the notification touches the eventfd, and
+  // eventfd writes never block.
+  //
+  int fd=ring_notify_fd.load(std::memory_order_acquire);
+
+  if((fd>=0)&&(!ring_wake_pending)) {
+    ring_wake_pending=true;
+    if(eventfd_write(fd,1)<0) {
+      ring_wake_pending=false;
+    }
+  }
+}
+
+
+void Ringbuffer::clearWake()
+{
+  //
+  // Called by the reader before it services the buffer.  Always recheck
+  // readSpace() afterwards, as a write may have landed in between.
+  //
+  eventfd_t count;
+  int fd=ring_notify_fd.load(std::memory_order_acquire);
+
+  ring_wake_pending=false;
+  if(fd>=0) {
+    eventfd_read(fd,&count);
+  }
+}
+
+
+
+uint64_t Ringbuffer::framesWritten() const
+{
+  return ring_frames_written.load(std::memory_order_relaxed);
+}
+
+
+uint64_t Ringbuffer::framesDropped() const
+{
+  return ring_frames_dropped.load(std::memory_order_relaxed);
+}
+
+
+uint64_t Ringbuffer::overruns() const
+{
+  return ring_overruns.load(std::memory_order_relaxed);
+}
+
+
+uint64_t Ringbuffer::underruns() const
+{
+  return ring_underruns.load(std::memory_order_relaxed);
+}
+
+
+unsigned Ringbuffer::highWater() const
+{
+  return ring_high_water.load(std::memory_order_relaxed);
+}
+
+
+void Ringbuffer::countOverrun(uint64_t frames)
+{
+  ring_overruns.fetch_add(1,std::memory_order_relaxed);
+  ring_frames_dropped.fetch_add(frames,std::memory_order_relaxed);
+}
+
+
+void Ringbuffer::countFill(unsigned frames)
+{
+  //
+  // Only ever called from one side of the buffer, so no CAS needed
+  //
+  if(frames>ring_high_water.load(std::memory_order_relaxed)) {
+    ring_high_water.store(frames,std::memory_order_relaxed);
+  }
+}
+
+
+
+BroadcastRingbufferReader::BroadcastRingbufferReader(BroadcastRingbuffer *src)
+  : Ringbuffer(src->channels())
+{
+  reader_source=src;
+  reader_start_ptr=src->bcast_end_ptr.load(std::memory_order_acquire);
+  reader_ptr=reader_start_ptr;
+  reader_lockstep=false;
+  reader_resync_ptr=0;
+}
+
+
+BroadcastRingbufferReader::~BroadcastRingbufferReader()
+{
+}
+
+
+unsigned BroadcastRingbufferReader::size() const
+{
+  return reader_source->size();
+}
+
+
+Ringbuffer::Layout BroadcastRingbufferReader::layout() const
+{
+  return reader_source->layout();
+}
+
+
+unsigned BroadcastRingbufferReader::read(float *data,unsigned frames)
+{
+  return Read(data,NULL,frames);
+}
+
+
+unsigned BroadcastRingbufferReader::readPlanar(float **data,unsigned frames)
+{
+  return Read(NULL,data,frames);
+}
+
+
+unsigned BroadcastRingbufferReader::readSpace() const
+{
+  uint64_t wptr=
+    reader_source->bcast_end_ptr.load(std::memory_order_acquire);
+  uint64_t rptr=reader_ptr.load(std::memory_order_acquire);
+
+  if(wptr<rptr) {
+    return 0;
+  }
+  if((wptr-rptr)>reader_source->bcast_size) {
+    return reader_source->bcast_size;
+  }
+  return wptr-rptr;
+}
+
+
+const float *BroadcastRingbufferReader::readSpan(unsigned *frames)
+{
+  //
+  // The span points into the shared buffer, which the writer may start
+  // overwriting at any time; see the seqlock notes in ringbuffer.h.
+  //
+  BroadcastRingbuffer *src=reader_source;
+  unsigned offset=reader_ptr.load(std::memory_order_relaxed)&src->bcast_mask;
+
+  if(src->bcast_layout!=Ringbuffer::Interleaved) {
+    *frames=0;
+    return NULL;
+  }
+  *frames=Available();
+  if(*frames==0) {
+    return NULL;
+  }
+  if((offset+*frames)>src->bcast_size) {
+    *frames=src->bcast_size-offset;
+  }
+  return src->bcast_buffer+offset*channels();
+}
+
+
+bool BroadcastRingbufferReader::readPlanarSpan(const float **planes,
+					       unsigned *frames)
+{
+  //
+  // As readSpan(), but for planar buffers: 'planes' gets a pointer to
+  // the span in each channel's plane.
+  //
+  BroadcastRingbuffer *src=reader_source;
+  unsigned offset=reader_ptr.load(std::memory_order_relaxed)&src->bcast_mask;
+
+  *frames=0;
+  if(src->bcast_layout!=Ringbuffer::Planar) {
+    return false;
+  }
+  if((*frames=Available())==0) {
+    return false;
+  }
+  if((offset+*frames)>src->bcast_size) {
+    *frames=src->bcast_size-offset;
+  }
+  for(unsigned i=0;i<channels();i++) {
+    planes[i]=src->bcast_buffer+i*src->bcast_size+offset;
+  }
+  return true;
+}
+
+
+unsigned BroadcastRingbufferReader::readAdvance(unsigned frames)
+{
+  //
+  // As with read(), check whether the writer got into the span while
+  // the caller was using it.  The damage is already done by then, but
+  // it still counts as an overrun.
+  //
+  BroadcastRingbuffer *src=reader_source;
+  uint64_t rptr=reader_ptr.load(std::memory_order_relaxed);
+  uint64_t begin;
+
+  begin=src->bcast_begin_ptr.load(std::memory_order_acquire);
+  if((begin-rptr)>src->bcast_size) {
+    Resync(begin-src->bcast_size);
+    return 0;
+  }
+  reader_ptr.store(rptr+frames,std::memory_order_release);
+
+  return frames;
+}
+
+
+unsigned BroadcastRingbufferReader::write(float *,unsigned)
+{
+  return 0;  // Only the BroadcastRingbuffer itself may write
+}
+
+
+unsigned BroadcastRingbufferReader::writeSpace() const
+{
+  return 0;
+}
+
+
+unsigned BroadcastRingbufferReader::dump(unsigned frames)
+{
+  unsigned avail=Available();
+
+  if(frames>avail) {
+    frames=avail;
+  }
+  reader_ptr.fetch_add(frames,std::memory_order_release);
+
+  return frames;
+}
+
+
+uint64_t BroadcastRingbufferReader::framesWritten() const
+{
+  return reader_source->bcast_end_ptr.load(std::memory_order_relaxed)-
+    reader_start_ptr;
+}
+
+
+unsigned BroadcastRingbufferReader::Read(float *data,float **planes,
+					 unsigned frames)
+{
+  BroadcastRingbuffer *src=reader_source;
+  unsigned avail=Available();
+  uint64_t rptr=reader_ptr.load(std::memory_order_relaxed);
+  uint64_t begin;
+  unsigned offset;
+  unsigned n1;
+
+  if(frames>avail) {
+    frames=avail;
+  }
+  if(frames==0) {
+    return 0;
+  }
+
+  //
+  // Copy out, wrapping as needed
+  //
+  offset=rptr&src->bcast_mask;
+  n1=frames;
+  if((offset+frames)>src->bcast_size) {
+    n1=src->bcast_size-offset;
+  }
+  src->CopyOut(data,planes,0,offset,n1);
+  if(n1<frames) {
+    src->CopyOut(data,planes,n1,0,frames-n1);
+  }
+
+  //
+  // If the writer started overwriting any of the span we just copied
+  // while we were copying it, the copy may be torn, so discard it.
+  //
+  begin=src->bcast_begin_ptr.load(std::memory_order_acquire);
+  if((begin-rptr)>src->bcast_size) {
+    Resync(begin-src->bcast_size);
+    return 0;
+  }
+  reader_ptr.store(rptr+frames,std::memory_order_release);
+
+  return frames;
+}
+
+
+unsigned BroadcastRingbufferReader::Available()
+{
+  //
+  // Returns the number of frames available to this reader, first
+  // skipping past anything the writer has already overwritten.
+  //
+  uint64_t rptr;
+  uint64_t wptr;
+
+  if(reader_lockstep) {
+    Follow();
+  }
+  rptr=reader_ptr.load(std::memory_order_relaxed);
+  wptr=reader_source->bcast_end_ptr.load(std::memory_order_acquire);
+  if(wptr<rptr) {
+    return 0;
+  }
+  if((wptr-rptr)>reader_source->bcast_size) {
+    Resync(wptr);
+    return 0;
+  }
+  countFill(wptr-rptr);
+  return wptr-rptr;
+}
+
+
+void BroadcastRingbufferReader::Resync(uint64_t ptr)
+{
+  //
+  // We've been lapped by the writer.  Skip ahead to 'ptr', or in
+  // lockstep to the newest data, so that the others can meet us there.
+  //
+  BroadcastRingbuffer *src=reader_source;
+  uint64_t rptr=reader_ptr.load(std::memory_order_relaxed);
+  uint64_t resync;
+
+  if(reader_lockstep) {
+    ptr=src->bcast_end_ptr.load(std::memory_order_acquire);
+    resync=src->bcast_resync_ptr.load(std::memory_order_relaxed);
+    while((resync<ptr)&&
+	  (!src->bcast_resync_ptr.compare_exchange_weak(resync,ptr,
+					    std::memory_order_release,
+					    std::memory_order_relaxed)));
+    reader_resync_ptr=ptr;
+  }
+  if(ptr>rptr) {
+    countOverrun(ptr-rptr);
+    reader_ptr.store(ptr,std::memory_order_release);
+  }
+  else {
+    countOverrun(0);
+  }
+}
+
+
+
+
+void BroadcastRingbufferReader::Follow()
+{
+  //
+  // Catch up with the latest resync of any other reader in lockstep.
+  // If we had already got past that point we lose nothing, but still
+  // count an overrun, so that whoever is reading us knows about the
+  // jump in the other readers.
+  //
+  uint64_t resync=
+    reader_source->bcast_resync_ptr.load(std::memory_order_acquire);
+  uint64_t rptr;
+
+  if(resync>reader_resync_ptr) {
+    reader_resync_ptr=resync;
+    rptr=reader_ptr.load(std::memory_order_relaxed);
+    if(resync>rptr) {
+      countOverrun(resync-rptr);
+      reader_ptr.store(resync,std::memory_order_release);
+    }
+    else {
+      countOverrun(0);
+    }
+  }
+}
+
+
+BroadcastRingbuffer::BroadcastRingbuffer(size_t bytes,unsigned channels)
+{
+  bcast_channels=channels;
+  bcast_layout=Ringbuffer::Interleaved;
+  bcast_buffer=NULL;
+  setSize(bytes);
+  bcast_begin_ptr=0;
+  bcast_end_ptr=0;
+  bcast_resync_ptr=0;
+}
+
+
+BroadcastRingbuffer::~BroadcastRingbuffer()
+{
+  for(unsigned i=0;i<bcast_readers.size();i++) {
+    delete bcast_readers.at(i);
+  }
+  delete[] bcast_buffer;
+}
+
+
+unsigned BroadcastRingbuffer::size() const
+{
+  return bcast_size;
+}
+
+
+void BroadcastRingbuffer::setSize(size_t bytes)
+{
+  //
+  // Must be set before the writer is started
+  //
+  size_t frames=bytes/(sizeof(float)*bcast_channels);
+
+  delete[] bcast_buffer;
+  for(bcast_size=1;bcast_size<frames;bcast_size*=2);
+  bcast_mask=bcast_size-1;
+  bcast_buffer=new float[bcast_size*bcast_channels];
+}
+
+
+unsigned BroadcastRingbuffer::channels() const
+{
+  return bcast_channels;
+}
+
+
+Ringbuffer::Layout BroadcastRingbuffer::layout() const
+{
+  return bcast_layout;
+}
+
+
+void BroadcastRingbuffer::setLayout(Ringbuffer::Layout layout)
+{
+  //
+  // Must be set before the writer is started
+  //
+  bcast_layout=layout;
+}
+
+
+unsigned BroadcastRingbuffer::write(const float *data,unsigned frames)
+{
+  return Write(data,NULL,frames);
+}
+
+
+unsigned BroadcastRingbuffer::writePlanar(const float *const *data,
+					  unsigned frames)
+{
+  return Write(NULL,data,frames);
+}
+
+
+unsigned BroadcastRingbuffer::writeSpace() const
+{
+  //
+  // write() never blocks, so this is advisory: the number of frames that
+  // can be written without overrunning the slowest reader.  Writers that
+  // would rather wait than lose data can use it for backpressure.
+  //
+  uint64_t wptr=bcast_end_ptr.load(std::memory_order_relaxed);
+  uint64_t used=0;
+  uint64_t n;
+
+  for(unsigned i=0;i<bcast_readers.size();i++) {
+    n=wptr-bcast_readers[i]->reader_ptr.load(std::memory_order_acquire);
+    if(n>used) {
+      used=n;
+    }
+  }
+  if(used>=bcast_size) {
+    return 0;
+  }
+  return bcast_size-used;
+}
+
+
+uint64_t BroadcastRingbuffer::framesWritten() const
+{
+  return bcast_end_ptr.load(std::memory_order_relaxed);
+}
+
+
+BroadcastRingbufferReader *BroadcastRingbuffer::addReader(bool lockstep)
+{
+  //
+  // Readers must all be added before the writer is started
+  //
+  bcast_readers.push_back(new BroadcastRingbufferReader(this));
+  bcast_readers.back()->reader_lockstep=lockstep;
+  return bcast_readers.back();
+}
+
+
+unsigned BroadcastRingbuffer::readerQuantity() const
+{
+  return bcast_readers.size();
+}
+
+
+BroadcastRingbufferReader *BroadcastRingbuffer::reader(unsigned n) const
+{
+  return bcast_readers.at(n);
+}
+
+
+unsigned BroadcastRingbuffer::Write(const float *data,
+				    const float *const *planes,unsigned frames)
+{
+  uint64_t wptr=bcast_end_ptr.load(std::memory_order_relaxed);
+  unsigned from=0;
+  unsigned offset;
+  unsigned n1;
+
+  //
+  // Never blocks.  If more than a buffer's worth is offered, only the
+  // newest part can be kept.
+  //
+  if(frames>bcast_size) {
+    from=frames-bcast_size;
+    wptr+=frames-bcast_size;
+    frames=bcast_size;
+  }
+
+  //
+  // Announce the span being overwritten before touching it, so that
+  // readers can detect a torn copy.
+  //
+  bcast_begin_ptr.store(wptr+frames,std::memory_order_release);
+
+  offset=wptr&bcast_mask;
+  n1=frames;
+  if((offset+frames)>bcast_size) {
+    n1=bcast_size-offset;
+  }
+  CopyIn(offset,data,planes,from,n1);
+  if(n1<frames) {
+    CopyIn(0,data,planes,from+n1,frames-n1);
+  }
+  bcast_end_ptr.store(wptr+frames,std::memory_order_release);
+
+  //
+  // Wake any readers that now have enough data
+  //
+  for(unsigned i=0;i<bcast_readers.size();i++) {
+    BroadcastRingbufferReader *r=bcast_readers[i];
+    if((r->wakeThreshold()>0)&&(r->readSpace()>=r->wakeThreshold())) {
+      r->wake();
+    }
+  }
+
+  return frames;
+}
+
+
+void BroadcastRingbuffer::CopyIn(unsigned offset,const float *data,
+				 const float *const *planes,unsigned from,
+				 unsigned frames)
+{
+  //
+  // Copy 'frames' frames, starting at frame 'from' of the interleaved
+  // 'data' or planar 'planes', to 'offset' in the buffer (no wrapping).
+  //
+  if(bcast_layout==Ringbuffer::Planar) {
+    for(unsigned i=0;i<bcast_channels;i++) {
+      float *plane=bcast_buffer+i*bcast_size+offset;
+      if(data==NULL) {
+	memcpy(plane,planes[i]+from,frames*sizeof(float));
+      }
+      else {
+	for(unsigned j=0;j<frames;j++) {
+	  plane[j]=data[bcast_channels*(from+j)+i];
+	}
+      }
+    }
+  }
+  else {
+    float *pcm=bcast_buffer+offset*bcast_channels;
+    if(data==NULL) {
+      for(unsigned i=0;i<frames;i++) {
+	for(unsigned j=0;j<bcast_channels;j++) {
+	  pcm[bcast_channels*i+j]=planes[j][from+i];
+	}
+      }
+    }
+    else {
+      memcpy(pcm,data+from*bcast_channels,
+	     frames*bcast_channels*sizeof(float));
+    }
+  }
+}
+
+
+void BroadcastRingbuffer::CopyOut(float *data,float **planes,unsigned to,
+				  unsigned offset,unsigned frames) const
+{
+  //
+  // Copy 'frames' frames from 'offset' in the buffer (no wrapping) to
+  // frame 'to' of the interleaved 'data' or planar 'planes'.
+  //
+  if(bcast_layout==Ringbuffer::Planar) {
+    for(unsigned i=0;i<bcast_channels;i++) {
+      const float *plane=bcast_buffer+i*bcast_size+offset;
+      if(data==NULL) {
+	memcpy(planes[i]+to,plane,frames*sizeof(float));
+      }
+      else {
+	for(unsigned j=0;j<frames;j++) {
+	  data[bcast_channels*(to+j)+i]=plane[j];
+	}
+      }
+    }
+  }
+  else {
+    const float *pcm=bcast_buffer+offset*bcast_channels;
+    if(data==NULL) {
+      for(unsigned i=0;i<frames;i++) {
+	for(unsigned j=0;j<bcast_channels;j++) {
+	  planes[j][to+i]=pcm[bcast_channels*i+j];
+	}
+      }
+    }
+    else {
+      memcpy(data+to*bcast_channels,pcm,frames*bcast_channels*sizeof(float));
+    }
+  }
+}
@@ -27,8 +27,19 @@
 #ifndef RINGBUFFER_H
 #define RINGBUFFER_H
 
+#include <stdint.h>
 #include <sys/types.h>
 
+#include <atomic>
+#include <vector>
+
+//
+// Assumed cache line size.  The read and write indices are kept on
+// separate lines so that the producer and consumer cores do not
+// contend for the same line on every update.
+//
+#define GLASS_RINGBUFFER_CACHE_LINE 64
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -42,11 +53,12 @@ glass_ringbuffer_data_t ;
 
 typedef struct {
     char	*buf;
-    volatile size_t write_ptr;
-    volatile size_t read_ptr;
     size_t	size;
     size_t	size_mask;
     int	mlocked;
+    alignas(GLASS_RINGBUFFER_CACHE_LINE) std::atomic<size_t> write_ptr;
+    alignas(GLASS_RINGBUFFER_CACHE_LINE) std::atomic<size_t> read_ptr;
+    char	pad[GLASS_RINGBUFFER_CACHE_LINE-sizeof(std::atomic<size_t>)];
 }
 glass_ringbuffer_t ;
 glass_ringbuffer_t *glass_ringbuffer_create(int sz);
@@ -74,18 +86,153 @@ size_t glass_ringbuffer_write_space(const glass_ringbuffer_t *rb);
 class Ringbuffer
 {
  public:
+  enum Layout {Interleaved=0,Planar=1};
   Ringbuffer(size_t bytes,unsigned channels);
-  ~Ringbuffer();
+  virtual ~Ringbuffer();
+  virtual unsigned size() const;
+  unsigned channels() const;
+  virtual Ringbuffer::Layout layout() const;
+  virtual unsigned read(float *data,unsigned frames);
+  virtual unsigned readPlanar(float **data,unsigned frames);
+  virtual unsigned readSpace() const;
+  virtual const float *readSpan(unsigned *frames);
+  virtual bool readPlanarSpan(const float **planes,unsigned *frames);
+  virtual unsigned readAdvance(unsigned frames);
+  virtual unsigned write(float *data,unsigned frames);
+  virtual unsigned writeSpace() const;
+  virtual unsigned dump(unsigned frames);
+  unsigned wakeThreshold() const;
+  void setWakeThreshold(unsigned frames);
+  int notifyFd() const;
+  bool waitForData(int msecs);
+  void wake();
+  void clearWake();
+  virtual uint64_t framesWritten() const;
+  uint64_t framesDropped() const;
+  uint64_t overruns() const;
+  uint64_t underruns() const;
+  unsigned highWater() const;
+
+ protected:
+  Ringbuffer(unsigned channels);
+  void countOverrun(uint64_t frames);
+  void countFill(unsigned frames);
+
+ private:
+  glass_ringbuffer_t *ring_ring;
+  unsigned ring_channels;
+  std::atomic<unsigned> ring_wake_threshold;
+  std::atomic<int> ring_notify_fd;
+  std::atomic<bool> ring_wake_pending;
+  std::atomic<uint64_t> ring_frames_written;
+  std::atomic<uint64_t> ring_frames_dropped;
+  std::atomic<uint64_t> ring_overruns;
+  std::atomic<uint64_t> ring_underruns;
+  std::atomic<unsigned> ring_high_water;
+};
+
+
+
+
+//
+// Single writer, multiple reader ringbuffer.  The writer never blocks;
+// a reader that falls more than a buffer's length behind loses the
+// overwritten data, which is counted in its overruns() and
+// framesDropped() figures.
+//
+// Frames can be stored either interleaved or planar (one contiguous
+// plane per channel), so that planar sources can feed planar encoders
+// without reshuffling every sample.  Either layout may be written or
+// read in either form; only the span methods require a match.
+//
+// Readers added in lockstep (e.g. the renditions of one stream) never
+// drift apart: when one of them is lapped, the others are moved to the
+// same resume point, and each of them counts an overrun.
+//
+// Buffer contents are guarded seqlock-style rather than by a lock: the
+// writer publishes the start of the span it is about to overwrite in
+// bcast_begin_ptr (a release store) before copying in, and read() and
+// readPlanar() check it (an acquire load) after copying out, discarding
+// the copy if the writer got there first.  The copies themselves are
+// plain memory accesses, so a reader that is lapped mid-copy does race
+// with the writer; the check only guarantees that such a copy is never
+// returned.  readSpan() and readPlanarSpan() hand out pointers straight
+// into the shared buffer, with no such protection: readAdvance() can
+// only report after the fact that the span was overwritten while in
+// use.  They are safe only where the writer can't lap the reader, e.g.
+// in tests that pace the writer; everything else should copy out.
+//
+class BroadcastRingbuffer;
+
+class BroadcastRingbufferReader : public Ringbuffer
+{
+ public:
+  ~BroadcastRingbufferReader();
   unsigned size() const;
+  Ringbuffer::Layout layout() const;
   unsigned read(float *data,unsigned frames);
+  unsigned readPlanar(float **data,unsigned frames);
   unsigned readSpace() const;
+  const float *readSpan(unsigned *frames);
+  bool readPlanarSpan(const float **planes,unsigned *frames);
+  unsigned readAdvance(unsigned frames);
   unsigned write(float *data,unsigned frames);
   unsigned writeSpace() const;
   unsigned dump(unsigned frames);
+  uint64_t framesWritten() const;
 
  private:
-  glass_ringbuffer_t *ring_ring;
-  unsigned ring_channels;
+  BroadcastRingbufferReader(BroadcastRingbuffer *src);
+  unsigned Read(float *data,float **planes,unsigned frames);
+  unsigned Available();
+  void Resync(uint64_t ptr);
+  void Follow();
+  BroadcastRingbuffer *reader_source;
+  uint64_t reader_start_ptr;
+  std::atomic<uint64_t> reader_ptr;
+  bool reader_lockstep;
+  uint64_t reader_resync_ptr;
+  friend class BroadcastRingbuffer;
+};
+
+
+
+
+class BroadcastRingbuffer
+{
+ public:
+  BroadcastRingbuffer(size_t bytes,unsigned channels);
+  ~BroadcastRingbuffer();
+  unsigned size() const;
+  void setSize(size_t bytes);
+  unsigned channels() const;
+  Ringbuffer::Layout layout() const;
+  void setLayout(Ringbuffer::Layout layout);
+  unsigned write(const float *data,unsigned frames);
+  unsigned writePlanar(const float *const *data,unsigned frames);
+  unsigned writeSpace() const;
+  uint64_t framesWritten() const;
+  BroadcastRingbufferReader *addReader(bool lockstep=false);
+  unsigned readerQuantity() const;
+  BroadcastRingbufferReader *reader(unsigned n) const;
+
+ private:
+  unsigned Write(const float *data,const float *const *planes,
+		 unsigned frames);
+  void CopyIn(unsigned offset,const float *data,const float *const *planes,
+	      unsigned from,unsigned frames);
+  void CopyOut(float *data,float **planes,unsigned to,unsigned offset,
+	       unsigned frames) const;
+  float *bcast_buffer;
+  unsigned bcast_size;
+  unsigned bcast_mask;
+  unsigned bcast_channels;
+  Ringbuffer::Layout bcast_layout;
+  std::atomic<uint64_t> bcast_begin_ptr;
+  std::atomic<uint64_t> bcast_end_ptr;
+  std::atomic<uint64_t> bcast_resync_ptr;
+  std::vector<BroadcastRingbufferReader *> bcast_readers;
+  friend class BroadcastRingbufferReader;
 };
 
 
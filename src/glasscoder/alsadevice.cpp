@@ -27,8 +27,8 @@ void *AlsaCallback(void *ptr)
 #ifdef ALSA
   static AlsaDevice *dev=(AlsaDevice *)ptr;
   static int n;
-  static float pcm1[32768];
-  static float pcm2[32768];
+  static float *pcm1=dev->alsa_pcm_float;
+  static float *pcm2=dev->alsa_pcm_remix;
   static float lvls[MAX_AUDIO_CHANNELS];
   static unsigned i;
 
@@ -51,12 +51,12 @@ void *AlsaCallback(void *ptr)
 			    dev->alsa_channels);
       }
       if(dev->alsa_channels==dev->channels()) {
-	dev->ringBuffer()->write(pcm1,n);
+	dev->writeRingBuffer(pcm1,n);
 	dev->peakLevels(lvls,pcm1,n,dev->channels());
       }
       else {
 	dev->remixChannels(pcm2,dev->channels(),pcm1,dev->alsa_channels,n);
-	dev->ringBuffer()->write(pcm2,n);
+	dev->writeRingBuffer(pcm2,n);
 	dev->peakLevels(lvls,pcm2,n,dev->channels());
       }
       for(i=0;i<dev->channels();i++) {
@@ -71,12 +71,14 @@ void *AlsaCallback(void *ptr)
 
 
 AlsaDevice::AlsaDevice(unsigned chans,unsigned samprate,
-		       Ringbuffer *ring,QObject *parent)
+		       BroadcastRingbuffer *ring,QObject *parent)
   : AudioDevice(chans,samprate,ring,parent)
 {
 #ifdef ALSA
   alsa_device=ALSA_DEFAULT_DEVICE;
   alsa_pcm_buffer=NULL;
+  alsa_pcm_float=NULL;
+  alsa_pcm_remix=NULL;
 
   for(int i=0;i<MAX_AUDIO_CHANNELS;i++) {
     alsa_meter_avg[i]=new MeterAverage(8);
@@ -94,7 +96,13 @@ AlsaDevice::~AlsaDevice()
     delete alsa_meter_avg[i];
   }
   if(alsa_pcm_buffer!=NULL) {
-    delete alsa_pcm_buffer;
+    delete[] alsa_pcm_buffer;
+  }
+  if(alsa_pcm_float!=NULL) {
+    delete[] alsa_pcm_float;
+  }
+  if(alsa_pcm_remix!=NULL) {
+    delete[] alsa_pcm_remix;
   }
 #endif  // ALSA
 }
@@ -130,6 +138,8 @@ bool AlsaDevice::start(QString *err)
   int dir;
   int aerr;
   pthread_attr_t pthread_attr;
+  unsigned want_period_quantity;
+  snd_pcm_uframes_t want_buffer_size;
 
   if(snd_pcm_open(&alsa_pcm,alsa_device.toUtf8(),SND_PCM_STREAM_CAPTURE,0)!=0) {
     *err=tr("unable to open ALSA device")+" \""+alsa_device+"\"";
@@ -192,18 +202,29 @@ bool AlsaDevice::start(QString *err)
   //
   // Buffer Parameters
   //
-  alsa_period_quantity=ALSA_PERIOD_QUANTITY;
+  // Taken from the latency budget when one was given, otherwise a
+  // half-second buffer in ALSA_PERIOD_QUANTITY periods.
+  //
+  if(captureBufferSize()>0) {
+    alsa_period_quantity=captureBufferSize()/capturePeriodSize();
+    want_buffer_size=captureBufferSize();
+  }
+  else {
+    alsa_period_quantity=ALSA_PERIOD_QUANTITY;
+    want_buffer_size=alsa_samplerate/2;
+  }
+  want_period_quantity=alsa_period_quantity;
   snd_pcm_hw_params_set_periods_near(alsa_pcm,hwparams,&alsa_period_quantity,
 				     &dir);
-  if(alsa_period_quantity!=ALSA_PERIOD_QUANTITY) {
+  if(alsa_period_quantity!=want_period_quantity) {
     Log(LOG_INFO,
 	QString().sprintf("using ALSA period quantity of %u",
 			  alsa_period_quantity));
   }
   //  alsa_buffer_size=ALSA_PERIOD_SIZE*alsa_period_quantity;
-  alsa_buffer_size=alsa_samplerate/2;
+  alsa_buffer_size=want_buffer_size;
   snd_pcm_hw_params_set_buffer_size_near(alsa_pcm,hwparams,&alsa_buffer_size);
-  if(alsa_buffer_size!=(alsa_samplerate/2)) {
+  if(alsa_buffer_size!=want_buffer_size) {
     Log(LOG_INFO,
 	QString().sprintf("using ALSA buffer size of %lu frames",
 			  alsa_buffer_size));
@@ -216,14 +237,28 @@ bool AlsaDevice::start(QString *err)
     *err=tr("ALSA device error 1")+": "+snd_strerror(aerr);
     return false;
   }
+  //
+  // Each read is at most half a period, but size the scratch buffers
+  // for the whole negotiated buffer so that no latency target (and no
+  // rate or channel count the device pushes back) can overrun them.
+  //
   alsa_pcm_buffer=new float[alsa_buffer_size*alsa_channels];
+  alsa_pcm_float=new float[alsa_buffer_size*alsa_channels];
+  alsa_pcm_remix=new float[alsa_buffer_size*channels()];
+  allocateRingBuffer();
 
   //
   // Set Wake-up Timing
   //
   snd_pcm_sw_params_alloca(&swparams);
   snd_pcm_sw_params_current(alsa_pcm,swparams);
-  snd_pcm_sw_params_set_avail_min(alsa_pcm,swparams,alsa_buffer_size/2);
+  if(captureBufferSize()>0) {
+    snd_pcm_sw_params_set_avail_min(alsa_pcm,swparams,
+				    alsa_buffer_size/alsa_period_quantity);
+  }
+  else {
+    snd_pcm_sw_params_set_avail_min(alsa_pcm,swparams,alsa_buffer_size/2);
+  }
   if((aerr=snd_pcm_sw_params(alsa_pcm,swparams))<0) {
     *err=tr("ALSA device error 2")+": "+snd_strerror(aerr);
     return false;
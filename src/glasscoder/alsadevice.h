@@ -38,7 +38,7 @@ class AlsaDevice : public AudioDevice
   Q_OBJECT;
  public:
   AlsaDevice(unsigned chans,unsigned samprate,
-	     Ringbuffer *ring,QObject *parent=0);
+	     BroadcastRingbuffer *ring,QObject *parent=0);
   ~AlsaDevice();
   bool processOptions(QString *err,const QStringList &keys,
 		      const QStringList &values);
@@ -58,6 +58,8 @@ class AlsaDevice : public AudioDevice
   unsigned alsa_period_quantity;
   snd_pcm_uframes_t alsa_buffer_size; 
   float *alsa_pcm_buffer;
+  float *alsa_pcm_float;
+  float *alsa_pcm_remix;
   pthread_t alsa_pthread;
   MeterAverage *alsa_meter_avg[MAX_AUDIO_CHANNELS];
   QTimer *alsa_meter_timer;
@@ -27,7 +27,7 @@
 #include "logging.h"
 
 AsiHpiDevice::AsiHpiDevice(unsigned chans,unsigned samprate,
-			   Ringbuffer *ring,QObject *parent)
+			   BroadcastRingbuffer *ring,QObject *parent)
   : AudioDevice(chans,samprate,ring,parent)
 {
 #ifdef ASIHPI
@@ -269,6 +269,7 @@ bool AsiHpiDevice::start(QString *err)
     *err=tr("HPI error")+": "+hpi_strerror(herr);
     return false;
   }
+  allocateRingBuffer();
 
   //
   // Start input stream
@@ -313,7 +314,7 @@ void AsiHpiDevice::readData()
   if(state==HPI_STATE_RECORDING) {
     if(HpiLog(HPI_InStreamReadBuf(NULL,asihpi_input_stream,asihpi_pcm_buffer,
 				  data_recorded))==0) {
-      ringBuffer()->write((float *)asihpi_pcm_buffer,
+      writeRingBuffer((float *)asihpi_pcm_buffer,
 			  data_recorded/(sizeof(float)*channels()));
     }
   }
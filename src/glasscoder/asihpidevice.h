@@ -41,7 +41,7 @@ class AsiHpiDevice : public AudioDevice
   Q_OBJECT;
  public:
   AsiHpiDevice(unsigned chans,unsigned samprate,
-	       Ringbuffer *ring,QObject *parent=0);
+	       BroadcastRingbuffer *ring,QObject *parent=0);
   ~AsiHpiDevice();
   bool isAvailable() const;
   bool processOptions(QString *err,const QStringList &keys,
@@ -25,7 +25,7 @@
 #include "audiodevicefactory.h"
 AudioDevice *AudioDeviceFactory(AudioDevice::DeviceType type,
 				unsigned chans,unsigned samprate,
-				Ringbuffer *ring,
+				BroadcastRingbuffer *ring,
 				QObject *parent)
 {
   AudioDevice *dev=NULL;
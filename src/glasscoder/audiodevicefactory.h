@@ -25,7 +25,8 @@
 
 AudioDevice *AudioDeviceFactory(AudioDevice::DeviceType type,
 				unsigned chans,unsigned samprate,
-				Ringbuffer *ring,QObject *parent=0);
+				BroadcastRingbuffer *ring,
+				QObject *parent=0);
 
 
 #endif  // AUDIODEVICEFACTORY_H
@@ -33,7 +33,6 @@ Config::Config()
   unsigned num;
   bool ok=false;
   audio_atomic_frames=false;
-  audio_bitrate=0;
   audio_channels=MAX_AUDIO_CHANNELS;
   audio_device=DEFAULT_AUDIO_DEVICE;
   audio_format=Codec::TypeVorbis;
@@ -41,6 +40,8 @@ Config::Config()
   audio_samplerate=DEFAULT_AUDIO_SAMPLERATE;
   server_exit_on_last=false;
   server_max_connections=-1;
+  server_max_uploads=SERVER_MAX_UPLOADS_DEFAULT;
+  server_memfd=false;
   server_password="";
   credentials_file="";
   delete_credentials=false;
@@ -60,11 +61,19 @@ Config::Config()
   stream_name="";
   stream_timestamp_offset=0;
   stream_url="";
+  latency_target=0;
+  hls_fast_start=false;
+  hls_fmp4=false;
+  hls_origin_port=0;
+  hls_part_duration=0;
+  hls_segment_duration=HLS_SEGMENT_DURATION_DEFAULT;
+  hls_window=HLS_WINDOW_DEFAULT;
   list_codecs=false;
   list_devices=false;
   metadata_port=0;
   global_log_string="";
   meter_data=false;
+  meter_loudness=false;
   dump_headers=false;
   show_verbose=false;
   server_user_agent=QString("GlassCoder/")+VERSION;
@@ -76,13 +85,20 @@ Config::Config()
       cmd->setProcessed(i,true);
     }
     if(cmd->key(i)=="--audio-bitrate") {
-      num=cmd->value(i).toUInt(&ok);
-      if(ok) {
-	audio_bitrate=num;
-      }
-      else {
-	Log(LOG_ERR,"invalid --audio-bitrate value");
-	exit(256);
+      QStringList f0=cmd->value(i).split(",",QString::SkipEmptyParts);
+      for(int j=0;j<f0.size();j++) {
+	num=f0.at(j).trimmed().toUInt(&ok);
+	if((!ok)||(num==0)) {
+	  Log(LOG_ERR,"invalid --audio-bitrate value");
+	  exit(256);
+	}
+	for(unsigned k=0;k<audio_bitrates.size();k++) {
+	  if(audio_bitrates.at(k)==num) {
+	    Log(LOG_ERR,"duplicate --audio-bitrate value");
+	    exit(256);
+	  }
+	}
+	audio_bitrates.push_back(num);
       }
       cmd->setProcessed(i,true);
     }
@@ -169,6 +185,58 @@ Config::Config()
 	cmd->setProcessed(i,true);
       }
     }
+    if(cmd->key(i)=="--hls-fast-start") {
+      hls_fast_start=true;
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--hls-fmp4") {
+      hls_fmp4=true;
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--hls-origin-port") {
+      hls_origin_port=cmd->value(i).toUInt(&ok);
+      if((!ok)||(hls_origin_port>0xFFFF)) {
+	Log(LOG_ERR,"invalid --hls-origin-port argument");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--hls-part-duration") {
+      hls_part_duration=cmd->value(i).toUInt(&ok);
+      if((!ok)||((hls_part_duration>0)&&
+		 ((hls_part_duration<HLS_PART_DURATION_MIN)||
+		  (hls_part_duration>HLS_PART_DURATION_MAX)))) {
+	Log(LOG_ERR,"invalid --hls-part-duration argument");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--hls-segment-duration") {
+      hls_segment_duration=cmd->value(i).toUInt(&ok);
+      if((!ok)||(hls_segment_duration<HLS_SEGMENT_DURATION_MIN)||
+	 (hls_segment_duration>HLS_SEGMENT_DURATION_MAX)) {
+	Log(LOG_ERR,"invalid --hls-segment-duration argument");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--hls-window") {
+      hls_window=cmd->value(i).toUInt(&ok);
+      if((!ok)||(hls_window<HLS_WINDOW_MIN)||(hls_window>HLS_WINDOW_MAX)) {
+	Log(LOG_ERR,"invalid --hls-window argument");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--latency-target") {
+      latency_target=cmd->value(i).toUInt(&ok);
+      if((!ok)||(latency_target<LATENCY_TARGET_MIN)||
+	 (latency_target>LATENCY_TARGET_MAX)) {
+	Log(LOG_ERR,"invalid --latency-target value");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
     if(cmd->key(i)=="--list-codecs") {
       list_codecs=true;
       cmd->setProcessed(i,true);
@@ -189,6 +257,10 @@ Config::Config()
       meter_data=true;
       cmd->setProcessed(i,true);
     }
+    if(cmd->key(i)=="--meter-loudness") {
+      meter_loudness=true;
+      cmd->setProcessed(i,true);
+    }
     if(cmd->key(i)=="--server-auth") {
       QStringList f0=cmd->value(i).split(":");
       if(f0.size()==2) {
@@ -212,6 +284,19 @@ Config::Config()
       }
       cmd->setProcessed(i,true);
     }
+    if(cmd->key(i)=="--server-max-uploads") {
+      server_max_uploads=cmd->value(i).toUInt(&ok);
+      if((!ok)||(server_max_uploads<SERVER_MAX_UPLOADS_MIN)||
+	 (server_max_uploads>SERVER_MAX_UPLOADS_MAX)) {
+	Log(LOG_ERR,"invalid argument for --server-max-uploads");
+	exit(256);
+      }
+      cmd->setProcessed(i,true);
+    }
+    if(cmd->key(i)=="--server-memfd") {
+      server_memfd=true;
+      cmd->setProcessed(i,true);
+    }
     if(cmd->key(i)=="--server-preclean-publish-point") {
       server_preclean_publish_point=true;
       cmd->setProcessed(i,true);
@@ -236,7 +321,7 @@ Config::Config()
 	if(server_url.scheme().toLower()=="sftp") {
 	  server_url.setPort(22);
 	}
-	if(server_url.port()<0) {
+	if((server_url.port()<0)&&(!server_url.scheme().isEmpty())) {
 	  Log(LOG_ERR,
 	      "unknown/unsupported URL scheme \""+server_url.scheme()+"\"");
 	  exit(256);
@@ -400,12 +485,50 @@ Config::Config()
     Log(LOG_ERR,"missing --server-url parameter");
     exit(256);
   }
-  if((audio_quality>=0.0)&&(audio_bitrate>0)) {
+  if((hls_origin_port>0)&&(server_type!=Connector::HlsServer)) {
+    Log(LOG_ERR,"--hls-origin-port requires a --server-type of \"hls\"");
+    exit(256);
+  }
+  if(server_memfd&&(server_type!=Connector::HlsServer)) {
+    Log(LOG_ERR,"--server-memfd requires a --server-type of \"hls\"");
+    exit(256);
+  }
+  if(hls_fmp4&&(server_type!=Connector::HlsServer)) {
+    Log(LOG_ERR,"--hls-fmp4 requires a --server-type of \"hls\"");
+    exit(256);
+  }
+  if(hls_fmp4&&(audio_format!=Codec::TypeFdk)&&
+     (audio_format!=Codec::TypeOpus)) {
+    Log(LOG_ERR,"--hls-fmp4 requires an --audio-format of \"aacp\" or "
+	"\"opus\"");
+    exit(256);
+  }
+  if((hls_part_duration>0)&&(hls_origin_port==0)) {
+    Log(LOG_ERR,"--hls-part-duration requires --hls-origin-port");
+    exit(256);
+  }
+  if(hls_part_duration>=(1000*hls_segment_duration)) {
+    Log(LOG_ERR,
+	"--hls-part-duration must be shorter than --hls-segment-duration");
+    exit(256);
+  }
+  if((!server_url.isEmpty())&&server_url.scheme().isEmpty()&&
+     (hls_origin_port==0)) {
+    Log(LOG_ERR,"invalid argument for --server-url");
+    exit(256);
+  }
+  if((audio_quality>=0.0)&&(audio_bitrates.size()>0)) {
     Log(LOG_ERR,"--audio-quality and --audio-bitrate are mutually exclusive");
     exit(256);
   }
-  if((audio_quality<0.0)&&(audio_bitrate==0)) {
-    audio_bitrate=DEFAULT_AUDIO_BITRATE;
+  if((audio_quality<0.0)&&(audio_bitrates.size()==0)) {
+    audio_bitrates.push_back(DEFAULT_AUDIO_BITRATE);
+  }
+  if((audio_bitrates.size()>1)&&
+     (!Connector::supportsMultipleRenditions(server_type))) {
+    Log(LOG_ERR,"multiple --audio-bitrate values not supported for "+
+	Connector::optionKeyword(server_type)+" servers");
+    exit(256);
   }
 }
 
@@ -418,7 +541,16 @@ bool Config::audioAtomicFrames() const
 
 unsigned Config::audioBitrate() const
 {
-  return audio_bitrate;
+  if(audio_bitrates.size()==0) {  // For VBR modes
+    return 0;
+  }
+  return audio_bitrates.at(0);
+}
+
+
+std::vector<unsigned> Config::audioBitrates() const
+{
+  return audio_bitrates;
 }
 
 
@@ -464,6 +596,18 @@ int Config::serverMaxConnections() const
 }
 
 
+unsigned Config::serverMaxUploads() const
+{
+  return server_max_uploads;
+}
+
+
+bool Config::serverMemfd() const
+{
+  return server_memfd;
+}
+
+
 QString Config::serverPassword() const
 {
   return server_password;
@@ -613,6 +757,50 @@ QStringList Config::deviceValues() const
 }
 
 
+unsigned Config::latencyTarget() const
+{
+  return latency_target;
+}
+
+
+//
+// Latency Budget
+//
+// Everything between the capture device and the encoder is sized from
+// --latency-target.  Half of the budget goes to the capture device (see
+// AudioDevice::captureBufferSize()); the capture ringbuffer gets the full
+// budget at the device rate (see AudioDevice::ringbufferSize()), as do
+// the codecs' SRC ringbuffers at the stream rate (here), so that a
+// briefly stalled encoder can catch up rather than losing audio.  With
+// no target given, the historical fixed sizes are used.
+//
+unsigned Config::ringbufferSize() const
+{
+  uint64_t frames;
+
+  if(latency_target==0) {
+    return RINGBUFFER_SIZE;
+  }
+  frames=(uint64_t)audio_samplerate*latency_target/1000;
+  if(frames<LATENCY_MIN_RINGBUFFER_FRAMES) {
+    frames=LATENCY_MIN_RINGBUFFER_FRAMES;
+  }
+  return frames*audio_channels*sizeof(float);
+}
+
+
+int Config::codecWakeTimeout() const
+{
+  if(latency_target==0) {
+    return CODEC_WAKE_TIMEOUT;
+  }
+  if((latency_target/2)<LATENCY_MIN_WAKE_TIMEOUT) {
+    return LATENCY_MIN_WAKE_TIMEOUT;
+  }
+  return latency_target/2;
+}
+
+
 bool Config::listCodecs() const
 {
   return list_codecs;
@@ -625,6 +813,42 @@ bool Config::listDevices() const
 }
 
 
+bool Config::hlsFastStart() const
+{
+  return hls_fast_start;
+}
+
+
+bool Config::hlsFmp4() const
+{
+  return hls_fmp4;
+}
+
+
+unsigned Config::hlsOriginPort() const
+{
+  return hls_origin_port;
+}
+
+
+unsigned Config::hlsPartDuration() const
+{
+  return hls_part_duration;
+}
+
+
+unsigned Config::hlsSegmentDuration() const
+{
+  return hls_segment_duration;
+}
+
+
+unsigned Config::hlsWindow() const
+{
+  return hls_window;
+}
+
+
 unsigned Config::metadataPort() const
 {
   return metadata_port;
@@ -649,6 +873,12 @@ bool Config::meterData() const
 }
 
 
+bool Config::meterLoudness() const
+{
+  return meter_loudness;
+}
+
+
 void Config::ListCodecs() const
 {
   for(int i=0;i<Codec::TypeLast;i++) {
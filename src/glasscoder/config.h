@@ -38,6 +38,7 @@ class Config
   Config();
   bool audioAtomicFrames() const;
   unsigned audioBitrate() const;
+  std::vector<unsigned> audioBitrates() const;
   unsigned audioChannels() const;
   AudioDevice::DeviceType audioDevice() const;
   Codec::Type audioFormat() const;
@@ -45,6 +46,8 @@ class Config
   unsigned audioSamplerate() const;
   bool serverExitOnLast() const;
   int serverMaxConnections() const;
+  unsigned serverMaxUploads() const;
+  bool serverMemfd() const;
   QString serverPassword() const;
   QString credentialsFile() const;
   bool deleteCredentials() const;
@@ -70,10 +73,20 @@ class Config
   QString streamUrl() const;
   QStringList deviceKeys() const;
   QStringList deviceValues() const;
+  unsigned latencyTarget() const;
+  unsigned ringbufferSize() const;
+  int codecWakeTimeout() const;
   bool listCodecs() const;
   bool listDevices() const;
+  bool hlsFastStart() const;
+  bool hlsFmp4() const;
+  unsigned hlsOriginPort() const;
+  unsigned hlsPartDuration() const;
+  unsigned hlsSegmentDuration() const;
+  unsigned hlsWindow() const;
   unsigned metadataPort() const;
   bool meterData() const;
+  bool meterLoudness() const;
   bool dumpHeaders() const;
   bool verbose() const;
 
@@ -85,7 +98,7 @@ class Config
   // Audio Arguments
   //
   bool audio_atomic_frames;
-  unsigned audio_bitrate;
+  std::vector<unsigned> audio_bitrates;
   unsigned audio_channels;
   AudioDevice::DeviceType audio_device;
   Codec::Type audio_format;
@@ -97,6 +110,8 @@ class Config
   //
   bool server_exit_on_last;
   int server_max_connections;
+  unsigned server_max_uploads;
+  bool server_memfd;
   QString server_password;
   QString credentials_file;
   bool delete_credentials;
@@ -131,13 +146,25 @@ class Config
   QStringList device_keys;
   QStringList device_values;
 
+  //
+  // Latency Arguments
+  //
+  unsigned latency_target;
+
   //
   // Miscellaneous Arguments
   //
   bool list_codecs;
   bool list_devices;
+  bool hls_fast_start;
+  bool hls_fmp4;
+  unsigned hls_origin_port;
+  unsigned hls_part_duration;
+  unsigned hls_segment_duration;
+  unsigned hls_window;
   unsigned metadata_port;
   bool meter_data;
+  bool meter_loudness;
   bool dump_headers;
   bool show_verbose;
 };
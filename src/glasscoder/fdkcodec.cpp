@@ -85,6 +85,9 @@ QString FdkCodec::formatIdentifier() const
   // From ISO/IEC 14496-3
   // (see the summary at https://en.wikipedia.org/wiki/MPEG-4_Part_3)
   //
+  if(channels()==1) {
+    return QString("mp4a.40.5");  // No parametric stereo for mono
+  }
   return QString("mp4a.40.29");
 }
 
@@ -199,10 +202,47 @@ void FdkCodec::encodeData(Connector *conn,const float *pcm,int frames)
 
   src_float_to_short_array(pcm,fdk_input_buffer,frames*channels());
   if((err=aacEncEncode(fdk_encoder,&fdk_input_desc,&fdk_output_desc,&inargs,&outargs))== AACENC_OK) {
-    conn->writeData(frames,fdk_output_buffer,outargs.numOutBytes);
+    //
+    // Each call yields at most one access unit, always covering a full
+    // encoder frame regardless of how much PCM went in.
+    //
+    if(outargs.numOutBytes>0) {
+      packet()->setData(fdk_output_buffer,outargs.numOutBytes);
+      writePacket(conn,fdk_info.frameLength,
+		  EncodedPacket::FrameBoundary|EncodedPacket::Keyframe);
+    }
   }
   else {
     Log(LOG_WARNING,QString().sprintf("fdk_aac encoding error %d",err));
   }
 #endif  // HAVE_FDKAAC
 }
+
+
+void FdkCodec::flushEncoder(Connector *conn)
+{
+#ifdef HAVE_FDKAAC
+  AACENC_InArgs inargs;
+  AACENC_OutArgs outargs;
+  AACENC_ERROR err;
+
+  //
+  // A negative sample count tells the encoder that the input has ended,
+  // and it then gives up its delay line one access unit per call.
+  //
+  inargs.numInSamples=-1;
+  inargs.numAncBytes=0;
+  while((err=aacEncEncode(fdk_encoder,&fdk_input_desc,&fdk_output_desc,
+			  &inargs,&outargs))==AACENC_OK) {
+    if(outargs.numOutBytes==0) {
+      break;
+    }
+    packet()->setData(fdk_output_buffer,outargs.numOutBytes);
+    writePacket(conn,fdk_info.frameLength,
+		EncodedPacket::FrameBoundary|EncodedPacket::Keyframe);
+  }
+  if((err!=AACENC_OK)&&(err!=AACENC_ENCODE_EOF)) {
+    Log(LOG_WARNING,QString().sprintf("fdk_aac encoding error %d",err));
+  }
+#endif  // HAVE_FDKAAC
+}
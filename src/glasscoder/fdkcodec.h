@@ -42,6 +42,7 @@ class FdkCodec : public Codec
 
  protected:
   void encodeData(Connector *conn,const float *pcm,int frames);
+  void flushEncoder(Connector *conn);
 
  private:
 #ifdef HAVE_FDKAAC
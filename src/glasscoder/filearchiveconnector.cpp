@@ -153,18 +153,18 @@ void FileArchiveConnector::disconnectFromHostConnector()
 }
 
 
-int64_t FileArchiveConnector::writeDataConnector(int frames,
-						 const unsigned char *data,
-						 int64_t len)
+int64_t FileArchiveConnector::writePacketConnector(const EncodedPacket *pkt)
 {
+  int frames=pkt->duration();
+
   if(contentType()=="audio/x-wav") {
     short pcm[frames*audioChannels()];
     for(int i=0;i<frames*(int)audioChannels();i++) {
-      pcm[i]=ntohs(((short *)data)[i]);
+      pcm[i]=ntohs(((short *)pkt->data())[i]);
     }
     return sf_writef_short(archive_snd,pcm,frames)*2*audioChannels();
   }
-  return write(archive_fd,data,len);
+  return write(archive_fd,pkt->data(),pkt->size());
 }
 
 
@@ -100,15 +100,16 @@ void FileConnector::disconnectFromHostConnector()
 }
 
 
-int64_t FileConnector::writeDataConnector(int frames,const unsigned char *data,
-					 int64_t len)
+int64_t FileConnector::writePacketConnector(const EncodedPacket *pkt)
 {
+  int frames=pkt->duration();
+
   if(file_snd==NULL) {
-    return write(file_fd,data,len);
+    return write(file_fd,pkt->data(),pkt->size());
   }
   short pcm[frames*audioChannels()];
   for(int i=0;i<frames*(int)audioChannels();i++) {
-    pcm[i]=ntohs(((short *)data)[i]);
+    pcm[i]=ntohs(((short *)pkt->data())[i]);
   }
   return sf_writef_short(file_snd,pcm,frames)*2*audioChannels();
 }
@@ -22,9 +22,10 @@
 #include "glasslimits.h"
 
 FileDevice::FileDevice(unsigned chans,unsigned samprate,
-		       Ringbuffer *ring,QObject *parent)
+		       BroadcastRingbuffer *ring,QObject *parent)
   : AudioDevice(chans,samprate,ring,parent)
 {
+  file_offline=false;
 #ifdef SNDFILE
   file_sndfile=NULL;
   file_muted=true;
@@ -64,6 +65,10 @@ bool FileDevice::processOptions(QString *err,const QStringList &keys,
       file_name=values[i];
       processed=true;
     }
+    if(keys[i]=="--file-offline") {
+      file_offline=true;
+      processed=true;
+    }
     if(!processed) {
       *err=tr("unrecognized option")+" "+keys[i]+"\"";
       return false;
@@ -99,7 +104,13 @@ bool FileDevice::start(QString *err)
     sf_close(file_sndfile);
     return false;
   }
-  file_read_timer->start(1000*SNDFILE_BUFFER_SIZE/file_sfinfo.samplerate);
+  allocateRingBuffer();
+  if(file_offline) {
+    file_read_timer->start(SNDFILE_OFFLINE_INTERVAL);
+  }
+  else {
+    file_read_timer->start(1000*SNDFILE_BUFFER_SIZE/file_sfinfo.samplerate);
+  }
 
   return true;
 #else
@@ -118,6 +129,12 @@ unsigned FileDevice::deviceSamplerate() const
 }
 
 
+bool FileDevice::isOffline() const
+{
+  return file_offline;
+}
+
+
 void FileDevice::unmute()
 {
   file_muted=false;
@@ -127,35 +144,66 @@ void FileDevice::unmute()
 void FileDevice::readTimerData()
 {
 #ifdef SNDFILE
+  float pcm[SNDFILE_BUFFER_SIZE*MAX_AUDIO_CHANNELS];
+
+  if(!file_offline) {
+    if(file_muted) {
+      memset(pcm,0,SNDFILE_BUFFER_SIZE*sizeof(float)*channels());
+      writeRingBuffer(pcm,SNDFILE_BUFFER_SIZE);
+    }
+    else {
+      ReadBlock();
+    }
+    return;
+  }
+
+  //
+  // Offline mode.  Nothing is written until the stream is up, after which
+  // we read as fast as the slowest codec will take the data.
+  //
+  if(file_muted) {
+    return;
+  }
+  while(ringBuffer()->writeSpace()>=SNDFILE_BUFFER_SIZE) {
+    if(!ReadBlock()) {
+      return;
+    }
+  }
+#endif  // SNDFILE
+}
+
+
+#ifdef SNDFILE
+bool FileDevice::ReadBlock()
+{
   float pcm1[SNDFILE_BUFFER_SIZE*MAX_AUDIO_CHANNELS];
   float pcm2[SNDFILE_BUFFER_SIZE*MAX_AUDIO_CHANNELS];
   float *pcm=pcm1;
   sf_count_t nframes;
   float levels[MAX_AUDIO_CHANNELS];
 
-  if(file_muted) {
-    memset(pcm,0,sizeof(SNDFILE_BUFFER_SIZE*sizeof(float)*channels()));
-    ringBuffer()->write(pcm,SNDFILE_BUFFER_SIZE);
+  if(file_sndfile==NULL) {
+    return false;
   }
-  else {
-    if((nframes=sf_readf_float(file_sndfile,pcm1,SNDFILE_BUFFER_SIZE))>0) {
-      if(file_sfinfo.channels!=(int)channels()) {
-	remixChannels(pcm2,channels(),pcm1,file_sfinfo.channels,nframes);
-	pcm=pcm2;
-      }
-      ringBuffer()->write(pcm,nframes);
-      peakLevels(levels,pcm,nframes,channels());
-      for(unsigned i=0;i<channels();i++) {
-	file_meter_avg[i]->addValue(levels[i]);
-	levels[i]=file_meter_avg[i]->average();
-      }
-      setMeterLevels(levels);
+  if((nframes=sf_readf_float(file_sndfile,pcm1,SNDFILE_BUFFER_SIZE))>0) {
+    if(file_sfinfo.channels!=(int)channels()) {
+      remixChannels(pcm2,channels(),pcm1,file_sfinfo.channels,nframes);
+      pcm=pcm2;
     }
-    else {
-      sf_close(file_sndfile);
-      file_sndfile=NULL;
-      emit hasStopped();
+    writeRingBuffer(pcm,nframes);
+    peakLevels(levels,pcm,nframes,channels());
+    for(unsigned i=0;i<channels();i++) {
+      file_meter_avg[i]->addValue(levels[i]);
+      levels[i]=file_meter_avg[i]->average();
     }
+    setMeterLevels(levels);
+    return true;
   }
-#endif  // SNDFILE
+  sf_close(file_sndfile);
+  file_sndfile=NULL;
+  file_read_timer->stop();
+  emit hasStopped();
+
+  return false;
 }
+#endif  // SNDFILE
@@ -37,18 +37,20 @@
 #include "ringbuffer.h"
 
 #define SNDFILE_BUFFER_SIZE 1024
+#define SNDFILE_OFFLINE_INTERVAL 1
 
 class FileDevice : public AudioDevice
 {
   Q_OBJECT;
  public:
   FileDevice(unsigned chans,unsigned samprate,
-	     Ringbuffer *ring,QObject *parent=0);
+	     BroadcastRingbuffer *ring,QObject *parent=0);
   ~FileDevice();
   bool processOptions(QString *err,const QStringList &keys,
 		      const QStringList &values);
   bool start(QString *err);
   unsigned deviceSamplerate() const;
+  bool isOffline() const;
 
  public slots:
   void unmute();
@@ -57,7 +59,9 @@ class FileDevice : public AudioDevice
   void readTimerData();
 
  private:
+  bool file_offline;
 #ifdef SNDFILE
+  bool ReadBlock();
   QString file_name;
   SNDFILE *file_sndfile;
   SF_INFO file_sfinfo;
@@ -0,0 +1,391 @@
+// frameparser.cpp
+//
+// Find frame boundaries in MPEG audio, ADTS and Ogg bitstreams.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <string.h>
+
+#include "frameparser.h"
+
+//
+// MPEG audio bitrates (kbit/sec), by [MPEG-1 or not][layer-1][index]
+//
+static const unsigned frameparser_mpeg_bitrates[2][3][15]=
+  {{{0,32,64,96,128,160,192,224,256,288,320,352,384,416,448},
+    {0,32,48,56,64,80,96,112,128,160,192,224,256,320,384},
+    {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320}},
+   {{0,32,48,56,64,80,96,112,128,144,160,176,192,224,256},
+    {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160},
+    {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160}}};
+
+//
+// MPEG audio sample rates, by [version field][index]
+//
+static const unsigned frameparser_mpeg_samplerates[4][3]=
+  {{11025,12000,8000},  // MPEG-2.5
+   {0,0,0},             // Reserved
+   {22050,24000,16000}, // MPEG-2
+   {44100,48000,32000}};// MPEG-1
+
+static const unsigned frameparser_adts_samplerates[13]=
+  {96000,88200,64000,48000,44100,32000,24000,22050,16000,12000,11025,8000,
+   7350};
+
+FrameParser::FrameParser(FrameParser::Format fmt,unsigned samprate)
+{
+  parser_format=fmt;
+  parser_samplerate=samprate;
+  reset();
+}
+
+
+FrameParser::Format FrameParser::format() const
+{
+  return parser_format;
+}
+
+
+void FrameParser::setFormat(FrameParser::Format fmt)
+{
+  parser_format=fmt;
+  reset();
+}
+
+
+unsigned FrameParser::samplerate() const
+{
+  return parser_samplerate;
+}
+
+
+void FrameParser::setSamplerate(unsigned rate)
+{
+  parser_samplerate=rate;
+}
+
+
+void FrameParser::reset()
+{
+  parser_pos=0;
+  parser_next=0;
+  parser_carry_len=0;
+  parser_synced=false;
+  parser_sync_errors=0;
+  parser_granulepos=0;
+  parser_frames=0;
+}
+
+
+unsigned FrameParser::parse(const unsigned char *data,int len)
+{
+  int64_t base=parser_pos;
+  int64_t end=parser_pos+len;
+  const unsigned char *hdr=NULL;
+  const unsigned char *sync=NULL;
+  int avail=0;
+  int fill=0;
+  int size=0;
+  unsigned duration=0;
+
+  parser_pos=end;
+  parser_frames=0;
+  if(parser_format==FrameParser::Unknown) {
+    parser_next=end;
+    return 0;
+  }
+
+  while(parser_next<end) {
+    if(parser_next<base) {
+      //
+      // Header began in the previous block
+      //
+      fill=len;
+      if(fill>(FRAMEPARSER_MAX_HEADER-parser_carry_len)) {
+	fill=FRAMEPARSER_MAX_HEADER-parser_carry_len;
+      }
+      memcpy(parser_scratch,parser_carry,parser_carry_len);
+      memcpy(parser_scratch+parser_carry_len,data,fill);
+      hdr=parser_scratch;
+      avail=parser_carry_len+fill;
+    }
+    else {
+      hdr=data+(parser_next-base);
+      avail=end-parser_next;
+    }
+
+    if((size=FrameSize(hdr,avail,&duration))>0) {
+      if(parser_frames<FRAMEPARSER_MAX_FRAMES) {
+	parser_offsets[parser_frames]=parser_next-base;
+	parser_durations[parser_frames]=duration;
+	parser_frames++;
+      }
+      parser_synced=true;
+      parser_next+=size;
+      parser_carry_len=0;
+      continue;
+    }
+
+    if(size==0) {
+      //
+      // Header runs off the end of the block, hang on to what we have
+      //
+      if(parser_next<base) {
+	memcpy(parser_carry+parser_carry_len,data,fill);
+	parser_carry_len+=fill;
+      }
+      else {
+	memcpy(parser_carry,hdr,avail);
+	parser_carry_len=avail;
+      }
+      return parser_frames;
+    }
+
+    //
+    // Lost sync, so scan for the next candidate header
+    //
+    if(parser_synced) {
+      parser_sync_errors++;
+      parser_synced=false;
+    }
+    if(parser_next<base) {
+      memmove(parser_carry,parser_carry+1,--parser_carry_len);
+      parser_next++;
+    }
+    else {
+      if((sync=(const unsigned char *)memchr(hdr+1,SyncByte(),avail-1))==
+	 NULL) {
+	parser_next=end;
+      }
+      else {
+	parser_next+=sync-hdr;
+      }
+    }
+  }
+  parser_carry_len=0;
+
+  return parser_frames;
+}
+
+
+unsigned FrameParser::frames() const
+{
+  return parser_frames;
+}
+
+
+int FrameParser::frameOffset(unsigned n) const
+{
+  return parser_offsets[n];
+}
+
+
+unsigned FrameParser::frameDuration(unsigned n) const
+{
+  return parser_durations[n];
+}
+
+
+uint64_t FrameParser::syncErrors() const
+{
+  return parser_sync_errors;
+}
+
+
+FrameParser::Format FrameParser::format(const QString &content_type)
+{
+  if(content_type=="audio/mpeg") {
+    return FrameParser::Mpeg;
+  }
+  if((content_type=="audio/aacp")||(content_type=="audio/aac")) {
+    return FrameParser::Adts;
+  }
+  if((content_type=="audio/ogg")||(content_type=="application/ogg")) {
+    return FrameParser::Ogg;
+  }
+  return FrameParser::Unknown;
+}
+
+
+int FrameParser::mpegFrameSize(const unsigned char *hdr,int len,
+			       unsigned *samples,unsigned *samprate)
+{
+  //
+  // Returns the frame length in bytes, zero if more header is needed or
+  // -1 if this is not a valid frame header.  Free-format streams are not
+  // supported.
+  //
+  unsigned version;
+  unsigned layer;
+  unsigned bitrate;
+  unsigned rate;
+  unsigned padding;
+
+  if(len<1) {
+    return 0;
+  }
+  if(hdr[0]!=0xFF) {
+    return -1;
+  }
+  if(len<4) {
+    return 0;
+  }
+  if((hdr[1]&0xE0)!=0xE0) {
+    return -1;
+  }
+  version=(hdr[1]>>3)&0x03;
+  layer=4-((hdr[1]>>1)&0x03);  // 4 == reserved
+  if((version==1)||(layer==4)||((hdr[2]>>4)==0)||((hdr[2]>>4)==15)||
+     (((hdr[2]>>2)&0x03)==3)) {
+    return -1;
+  }
+  bitrate=1000*frameparser_mpeg_bitrates[version!=3][layer-1][hdr[2]>>4];
+  rate=frameparser_mpeg_samplerates[version][(hdr[2]>>2)&0x03];
+  padding=(hdr[2]>>1)&0x01;
+  *samprate=rate;
+  switch(layer) {
+  case 1:
+    *samples=384;
+    return 4*(12*bitrate/rate+padding);
+
+  case 2:
+    *samples=1152;
+    break;
+
+  case 3:
+    *samples=(version==3)?1152:576;
+    break;
+  }
+
+  return (*samples/8)*bitrate/rate+padding;
+}
+
+
+int FrameParser::adtsFrameSize(const unsigned char *hdr,int len,
+			       unsigned *samples,unsigned *samprate)
+{
+  int size;
+
+  if(len<1) {
+    return 0;
+  }
+  if(hdr[0]!=0xFF) {
+    return -1;
+  }
+  if(len<7) {
+    return 0;
+  }
+  if(((hdr[1]&0xF6)!=0xF0)||(((hdr[2]>>2)&0x0F)>=13)) {
+    return -1;
+  }
+  if((size=((hdr[3]&0x03)<<11)|(hdr[4]<<3)|(hdr[5]>>5))<7) {
+    return -1;
+  }
+  *samples=1024*((hdr[6]&0x03)+1);
+  *samprate=frameparser_adts_samplerates[(hdr[2]>>2)&0x0F];
+
+  return size;
+}
+
+
+int FrameParser::oggPageSize(const unsigned char *hdr,int len,
+			     int64_t *granulepos)
+{
+  static const char capture[]="OggS";
+  int size;
+
+  if(memcmp(hdr,capture,len<4?len:4)!=0) {
+    return -1;
+  }
+  if(len<27) {
+    return 0;
+  }
+  if(hdr[4]!=0) {  // Stream structure version
+    return -1;
+  }
+  if(len<(27+hdr[26])) {
+    return 0;
+  }
+  size=27+hdr[26];
+  for(int i=0;i<hdr[26];i++) {
+    size+=hdr[27+i];
+  }
+  *granulepos=0;
+  for(int i=0;i<8;i++) {
+    *granulepos|=((int64_t)hdr[6+i])<<(8*i);
+  }
+
+  return size;
+}
+
+
+int FrameParser::FrameSize(const unsigned char *hdr,int len,
+			   unsigned *duration)
+{
+  unsigned samples=0;
+  unsigned rate=0;
+  int64_t granulepos=0;
+  int ret=-1;
+
+  switch(parser_format) {
+  case FrameParser::Mpeg:
+    ret=mpegFrameSize(hdr,len,&samples,&rate);
+    break;
+
+  case FrameParser::Adts:
+    ret=adtsFrameSize(hdr,len,&samples,&rate);
+    break;
+
+  case FrameParser::Ogg:
+    if((ret=oggPageSize(hdr,len,&granulepos))>0) {
+      //
+      // A page on which no packet ends has a granule position of -1
+      //
+      samples=0;
+      if(granulepos>=parser_granulepos) {
+	samples=granulepos-parser_granulepos;
+	parser_granulepos=granulepos;
+      }
+    }
+    break;
+
+  case FrameParser::Unknown:
+    break;
+  }
+  if(ret<=0) {
+    return ret;
+  }
+
+  //
+  // HE-AAC headers carry the core rate, which is half the output rate
+  //
+  *duration=samples;
+  if((rate>0)&&(parser_samplerate>0)&&(rate!=parser_samplerate)) {
+    *duration=(uint64_t)samples*parser_samplerate/rate;
+  }
+
+  return ret;
+}
+
+
+unsigned char FrameParser::SyncByte() const
+{
+  if(parser_format==FrameParser::Ogg) {
+    return 'O';
+  }
+  return 0xFF;
+}
@@ -0,0 +1,85 @@
+// frameparser.h
+//
+// Find frame boundaries in MPEG audio, ADTS and Ogg bitstreams.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef FRAMEPARSER_H
+#define FRAMEPARSER_H
+
+#include <stdint.h>
+
+#include <QString>
+
+#define FRAMEPARSER_MAX_FRAMES 512
+#define FRAMEPARSER_MAX_HEADER 282
+
+//
+// Fed a bitstream one block at a time, indexes the frames (Ogg pages)
+// that begin in each block.  Frame headers are used to jump straight from
+// one frame to the next, falling back to a scan for the next sync word if
+// the stream is damaged.  Never allocates.
+//
+// Offsets are relative to the start of the block last passed to parse(),
+// and are negative for a frame whose header straddled the previous block.
+// Durations are in samples at samplerate(), or at the rate given by the
+// frame header if that is zero.
+//
+class FrameParser
+{
+ public:
+  enum Format {Unknown=0,Mpeg=1,Adts=2,Ogg=3};
+  FrameParser(FrameParser::Format fmt=FrameParser::Unknown,
+	      unsigned samprate=0);
+  FrameParser::Format format() const;
+  void setFormat(FrameParser::Format fmt);
+  unsigned samplerate() const;
+  void setSamplerate(unsigned rate);
+  void reset();
+  unsigned parse(const unsigned char *data,int len);
+  unsigned frames() const;
+  int frameOffset(unsigned n) const;
+  unsigned frameDuration(unsigned n) const;
+  uint64_t syncErrors() const;
+  static FrameParser::Format format(const QString &content_type);
+  static int mpegFrameSize(const unsigned char *hdr,int len,
+			   unsigned *samples,unsigned *samprate);
+  static int adtsFrameSize(const unsigned char *hdr,int len,
+			   unsigned *samples,unsigned *samprate);
+  static int oggPageSize(const unsigned char *hdr,int len,
+			 int64_t *granulepos);
+
+ private:
+  int FrameSize(const unsigned char *hdr,int len,unsigned *duration);
+  unsigned char SyncByte() const;
+  FrameParser::Format parser_format;
+  unsigned parser_samplerate;
+  int64_t parser_pos;
+  int64_t parser_next;
+  unsigned char parser_carry[FRAMEPARSER_MAX_HEADER];
+  int parser_carry_len;
+  unsigned char parser_scratch[FRAMEPARSER_MAX_HEADER];
+  bool parser_synced;
+  uint64_t parser_sync_errors;
+  int64_t parser_granulepos;
+  unsigned parser_frames;
+  int parser_offsets[FRAMEPARSER_MAX_FRAMES];
+  unsigned parser_durations[FRAMEPARSER_MAX_FRAMES];
+};
+
+
+#endif  // FRAMEPARSER_H
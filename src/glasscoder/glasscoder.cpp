@@ -32,8 +32,11 @@
 #include "cmdswitch.h"
 #include "codecfactory.h"
 #include "connectorfactory.h"
+#include "dspkernels.h"
 #include "glasscoder.h"
+#include "hlsconnector.h"
 #include "logging.h"
+#include "loudnessmeter.h"
 
 //
 // Globals
@@ -55,7 +58,10 @@ MainObject::MainObject(QObject *parent)
   : QObject(parent)
 {
   sir_exit_count=0;
+  sir_draining=false;
   sir_meta_server=NULL;
+  sir_hls_origin=NULL;
+  sir_loudness_meter=NULL;
 
   sir_config=new Config();
 
@@ -82,7 +88,8 @@ MainObject::MainObject(QObject *parent)
   // Metadata Processor
   //
   if(sir_config->metadataPort()>0) {
-    sir_meta_server=new MetaServer(sir_config,this);
+    sir_meta_server=
+      new MetaServer(sir_config,sir_capture_ring,sir_loudness_meter,this);
     if(!sir_meta_server->listen(sir_config->metadataPort())) {
       Log(LOG_ERR,QString().sprintf("unable to bind port %u",
 				    sir_config->metadataPort()));
@@ -91,9 +98,22 @@ MainObject::MainObject(QObject *parent)
   }
 
   //
-  // Start Server Connection
+  // HLS Origin
   //
-  if(!StartSingleStream()) {
+  if(sir_config->hlsOriginPort()>0) {
+    sir_hls_origin=new HlsOrigin(this);
+    sir_hls_origin->setBlockingTimeout(3000*sir_config->hlsSegmentDuration());
+    if(!sir_hls_origin->listen(sir_config->hlsOriginPort())) {
+      Log(LOG_ERR,QString().sprintf("unable to bind port %u",
+				    sir_config->hlsOriginPort()));
+      exit(256);
+    }
+  }
+
+  //
+  // Start Server Connections
+  //
+  if(!StartStreams()) {
     exit(256);
   }
 
@@ -135,13 +155,30 @@ void MainObject::stdinActivatedData(int sock)
 
 void MainObject::audioDeviceStoppedData()
 {
-  glasscoder_exiting=true;
+  if(sir_audio_device->isOffline()) {
+    for(unsigned i=0;i<sir_codecs.size();i++) {
+      sir_codecs[i]->drain();
+    }
+    sir_draining=true;  // Let the encoders finish first
+  }
+  else {
+    glasscoder_exiting=true;
+  }
 }
 
 
 void MainObject::connectorStoppedData()
 {
-  if(++sir_exit_count==(sir_connectors.size()+1)) {
+  if(++sir_exit_count==sir_connectors.size()) {
+    for(unsigned i=0;i<sir_connectors.size();i++) {
+      sir_connectors[i]->abortHandoff();
+    }
+    for(unsigned i=0;i<sir_codecs.size();i++) {
+      sir_codecs[i]->stopEncoder();
+    }
+    if(sir_loudness_meter!=NULL) {
+      sir_loudness_meter->stop();
+    }
     for(unsigned i=0;i<sir_connectors.size();i++) {
       delete sir_connectors[i];
     }
@@ -153,21 +190,53 @@ void MainObject::connectorStoppedData()
 void MainObject::meterData()
 {
   int lvls[MAX_AUDIO_CHANNELS];
+  QString loudness;
 
+  //
+  // Loudness values go after the peak levels, so that older parsers
+  // can simply ignore them.
+  //
+  if(sir_loudness_meter!=NULL) {
+    LoudnessMeter *m=sir_loudness_meter;
+    loudness=" "+QString::number(m->momentaryLoudness(),'f',1)+
+      " "+QString::number(m->shortTermLoudness(),'f',1)+
+      " "+QString::number(m->integratedLoudness(),'f',1)+
+      " "+QString::number(m->truePeak(0),'f',1)+
+      " "+QString::number(m->truePeak(m->channels()-1),'f',1);
+  }
   sir_audio_device->meterLevels(lvls);
-  switch(sir_codec->channels()) {
+  switch(sir_config->audioChannels()) {
   case 1:
-    printf("ME %04X%04X\n",lvls[0],lvls[0]);
+    printf("ME %04X%04X%s\n",lvls[0],lvls[0],
+	   (const char *)loudness.toUtf8());
     break;
 
   case 2:
-    printf("ME %04X%04X\n",lvls[0],lvls[1]);
+    printf("ME %04X%04X%s\n",lvls[0],lvls[1],
+	   (const char *)loudness.toUtf8());
     break;
   }
   fflush(stdout);
 }
 
 
+void MainObject::statsData()
+{
+  Ringbuffer *ring;
+
+  for(unsigned i=0;i<sir_codecs.size();i++) {
+    ring=sir_capture_ring->reader(i);
+    printf("RS %u %lu %lu %lu %lu %u %u\n",i,
+	   (unsigned long)ring->framesWritten(),
+	   (unsigned long)ring->framesDropped(),
+	   (unsigned long)ring->overruns(),
+	   (unsigned long)ring->underruns(),
+	   ring->highWater(),ring->size());
+  }
+  fflush(stdout);
+}
+
+
 void MainObject::connectedData(bool state)
 {
   if(global_log_to==LOG_TO_STDOUT) {
@@ -183,6 +252,9 @@ void MainObject::connectedData(bool state)
 
 void MainObject::exitTimerData()
 {
+  if(sir_draining&&PipelineDrained()) {
+    glasscoder_exiting=true;
+  }
   if(glasscoder_exiting) {
     bool connected=sir_connectors.at(0)->isConnected();
     for(unsigned i=0;i<sir_connectors.size();i++) {
@@ -203,13 +275,22 @@ void MainObject::exitTimerData()
 bool MainObject::StartAudioDevice()
 {
   //
-  // Create Ringbuffer
+  // Create Capture Ringbuffer
+  //
+  // The audio device writes each block once; every rendition gets its own
+  // reader cursor, as does the loudness meter (if enabled). Readers must
+  // exist before the device starts writing.  The renditions read in
+  // lockstep, so that an overrun in one of them can't leave it out of
+  // step with the rest.  The device sizes the buffer itself, once it
+  // knows the rate it runs at.
   //
-  if(sir_config->audioBitrate()==0) {   // For VBR modes
-    sir_ringbuffer=new Ringbuffer(RINGBUFFER_SIZE,sir_config->audioChannels());
+  sir_capture_ring=new BroadcastRingbuffer(0,sir_config->audioChannels());
+  for(unsigned i=0;i<RenditionBitrates().size();i++) {
+    sir_capture_ring->addReader(true);
   }
-  else {
-    sir_ringbuffer=new Ringbuffer(RINGBUFFER_SIZE,sir_config->audioChannels());
+  Ringbuffer *loudness_ring=NULL;
+  if(sir_config->meterLoudness()) {
+    loudness_ring=sir_capture_ring->addReader();
   }
 
   //
@@ -219,8 +300,7 @@ bool MainObject::StartAudioDevice()
   if((sir_audio_device=
       AudioDeviceFactory(sir_config->audioDevice(),sir_config->audioChannels(),
 			 sir_config->audioSamplerate(),
-			 //			 &sir_ringbuffers,this))==NULL) {
-			 sir_ringbuffer,this))==NULL) {
+			 sir_capture_ring,this))==NULL) {
     Log(LOG_ERR,
 	QString().sprintf("%s devices not supported",
 	    (const char *)AudioDevice::deviceTypeText(sir_config->audioDevice()).toUtf8()));
@@ -228,6 +308,18 @@ bool MainObject::StartAudioDevice()
   }
   connect(sir_audio_device,SIGNAL(hasStopped()),
 	  this,SLOT(audioDeviceStoppedData()));
+
+  //
+  // Keep planar audio planar when the encoder takes it that way.  Anything
+  // else (including the sample rate converter) reads it interleaved.
+  //
+  if((sir_audio_device->nativeLayout()==Ringbuffer::Planar)&&
+     (Codec::inputLayout(sir_config->audioFormat())==Ringbuffer::Planar)) {
+    sir_capture_ring->setLayout(Ringbuffer::Planar);
+  }
+  sir_audio_device->setLatencyTarget(sir_config->latencyTarget());
+  Log(LOG_DEBUG,QString().sprintf("using %s DSP kernels",
+		DspKernels::typeText(DspKernels::type())));
   if(!sir_audio_device->processOptions(&err,sir_config->deviceKeys(),
 				       sir_config->deviceValues())) {
     Log(LOG_ERR,err);
@@ -237,42 +329,69 @@ bool MainObject::StartAudioDevice()
     Log(LOG_ERR,err);
     exit(256);
   }
+  if(sir_config->latencyTarget()>0) {
+    Log(LOG_INFO,
+	QString().sprintf("latency target %u mS: capture period %u frames, capture buffer %u frames, ringbuffer %u frames",
+			  sir_config->latencyTarget(),
+			  sir_audio_device->capturePeriodSize(),
+			  sir_audio_device->captureBufferSize(),
+			  sir_capture_ring->size()));
+  }
+
+  //
+  // Start Loudness Meter
+  //
+  if(loudness_ring!=NULL) {
+    sir_loudness_meter=
+      new LoudnessMeter(loudness_ring,sir_config->audioChannels(),
+			sir_audio_device->deviceSamplerate());
+    if(!sir_loudness_meter->start()) {
+      Log(LOG_ERR,"unable to start loudness meter thread");
+      exit(256);
+    }
+  }
+
   sir_meter_timer=new QTimer(this);
   connect(sir_meter_timer,SIGNAL(timeout()),this,SLOT(meterData()));
   if(sir_config->meterData()) {
     sir_meter_timer->start(AUDIO_METER_INTERVAL);
   }
+  sir_stats_timer=new QTimer(this);
+  connect(sir_stats_timer,SIGNAL(timeout()),this,SLOT(statsData()));
+  if(global_log_to==LOG_TO_STDOUT) {
+    sir_stats_timer->start(RINGBUFFER_STATS_INTERVAL);
+  }
 
   return true;
 }
 
 
-bool MainObject::StartCodec()
+bool MainObject::StartCodec(Ringbuffer *ring,unsigned bitrate)
 {
-  if((sir_codec=
-    CodecFactory(sir_config->audioFormat(),sir_ringbuffer,this))==NULL) {
+  Codec *codec=NULL;
+
+  if((codec=CodecFactory(sir_config->audioFormat(),ring,this))==NULL) {
     Log(LOG_ERR,
 	QString().sprintf("unsupported codec type \"%s\"",
 	      (const char *)Codec::codecTypeText(Codec::TypeMpegL3).toUtf8()));
     return false;
   }
-  if(sir_config->audioBitrate()>0) {
-    sir_codec->setBitrate(sir_config->audioBitrate());
-  }
-  else {
-    sir_codec->setBitrate(0);
-  }
-  sir_codec->setChannels(sir_config->audioChannels());
-  sir_codec->setQuality(sir_config->audioQuality());
-  sir_codec->setSourceSamplerate(sir_audio_device->deviceSamplerate());
-  sir_codec->setStreamSamplerate(sir_config->audioSamplerate());
-  sir_codec->setCompleteFrames(sir_config->audioAtomicFrames());
-
-  return sir_codec->start();
+  codec->setBitrate(bitrate);
+  codec->setChannels(sir_config->audioChannels());
+  codec->setQuality(sir_config->audioQuality());
+  codec->setSourceSamplerate(sir_audio_device->deviceSamplerate());
+  codec->setStreamSamplerate(sir_config->audioSamplerate());
+  codec->setCompleteFrames(sir_config->audioAtomicFrames());
+  codec->setRingbufferSize(sir_config->ringbufferSize());
+  codec->setWakeTimeout(sir_config->codecWakeTimeout());
+  sir_codecs.push_back(codec);
+
+  return codec->start();
 }
 
 
-void MainObject::StartServerConnection(const QString &mntpt)
+void MainObject::StartServerConnection(Codec *codec,unsigned bitrate,
+				       const QString &mntpt)
 {
   Connector *conn;
 
@@ -282,12 +401,9 @@ void MainObject::StartServerConnection(const QString &mntpt)
   conn=ConnectorFactory(sir_config->serverType(),sir_config,this);
   connect(conn,SIGNAL(stopped()),this,SLOT(connectorStoppedData()));
   connect(conn,SIGNAL(unmuteRequested()),sir_audio_device,SLOT(unmute()));
-  connect(conn,SIGNAL(dataRequested(Connector *)),
-	  sir_codec,SLOT(encode(Connector *)));
   connect(conn,SIGNAL(connected(bool)),this,SLOT(connectedData(bool)));
-  connect(conn,SIGNAL(stopped()),this,SLOT(connectorStoppedData()));
-  conn->setStreamPrologue(sir_codec->streamPrologue());
-  sir_codec->setCompleteFrames(sir_config->serverType()==Connector::HlsServer);
+  conn->setStreamPrologue(codec->streamPrologue());
+  codec->setCompleteFrames(sir_config->serverType()==Connector::HlsServer);
   if(sir_meta_server!=NULL) {
     connect(sir_meta_server,SIGNAL(metadataReceived(MetaEvent *)),
 	    conn,SLOT(sendMetadata(MetaEvent *)));
@@ -310,10 +426,10 @@ void MainObject::StartServerConnection(const QString &mntpt)
   conn->setServerStartConnections(sir_config->serverStartConnections());
   conn->setServerUserAgent(sir_config->serverUserAgent());
   conn->setDumpHeaders(sir_config->dumpHeaders());
-  conn->setContentType(sir_codec->contentType());
-  conn->setExtension(sir_codec->defaultExtension());
-  conn->setFormatIdentifier(sir_codec->formatIdentifier());
-  conn->setAudioBitrate(sir_config->audioBitrate());
+  conn->setContentType(codec->contentType());
+  conn->setExtension(codec->defaultExtension());
+  conn->setFormatIdentifier(codec->formatIdentifier());
+  conn->setAudioBitrate(bitrate);
   conn->setAudioChannels(sir_config->audioChannels());
   conn->setAudioSamplerate(sir_config->audioSamplerate());
   conn->setScriptUp(sir_config->serverScriptUp());
@@ -327,25 +443,107 @@ void MainObject::StartServerConnection(const QString &mntpt)
   conn->setStreamAim(sir_config->streamAim());
   conn->setStreamTimestampOffset(sir_config->streamTimestampOffset());
 
+  if(sir_hls_origin!=NULL) {
+    ((HlsConnector *)conn)->setOrigin(sir_hls_origin);
+  }
+  if(sir_config->serverType()==Connector::HlsServer) {
+    ((HlsConnector *)conn)->setOriginDateTime(sir_hls_origin_datetime);
+  }
+
+  conn->setHandoffBlocking(sir_audio_device->isOffline());
+
   //
   // Open the server connection
   //
   sir_connectors.push_back(conn);
   sir_connectors.back()->connectToServer(sir_config->serverUrl());
+
+  //
+  // Start the encoder
+  //
+  if(!codec->startEncoder(conn)) {
+    exit(256);
+  }
 }
 
 
-bool MainObject::StartSingleStream()
+bool MainObject::StartStreams()
 {
-  if(!StartCodec()) {
-    return false;
+  std::vector<unsigned> bitrates=RenditionBitrates();
+
+  //
+  // One codec and connector per rendition, all fed from the same capture.
+  // With multiple renditions, the bitrate is appended to each mountpoint.
+  //
+  // As every rendition starts on the same sample and uses the same codec,
+  // HLS renditions cut their segments on the same boundaries and so keep
+  // the same media sequence numbers.
+  //
+  sir_hls_origin_datetime=
+    QDateTime(QDate::currentDate(),QTime::currentTime());
+  for(unsigned i=0;i<bitrates.size();i++) {
+    if(!StartCodec(sir_capture_ring->reader(i),bitrates.at(i))) {
+      return false;
+    }
+    if(bitrates.size()==1) {
+      StartServerConnection(sir_codecs.back(),bitrates.at(i));
+    }
+    else {
+      StartServerConnection(sir_codecs.back(),bitrates.at(i),
+	  Connector::subMountpointName(sir_config->serverUrl().path(),
+				       bitrates.at(i)));
+    }
   }
-  StartServerConnection();
 
+  //
+  // A master playlist at the original mountpoint, published by the
+  // first rendition
+  //
+  if((sir_config->serverType()==Connector::HlsServer)&&(bitrates.size()>1)) {
+    HlsConnector *conn=(HlsConnector *)sir_connectors.front();
+    conn->setMasterPlaylist(sir_config->serverUrl().path());
+    for(unsigned i=0;i<sir_connectors.size();i++) {
+      conn->addVariant(sir_connectors.at(i)->serverMountpoint(),
+		       bitrates.at(i),sir_codecs.at(i)->formatIdentifier());
+    }
+  }
+
+  return true;
+}
+
+
+bool MainObject::PipelineDrained() const
+{
+  //
+  // True once every codec has encoded and flushed everything available
+  // to it, and every connector has taken the result.
+  //
+  for(unsigned i=0;i<sir_codecs.size();i++) {
+    if(!sir_codecs[i]->isDrained()) {
+      return false;
+    }
+  }
+  for(unsigned i=0;i<sir_connectors.size();i++) {
+    if(sir_connectors[i]->handoffPending()) {
+      return false;
+    }
+  }
   return true;
 }
 
 
+std::vector<unsigned> MainObject::RenditionBitrates() const
+{
+  std::vector<unsigned> ret=sir_config->audioBitrates();
+
+  if(ret.size()==0) {  // For VBR modes
+    ret.push_back(0);
+  }
+
+  return ret;
+}
+
+
 void MainObject::ProcessCommand(const QString &cmd)
 {
   QStringList cmds=cmd.split(" ");
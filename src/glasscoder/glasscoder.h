@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 
+#include <QDateTime>
 #include <QObject>
 #include <QSocketNotifier>
 #include <QStringList>
@@ -34,6 +35,8 @@
 #include "config.h"
 #include "connector.h"
 #include "glasslimits.h"
+#include "hlsorigin.h"
+#include "loudnessmeter.h"
 #include "metaserver.h"
 #include "ringbuffer.h"
 
@@ -48,6 +51,7 @@ class MainObject : public QObject
   void audioDeviceStoppedData();
   void connectorStoppedData();
   void meterData();
+  void statsData();
   void connectedData(bool state);
   void exitTimerData();
 
@@ -57,33 +61,49 @@ class MainObject : public QObject
   // Audio Device
   //
   bool StartAudioDevice();
-  Ringbuffer *sir_ringbuffer;
+  BroadcastRingbuffer *sir_capture_ring;
   AudioDevice *sir_audio_device;
 
   //
   // Server Connection
   //
-  void StartServerConnection(const QString &mntpt="");
+  void StartServerConnection(Codec *codec,unsigned bitrate,
+			     const QString &mntpt="");
   std::vector<Connector *> sir_connectors;
 
   //
   // Codec
   //
-  bool StartCodec();
-  Codec * sir_codec;
+  bool StartCodec(Ringbuffer *ring,unsigned bitrate);
+  std::vector<Codec *> sir_codecs;
 
   //
   // Metadata Processor
   //
   MetaServer *sir_meta_server;
 
+  //
+  // HLS Origin
+  //
+  HlsOrigin *sir_hls_origin;
+  QDateTime sir_hls_origin_datetime;
+
+  //
+  // Loudness Meter
+  //
+  LoudnessMeter *sir_loudness_meter;
+
   //
   // Miscelaneous
   //
-  bool StartSingleStream();
+  bool StartStreams();
+  bool PipelineDrained() const;
+  std::vector<unsigned> RenditionBitrates() const;
   QTimer *sir_meter_timer;
+  QTimer *sir_stats_timer;
   QTimer *sir_exit_timer;
   unsigned sir_exit_count;
+  bool sir_draining;
 
   //
   // Stdin Processor
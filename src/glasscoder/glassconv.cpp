@@ -18,11 +18,16 @@
 //   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
 
+#include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <syslog.h>
 #include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -30,23 +35,68 @@
 #include <fstream>
 
 #include <QCoreApplication>
+#include <QDateTime>
 
 #ifdef HAVE_AWS_S3
-#include <aws/s3/model/PutObjectRequest.h>
-#include <aws/s3/model/DeleteObjectRequest.h>
+#include <aws/core/client/AsyncCallerContext.h>
+#include <aws/core/client/DefaultRetryStrategy.h>
+#include <aws/core/utils/threading/Executor.h>
+#include <aws/s3/model/Delete.h>
+#include <aws/s3/model/DeleteObjectsRequest.h>
 #include <aws/s3/model/ListObjectsV2Request.h>
+#include <aws/s3/model/ObjectIdentifier.h>
+#include <aws/s3/model/PutObjectRequest.h>
 #endif  // HAVE_AWS_S3
 
 #include "cmdswitch.h"
 #include "glassconv.h"
 #include "hlsconnector.h"
+#include "netconveyor.h"
 #include "profile.h"
 
+int CurlSocketCallback(CURL *handle,curl_socket_t sock,int what,
+		       void *priv,void *sock_priv)
+{
+  static_cast<MainObject *>(priv)->UpdateCurlSocket(sock,what);
+
+  return 0;
+}
+
+
+int CurlTimerCallback(CURLM *multi,long timeout_msecs,void *priv)
+{
+  MainObject *obj=static_cast<MainObject *>(priv);
+
+  if(timeout_msecs<0) {
+    obj->d_curl_timer->stop();
+  }
+  else {
+    obj->d_curl_timer->start(timeout_msecs);
+  }
+
+  return 0;
+}
+
+
 MainObject::MainObject(QObject *parent)
   : QObject(parent)
 {
   d_source_dir=NULL;
   d_dest_url=NULL;
+  d_inotify_fd=-1;
+  d_inotify_notifier=NULL;
+  d_conveyor_fd=-1;
+  d_conveyor_notifier=NULL;
+#ifdef HAVE_AWS_S3
+  d_s3_client=NULL;
+#endif  // HAVE_AWS_S3
+  d_s3_notify_fd=-1;
+  d_s3_notifier=NULL;
+  d_max_transfers=SERVER_MAX_UPLOADS_DEFAULT;
+  d_stopping=false;
+  d_transfer_serial=0;
+  d_retry_count=0;
+  d_abandon_count=0;
 
   int syslog_option=0;
 
@@ -63,6 +113,15 @@ MainObject::MainObject(QObject *parent)
       d_dest_url=new QUrl(cmd->value(i));
       cmd->setProcessed(i,true);
     }
+    if(cmd->key(i)=="--conveyor-fd") {
+      bool ok=false;
+      d_conveyor_fd=cmd->value(i).toInt(&ok);
+      if((!ok)||(d_conveyor_fd<0)) {
+	fprintf(stderr,"invalid --conveyor-fd argument\n");
+	CleanExit(Config::ExitFatal);
+      }
+      cmd->setProcessed(i,true);
+    }
     if(cmd->key(i)=="--debug") {
       syslog_option+=LOG_PERROR;
       cmd->setProcessed(i,true);
@@ -117,10 +176,21 @@ MainObject::MainObject(QObject *parent)
     Log(LOG_ERR,"curl global initialization failed");
     CleanExit(Config::ExitRetry);
   }
-  if((d_curl_handle=curl_easy_init())==NULL) {
+  if((d_curl_multi=curl_multi_init())==NULL) {
     Log(LOG_ERR,"curl initialization failed");
     CleanExit(Config::ExitRetry);
   }
+  d_curl_timer=new QTimer(this);
+  d_curl_timer->setSingleShot(true);
+  connect(d_curl_timer,SIGNAL(timeout()),this,SLOT(curlTimeoutData()));
+  d_retry_timer=new QTimer(this);
+  d_retry_timer->setSingleShot(true);
+  connect(d_retry_timer,SIGNAL(timeout()),this,SLOT(retryData()));
+  srandom(time(NULL)^getpid());
+  curl_multi_setopt(d_curl_multi,CURLMOPT_SOCKETFUNCTION,CurlSocketCallback);
+  curl_multi_setopt(d_curl_multi,CURLMOPT_SOCKETDATA,this);
+  curl_multi_setopt(d_curl_multi,CURLMOPT_TIMERFUNCTION,CurlTimerCallback);
+  curl_multi_setopt(d_curl_multi,CURLMOPT_TIMERDATA,this);
 
   //
   // Initialize AWS S3 API
@@ -134,6 +204,8 @@ MainObject::MainObject(QObject *parent)
   //
   // Load Credentials
   //
+  d_target_duration=HLS_SEGMENT_DURATION_DEFAULT;
+  d_window=HLS_WINDOW_DEFAULT;
   Profile *p=new Profile();
   if(p->setSource(d_source_dir->path()+"/"+GLASSCODER_CREDENTIALS)) {
     Log(LOG_DEBUG,"reading transfer credentials from \"%s\"",
@@ -143,6 +215,17 @@ MainObject::MainObject(QObject *parent)
     d_ssh_identity=p->stringValue("Credentials","SshIdentity");
     d_user_agent=p->stringValue("Credentials","UserAgent",
 				QString("GlassCoder/")+VERSION);
+    d_target_duration=p->intValue("Credentials","TargetDuration",
+				  HLS_SEGMENT_DURATION_DEFAULT);
+    d_window=p->intValue("Credentials","Window",HLS_WINDOW_DEFAULT);
+    d_max_transfers=p->intValue("Credentials","MaxTransfers",
+				SERVER_MAX_UPLOADS_DEFAULT);
+    if(d_max_transfers<SERVER_MAX_UPLOADS_MIN) {
+      d_max_transfers=SERVER_MAX_UPLOADS_MIN;
+    }
+    if(d_max_transfers>SERVER_MAX_UPLOADS_MAX) {
+      d_max_transfers=SERVER_MAX_UPLOADS_MAX;
+    }
     if(!p->stringValue("Credentials","PrecleanUrl").isEmpty()) {
       d_preclean_url=QUrl(p->stringValue("Credentials","PrecleanUrl"));
     }
@@ -156,6 +239,44 @@ MainObject::MainObject(QObject *parent)
   d_source_dir->setFilter(QDir::Files|QDir::Readable|QDir::NoDotAndDotDot);
   d_source_dir->setSorting(QDir::Name);
 
+  //
+  // Spool Watcher
+  //
+  // NetConveyor hard-links PUT files into the spool (IN_CREATE), and
+  // creates the empty DELETE and STOP files (IN_CLOSE_WRITE).  The scan
+  // timer is then just a safety net, in case of queue overflow.
+  //
+  if(((d_inotify_fd=inotify_init1(IN_NONBLOCK|IN_CLOEXEC))<0)||
+     (inotify_add_watch(d_inotify_fd,d_source_dir->path().toUtf8(),
+			IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE)<0)) {
+    Log(LOG_WARNING,"unable to watch source directory [%s], polling instead",
+	strerror(errno));
+    if(d_inotify_fd>=0) {
+      close(d_inotify_fd);
+      d_inotify_fd=-1;
+    }
+  }
+  else {
+    d_inotify_notifier=
+      new QSocketNotifier(d_inotify_fd,QSocketNotifier::Read,this);
+    connect(d_inotify_notifier,SIGNAL(activated(int)),
+	    this,SLOT(inotifyData(int)));
+  }
+
+  //
+  // Conveyor Socket
+  //
+  // With --server-memfd, glasscoder(1) hands over sealed memfds here
+  // rather than spooling files.
+  //
+  if(d_conveyor_fd>=0) {
+    fcntl(d_conveyor_fd,F_SETFD,FD_CLOEXEC);
+    d_conveyor_notifier=
+      new QSocketNotifier(d_conveyor_fd,QSocketNotifier::Read,this);
+    connect(d_conveyor_notifier,SIGNAL(activated(int)),
+	    this,SLOT(conveyorData(int)));
+  }
+
   //
   // Scan Timer
   //
@@ -163,6 +284,26 @@ MainObject::MainObject(QObject *parent)
   d_scan_timer->setSingleShot(true);
   connect(d_scan_timer,SIGNAL(timeout()),this,SLOT(scanData()));
 
+  //
+  // S3 Client
+  //
+  // Requests run on the SDK's own threads, which hand their results
+  // back to us through PostS3Result().
+  //
+#ifdef HAVE_AWS_S3
+  if(d_dest_url->scheme().toLower()=="s3") {
+    if((d_s3_notify_fd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC))<0) {
+      Log(LOG_ERR,"unable to create S3 completion fd [%s]",strerror(errno));
+      CleanExit(Config::ExitRetry);
+    }
+    d_s3_notifier=
+      new QSocketNotifier(d_s3_notify_fd,QSocketNotifier::Read,this);
+    connect(d_s3_notifier,SIGNAL(activated(int)),
+	    this,SLOT(s3CompletionData(int)));
+    d_s3_client=NewS3Client();
+  }
+#endif  // HAVE_AWS_S3
+
   //
   // Preclean PublishPoint
   //
@@ -187,10 +328,173 @@ void MainObject::scanData()
   QStringList files=d_source_dir->entryList(QStringList());
 
   for(int i=0;i<files.size();i++) {
-    ProcessFile(d_source_dir->path()+"/"+files.at(i));
+    d_pending_files.insert(files.at(i));
+  }
+  ProcessPendingFiles();
+
+  if(d_inotify_fd<0) {
+    d_scan_timer->start(GLASSCONV_SCAN_INTERVAL);
+  }
+  else {
+    d_scan_timer->start(GLASSCONV_SWEEP_INTERVAL);
+  }
+}
+
+
+void MainObject::inotifyData(int fd)
+{
+  char buffer[GLASSCONV_INOTIFY_BUFFER_SIZE]
+    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *evt=NULL;
+  ssize_t n;
+
+  while((n=read(fd,buffer,GLASSCONV_INOTIFY_BUFFER_SIZE))>0) {
+    for(char *ptr=buffer;ptr<(buffer+n);
+	ptr+=sizeof(struct inotify_event)+evt->len) {
+      evt=(const struct inotify_event *)ptr;
+      if((evt->mask&IN_Q_OVERFLOW)!=0) {
+	d_scan_timer->start(0);  // Events were lost, so sweep
+      }
+      if((evt->len>0)&&((evt->mask&IN_ISDIR)==0)) {
+	d_pending_files.insert(QString::fromUtf8(evt->name));
+      }
+    }
+  }
+  ProcessPendingFiles();
+}
+
+
+void MainObject::ProcessPendingFiles()
+{
+  //
+  // Spool file names begin with a timestamp, so this keeps them in the
+  // order that they were pushed.  A file can be reported more than once
+  // (e.g. IN_CREATE then IN_CLOSE_WRITE), so skip any that have already
+  // gone or that are already queued for transfer.
+  //
+  while(d_pending_files.size()>0) {
+    QString pathname=d_source_dir->path()+"/"+*d_pending_files.begin();
+    d_pending_files.erase(d_pending_files.begin());
+    if((d_transfer_pathnames.count(pathname)==0)&&
+       (access(pathname.toUtf8(),F_OK)==0)) {
+      ProcessFile(pathname);
+    }
   }
+}
+
+
+void MainObject::conveyorData(int fd)
+{
+  struct NetConveyorMessage cmsg;
+  struct msghdr msg;
+  struct iovec iov[1];
+  union {
+    struct cmsghdr cm;
+    char control[CMSG_SPACE(sizeof(int))];
+  } control_un;
+  struct cmsghdr *cmptr;
+  ssize_t n;
+  int rfd;
+
+  while(true) {
+    memset(&msg,0,sizeof(msg));
+    memset(iov,0,sizeof(struct iovec));
+    msg.msg_control=control_un.control;
+    msg.msg_controllen=sizeof(control_un.control);
+    iov[0].iov_base=&cmsg;
+    iov[0].iov_len=sizeof(cmsg);
+    msg.msg_iov=iov;
+    msg.msg_iovlen=1;
+    if((n=recvmsg(fd,&msg,MSG_DONTWAIT|MSG_CMSG_CLOEXEC))<0) {
+      if((errno!=EAGAIN)&&(errno!=EWOULDBLOCK)) {
+	Log(LOG_WARNING,"conveyor socket read failed [%s]",strerror(errno));
+      }
+      return;
+    }
+    if(n==0) {  // glasscoder(1) has gone away
+      Log(LOG_DEBUG,"conveyor socket closed");
+      d_conveyor_notifier->setEnabled(false);
+      return;
+    }
+    rfd=-1;
+    if(((cmptr=CMSG_FIRSTHDR(&msg))!=NULL)&&
+       (cmptr->cmsg_len==CMSG_LEN(sizeof(int)))&&
+       (cmptr->cmsg_level==SOL_SOCKET)&&(cmptr->cmsg_type==SCM_RIGHTS)) {
+      rfd=*((int *)CMSG_DATA(cmptr));
+    }
+    if((n!=sizeof(cmsg))||(cmsg.magic!=NETCONVEYOR_MESSAGE_MAGIC)) {
+      Log(LOG_WARNING,"malformed conveyor message, skipping");
+      if(rfd>=0) {
+	close(rfd);
+      }
+      continue;
+    }
+    cmsg.destname[NETCONVEYOR_MAX_DESTNAME]=0;
+    ProcessMessage(cmsg,rfd);
+  }
+}
+
 
-  d_scan_timer->start(1000);
+void MainObject::curlReadData(int fd)
+{
+  int running=0;
+
+  curl_multi_socket_action(d_curl_multi,fd,CURL_CSELECT_IN,&running);
+  ProcessCurlMessages();
+}
+
+
+void MainObject::curlWriteData(int fd)
+{
+  int running=0;
+
+  curl_multi_socket_action(d_curl_multi,fd,CURL_CSELECT_OUT,&running);
+  ProcessCurlMessages();
+}
+
+
+void MainObject::curlTimeoutData()
+{
+  int running=0;
+
+  curl_multi_socket_action(d_curl_multi,CURL_SOCKET_TIMEOUT,0,&running);
+  ProcessCurlMessages();
+}
+
+
+void MainObject::retryData()
+{
+  StartTransfers();
+}
+
+
+void MainObject::s3CompletionData(int fd)
+{
+  uint64_t count=0;
+  std::list<std::pair<uint64_t,Transfer::Result> > results;
+
+  if(read(fd,&count,sizeof(count))<0) {
+    return;
+  }
+  d_s3_mutex.lock();
+  results.swap(d_s3_results);
+  d_s3_mutex.unlock();
+
+  //
+  // Transfers stay active until their results come back here, so that
+  // d_max_transfers bounds the number of requests in flight
+  //
+  for(std::list<std::pair<uint64_t,Transfer::Result> >::const_iterator
+	it=results.begin();it!=results.end();it++) {
+    for(std::list<Transfer *>::iterator jt=d_active_transfers.begin();
+	jt!=d_active_transfers.end();jt++) {
+      if((*jt)->serial==it->first) {
+	CompleteTransfer(*jt,it->second);
+	break;
+      }
+    }
+  }
+  StartTransfers();
 }
 
 
@@ -216,17 +520,157 @@ void MainObject::ProcessFile(const QString &filename)
   QString destname=f1.at(2);
   Log(LOG_NOTICE,"method: %s  destname: %s",method.toUtf8().constData(),
       destname.toUtf8().constData());
+
+  //
+  // Reckoned from the timestamp in the spool file name, so that it holds
+  // across a restart
+  //
+  bool ok=false;
+  qint64 deadline=1000*f1.at(0).left(20).toLongLong(&ok);
+  if(!ok) {
+    deadline=QDateTime::currentMSecsSinceEpoch();
+  }
+  deadline=TransferDeadline(deadline);
+
   if(method=="DELETE") {
-    Delete(destname);
-    UnlinkLocalFile(filename);
+    QueueTransfer(MainObject::Transfer::Delete,destname,filename,-1,
+		  deadline);
     return;
   }
   if(method=="PUT") {
-    Put(destname,filename);
-    UnlinkLocalFile(filename);
+    QueueTransfer(MainObject::Transfer::Put,destname,filename,-1,deadline);
     return;
   }
   if(method=="STOP") {
+    //
+    // Let the transfers already queued finish first
+    //
+    d_stopping=true;
+    UnlinkLocalFile(filename);
+    StartTransfers();
+    return;
+  }
+  Log(LOG_WARNING,
+	 "unsupported transfer method in \"%s\", skipping",
+	 filename.toUtf8().constData());
+  UnlinkLocalFile(filename);
+}
+
+
+void MainObject::ProcessMessage(const struct NetConveyorMessage &msg,int fd)
+{
+  QString destname=QString::fromUtf8(msg.destname);
+  qint64 deadline=TransferDeadline(1000*(qint64)msg.timestamp);
+
+  Log(LOG_NOTICE,"method: %s  destname: %s",
+      NetConveyorEvent::httpMethodString((NetConveyorEvent::HttpMethod)
+					 msg.method).toUtf8().constData(),
+      destname.toUtf8().constData());
+  switch((NetConveyorEvent::HttpMethod)msg.method) {
+  case NetConveyorEvent::PutMethod:
+    if(fd<0) {
+      Log(LOG_WARNING,"no data passed for \"%s\", skipping",
+	  destname.toUtf8().constData());
+      return;
+    }
+    QueueTransfer(MainObject::Transfer::Put,destname,
+		  QString::asprintf("/proc/self/fd/%d",fd),fd,deadline);
+    return;
+
+  case NetConveyorEvent::DeleteMethod:
+    QueueTransfer(MainObject::Transfer::Delete,destname,QString(),-1,
+		  deadline);
+    break;
+
+  case NetConveyorEvent::StopMethod:
+    d_stopping=true;
+    StartTransfers();
+    break;
+
+  default:
+    Log(LOG_WARNING,"unsupported transfer method %u for \"%s\", skipping",
+	msg.method,destname.toUtf8().constData());
+    break;
+  }
+  if(fd>=0) {
+    close(fd);
+  }
+}
+
+
+qint64 MainObject::TransferDeadline(qint64 timestamp) const
+{
+  //
+  // Give up on a transfer once its object has aged out of the live window
+  //
+  return timestamp+1000*(qint64)d_target_duration*d_window;
+}
+
+
+void MainObject::QueueTransfer(MainObject::Transfer::Method meth,
+			       const QString &destname,const QString &pathname,
+			       int fd,qint64 deadline)
+{
+  //
+  // Anything still waiting to go to the same destination is now stale
+  //
+  std::list<Transfer *>::iterator it=d_queued_transfers.begin();
+  while(it!=d_queued_transfers.end()) {
+    Transfer *prev=*it++;
+    if(prev->destname==destname) {
+      Log(LOG_DEBUG,"pending transfer of \"%s\" superseded",
+	  destname.toUtf8().constData());
+      FinishTransfer(prev);
+    }
+  }
+
+  Transfer *t=new Transfer;
+
+  t->method=meth;
+  t->destname=destname;
+  t->pathname=pathname;
+  t->fd=fd;
+  t->serial=d_transfer_serial++;
+  t->attempts=0;
+  t->deadline=deadline;
+  t->retry_time=0;
+  t->handle=NULL;
+  t->file=NULL;
+  t->quote=NULL;
+  t->errorbuffer[0]=0;
+  d_queued_transfers.push_back(t);
+  if(fd<0) {
+    d_transfer_pathnames.insert(pathname);
+  }
+
+  StartTransfers();
+}
+
+
+void MainObject::StartTransfers()
+{
+  //
+  // Uploads get first call on free slots
+  //
+  while(StartNextTransfer(MainObject::Transfer::Put));
+  while(StartNextTransfer(MainObject::Transfer::Delete));
+
+  //
+  // Wake up for the next retry
+  //
+  qint64 now=QDateTime::currentMSecsSinceEpoch();
+  qint64 next=0;
+  for(std::list<Transfer *>::const_iterator it=d_queued_transfers.begin();
+      it!=d_queued_transfers.end();it++) {
+    if(((*it)->retry_time>now)&&((next==0)||((*it)->retry_time<next))) {
+      next=(*it)->retry_time;
+    }
+  }
+  if(next>0) {
+    d_retry_timer->start(next-now);
+  }
+
+  if(d_stopping&&d_queued_transfers.empty()&&d_active_transfers.empty()) {
     //
     // Clean up temp directory
     //
@@ -236,255 +680,705 @@ void MainObject::ProcessFile(const QString &filename)
     }
     rmdir(d_source_dir->path().toUtf8());
 
-    Log(LOG_DEBUG,"exiting normally");
+    Log(LOG_DEBUG,"exiting normally, %u transfer(s) retried, %u abandoned",
+	d_retry_count,d_abandon_count);
     CleanExit(Config::ExitOk);
   }
-  Log(LOG_WARNING,
-	 "unsupported transfer method in \"%s\", skipping",
-	 filename.toUtf8().constData());
-  UnlinkLocalFile(filename);
 }
 
 
-void MainObject::Put(const QString &destname,const QString &srcname)
+bool MainObject::StartNextTransfer(MainObject::Transfer::Method meth)
+{
+  unsigned deletes=0;
+  qint64 now=QDateTime::currentMSecsSinceEpoch();
+
+  if(d_active_transfers.size()>=d_max_transfers) {
+    return false;
+  }
+
+  //
+  // Deletions may never take the last free slot, so that they can't
+  // hold up uploads
+  //
+  if(meth==MainObject::Transfer::Delete) {
+    for(std::list<Transfer *>::const_iterator it=d_active_transfers.begin();
+	it!=d_active_transfers.end();it++) {
+      if((*it)->method==MainObject::Transfer::Delete) {
+	deletes++;
+      }
+    }
+    if((d_max_transfers>1)&&(deletes>=(d_max_transfers-1))) {
+      return false;
+    }
+  }
+
+  if((meth==MainObject::Transfer::Delete)&&
+     (d_dest_url->scheme().toLower()=="s3")) {
+    unsigned limit=d_max_transfers-d_active_transfers.size();
+    if((d_max_transfers>1)&&((d_max_transfers-1-deletes)<limit)) {
+      limit=d_max_transfers-1-deletes;
+    }
+    return StartS3Deletes(limit);
+  }
+
+  for(std::list<Transfer *>::iterator it=d_queued_transfers.begin();
+      it!=d_queued_transfers.end();it++) {
+    if(((*it)->method==meth)&&((*it)->retry_time<=now)&&
+       (!TransferIsBlocked(it))) {
+      Transfer *t=*it;
+      d_queued_transfers.erase(it);
+      d_active_transfers.push_back(t);
+      StartTransfer(t);
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool MainObject::StartS3Deletes(unsigned limit)
+{
+  //
+  // As much as is ready to go and will fit in the free slots goes out
+  // in a single DeleteObjects request.  Each transfer holds its slot
+  // until the request completes.
+  //
+  qint64 now=QDateTime::currentMSecsSinceEpoch();
+  std::list<Transfer *> batch;
+  bool started=false;
+
+  std::list<Transfer *>::iterator it=d_queued_transfers.begin();
+  while((it!=d_queued_transfers.end())&&
+	(batch.size()<limit)&&(batch.size()<GLASSCONV_S3_DELETE_BATCH_SIZE)) {
+    if(((*it)->method==MainObject::Transfer::Delete)&&
+       ((*it)->retry_time<=now)&&(!TransferIsBlocked(it))) {
+      Transfer *t=*it;
+      it=d_queued_transfers.erase(it);
+      d_active_transfers.push_back(t);
+      started=true;
+      if(now>=t->deadline) {
+	AbandonTransfer(t);
+      }
+      else {
+	Log(LOG_DEBUG,"removing \"%s/%s\"",
+	    d_dest_url->toDisplayString().toUtf8().constData(),
+	    t->destname.toUtf8().constData());
+	batch.push_back(t);
+      }
+    }
+    else {
+      it++;
+    }
+  }
+  if(batch.size()==0) {
+    return started;
+  }
+  DeleteAwsS3(batch);
+  return true;
+}
+
+
+bool MainObject::TransferIsBlocked(std::list<Transfer *>::iterator it) const
+{
+  //
+  // A transfer waits for any earlier one to the same destination, and
+  // a playlist upload for every earlier segment upload, so that players
+  // never see a playlist that refers to something that isn't there yet.
+  //
+  bool playlist=((*it)->method==MainObject::Transfer::Put)&&
+    IsPlaylist((*it)->destname);
+
+  for(std::list<Transfer *>::const_iterator jt=d_active_transfers.begin();
+      jt!=d_active_transfers.end();jt++) {
+    if(TransferDependsOn(*it,*jt,playlist)) {
+      return true;
+    }
+  }
+  for(std::list<Transfer *>::const_iterator jt=d_queued_transfers.begin();
+      *jt!=*it;jt++) {
+    if(TransferDependsOn(*it,*jt,playlist)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool MainObject::TransferDependsOn(const Transfer *t,const Transfer *prev,
+				   bool playlist) const
 {
-  Log(LOG_DEBUG,"uploading \"%s\" to \"%s/%s\"",
-	 srcname.toUtf8().constData(),
-	 d_dest_url->toDisplayString().toUtf8().constData(),
-	 destname.toUtf8().constData());
+  if(prev->destname==t->destname) {
+    return true;
+  }
+  return playlist&&(prev->method==MainObject::Transfer::Put)&&
+    (!IsPlaylist(prev->destname));
+}
+
+
+bool MainObject::IsPlaylist(const QString &destname) const
+{
+  QString ext=destname.split(".").last().toLower();
+
+  return (ext=="m3u8")||(ext=="m3u");
+}
 
+
+void MainObject::StartTransfer(Transfer *t)
+{
   QString scheme=d_dest_url->scheme().toLower();
 
-  if((scheme=="http")||(scheme=="https")||(scheme=="file")||(scheme=="sftp")) {
-    PutCurl(destname,srcname);
+  if(QDateTime::currentMSecsSinceEpoch()>=t->deadline) {
+    AbandonTransfer(t);
+    return;
+  }
+
+  //
+  // Deletions from a local filesystem are completed here and now (S3
+  // deletions are batched up by StartS3Deletes())
+  //
+  if(t->method==MainObject::Transfer::Put) {
+    Log(LOG_DEBUG,"uploading \"%s\" to \"%s/%s\"",
+	t->pathname.toUtf8().constData(),
+	d_dest_url->toDisplayString().toUtf8().constData(),
+	t->destname.toUtf8().constData());
+    if(scheme=="s3") {
+      if(!PutAwsS3(t)) {
+	CompleteTransfer(t,MainObject::Transfer::Failure);
+      }
+      return;
+    }
+    if((t->handle=curl_easy_init())==NULL) {
+      Log(LOG_WARNING,"upload of \"%s\" failed: curl initialization failed",
+	  t->pathname.toUtf8().constData());
+      CompleteTransfer(t,MainObject::Transfer::Retry);
+      return;
+    }
+    if(!PutCurl(t)) {
+      CompleteTransfer(t,MainObject::Transfer::Failure);
+      return;
+    }
+  }
+  else {
+    Log(LOG_DEBUG,"removing \"%s/%s\"",
+	d_dest_url->toDisplayString().toUtf8().constData(),
+	t->destname.toUtf8().constData());
+    if(scheme=="file") {
+      CompleteTransfer(t,DeleteFile(t->destname));
+      return;
+    }
+    if((t->handle=curl_easy_init())==NULL) {
+      Log(LOG_WARNING,"removal of \"%s\" failed: curl initialization failed",
+	  t->destname.toUtf8().constData());
+      CompleteTransfer(t,MainObject::Transfer::Retry);
+      return;
+    }
+    if(scheme=="sftp") {
+      DeleteSftp(t);
+    }
+    else {
+      DeleteHttp(t);
+    }
+  }
+  curl_easy_setopt(t->handle,CURLOPT_PRIVATE,t);
+  curl_easy_setopt(t->handle,CURLOPT_ERRORBUFFER,t->errorbuffer);
+  curl_multi_add_handle(d_curl_multi,t->handle);
+}
+
+
+void MainObject::CompleteTransfer(Transfer *t,
+				  MainObject::Transfer::Result result)
+{
+  switch(result) {
+  case MainObject::Transfer::Success:
+    FinishTransfer(t);
+    break;
+
+  case MainObject::Transfer::Retry:
+    RetryTransfer(t);
+    break;
+
+  case MainObject::Transfer::Failure:
+    AbandonTransfer(t);
+    break;
+  }
+}
+
+
+void MainObject::RetryTransfer(Transfer *t)
+{
+  //
+  // Exponential backoff, with half of each interval randomized so that
+  // streams sharing a failed server don't all come back at once
+  //
+  qint64 interval=GLASSCONV_RETRY_MAX_INTERVAL;
+  if(t->attempts<16) {
+    interval=GLASSCONV_RETRY_MIN_INTERVAL<<t->attempts;
+    if(interval>GLASSCONV_RETRY_MAX_INTERVAL) {
+      interval=GLASSCONV_RETRY_MAX_INTERVAL;
+    }
+  }
+  interval=interval/2+random()%(interval/2+1);
+  qint64 now=QDateTime::currentMSecsSinceEpoch();
+  if((now+interval)>=t->deadline) {
+    AbandonTransfer(t);
+    return;
+  }
+  ReleaseTransfer(t);
+  t->attempts++;
+  t->retry_time=now+interval;
+  d_retry_count++;
+  Log(LOG_NOTICE,"retrying \"%s\" in %lld mS (attempt %u)",
+      t->destname.toUtf8().constData(),(long long)interval,t->attempts+1);
+
+  //
+  // Back into the queue in its original place, so that whatever depends
+  // on it continues to wait
+  //
+  std::list<Transfer *>::iterator it=d_queued_transfers.begin();
+  while((it!=d_queued_transfers.end())&&((*it)->serial<t->serial)) {
+    it++;
+  }
+  d_active_transfers.remove(t);
+  d_queued_transfers.insert(it,t);
+}
+
+
+void MainObject::AbandonTransfer(Transfer *t)
+{
+  d_abandon_count++;
+  Log(LOG_WARNING,
+      "abandoning \"%s\" after %u attempt(s) [%u abandoned, %u retries]",
+      t->destname.toUtf8().constData(),t->attempts+1,
+      d_abandon_count,d_retry_count);
+  FinishTransfer(t);
+}
+
+
+void MainObject::FinishTransfer(Transfer *t)
+{
+  ReleaseTransfer(t);
+  if(t->fd>=0) {
+    close(t->fd);
+  }
+  else {
+    if(!t->pathname.isEmpty()) {
+      UnlinkLocalFile(t->pathname);
+    }
+    d_transfer_pathnames.erase(t->pathname);
+  }
+  d_queued_transfers.remove(t);
+  d_active_transfers.remove(t);
+  delete t;
+}
+
+
+void MainObject::ReleaseTransfer(Transfer *t)
+{
+  if(t->handle!=NULL) {
+    curl_multi_remove_handle(d_curl_multi,t->handle);
+    curl_easy_cleanup(t->handle);
+    t->handle=NULL;
+  }
+  if(t->file!=NULL) {
+    fclose(t->file);
+    t->file=NULL;
   }
-  if(scheme=="s3") {
-    PutAwsS3(destname,srcname);
+  if(t->quote!=NULL) {
+    curl_slist_free_all(t->quote);
+    t->quote=NULL;
   }
+  t->errorbuffer[0]=0;
 }
 
 
-void MainObject::PutCurl(const QString &destname,const QString &srcname)
+void MainObject::ProcessCurlMessages()
+{
+  CURLMsg *msg=NULL;
+  int remaining=0;
+  Transfer *t=NULL;
+
+  while((msg=curl_multi_info_read(d_curl_multi,&remaining))!=NULL) {
+    if(msg->msg!=CURLMSG_DONE) {
+      continue;
+    }
+    curl_easy_getinfo(msg->easy_handle,CURLINFO_PRIVATE,(char **)&t);
+    CompleteTransfer(t,CurlResult(t,msg->data.result));
+  }
+  StartTransfers();
+}
+
+
+MainObject::Transfer::Result MainObject::CurlResult(Transfer *t,
+						    CURLcode code) const
 {
   long resp_code=0;
-  FILE *f=fopen(srcname.toUtf8(),"r");
-  if(f==NULL) {
-    Log(LOG_WARNING,"upload of \"%s\" failed: %s",
-	   srcname.toUtf8().constData(),strerror(errno));
+  QString name=t->pathname;
+  const char *verb="upload";
+
+  if((t->method==MainObject::Transfer::Delete)||(t->fd>=0)) {
+    name=t->destname;
+  }
+  if(t->method==MainObject::Transfer::Delete) {
+    verb="removal";
+  }
+
+  if(code!=CURLE_OK) {
+    if((t->quote!=NULL)&&(code==CURLE_REMOTE_FILE_NOT_FOUND)) {
+      return MainObject::Transfer::Success;  // SFTP file already gone
+    }
+    Log(LOG_WARNING,"%s of \"%s\" failed: [%d] %s",verb,
+	name.toUtf8().constData(),code,t->errorbuffer);
+    switch(code) {
+    case CURLE_UNSUPPORTED_PROTOCOL:
+    case CURLE_URL_MALFORMAT:
+    case CURLE_READ_ERROR:
+    case CURLE_LOGIN_DENIED:
+    case CURLE_REMOTE_ACCESS_DENIED:
+      return MainObject::Transfer::Failure;
+
+    default:
+      return MainObject::Transfer::Retry;
+    }
+  }
+
+  curl_easy_getinfo(t->handle,CURLINFO_RESPONSE_CODE,&resp_code);
+  if((resp_code==0)||((resp_code>=200)&&(resp_code<300))) {
+    return MainObject::Transfer::Success;
+  }
+  if((t->method==MainObject::Transfer::Delete)&&
+     ((resp_code==404)||(resp_code==410))) {
+    return MainObject::Transfer::Success;
+  }
+  Log(LOG_WARNING,"%s of \"%s\" returned code %lu",verb,
+      name.toUtf8().constData(),resp_code);
+  if((resp_code==408)||(resp_code==429)||(resp_code>=500)) {
+    return MainObject::Transfer::Retry;
+  }
+  return MainObject::Transfer::Failure;
+}
+
+
+void MainObject::UpdateCurlSocket(curl_socket_t sock,int what)
+{
+  //
+  // Notifiers may be torn down from within their own activated() signal,
+  // hence deleteLater()
+  //
+  std::map<int,QSocketNotifier *>::iterator rt=
+    d_curl_read_notifiers.find(sock);
+  std::map<int,QSocketNotifier *>::iterator wt=
+    d_curl_write_notifiers.find(sock);
+
+  if(what==CURL_POLL_REMOVE) {
+    if(rt!=d_curl_read_notifiers.end()) {
+      rt->second->setEnabled(false);
+      rt->second->deleteLater();
+      d_curl_read_notifiers.erase(rt);
+    }
+    if(wt!=d_curl_write_notifiers.end()) {
+      wt->second->setEnabled(false);
+      wt->second->deleteLater();
+      d_curl_write_notifiers.erase(wt);
+    }
     return;
   }
+  if(rt==d_curl_read_notifiers.end()) {
+    QSocketNotifier *n=new QSocketNotifier(sock,QSocketNotifier::Read,this);
+    connect(n,SIGNAL(activated(int)),this,SLOT(curlReadData(int)));
+    rt=d_curl_read_notifiers.insert(std::make_pair((int)sock,n)).first;
+  }
+  if(wt==d_curl_write_notifiers.end()) {
+    QSocketNotifier *n=new QSocketNotifier(sock,QSocketNotifier::Write,this);
+    connect(n,SIGNAL(activated(int)),this,SLOT(curlWriteData(int)));
+    wt=d_curl_write_notifiers.insert(std::make_pair((int)sock,n)).first;
+  }
+  rt->second->setEnabled((what&CURL_POLL_IN)!=0);
+  wt->second->setEnabled((what&CURL_POLL_OUT)!=0);
+}
+
+
+bool MainObject::PutCurl(Transfer *t)
+{
+  if((t->file=fopen(t->pathname.toUtf8(),"r"))==NULL) {
+    Log(LOG_WARNING,"upload of \"%s\" failed: %s",
+	   t->pathname.toUtf8().constData(),strerror(errno));
+    return false;
+  }
   struct stat st;
   memset(&st,0,sizeof(st));
-  stat(srcname.toUtf8(),&st);
+  stat(t->pathname.toUtf8(),&st);
 
-  QUrl url(d_dest_url->toDisplayString()+"/"+destname);
-
-  curl_easy_reset(d_curl_handle);
+  QUrl url(d_dest_url->toDisplayString()+"/"+t->destname);
 
   //
   // Authentication
   //
-  SetCurlAuthentication(d_curl_handle);
+  SetCurlAuthentication(t->handle);
 
   //
   // Transaction
   //
-  curl_easy_setopt(d_curl_handle,CURLOPT_ERRORBUFFER,d_curl_errorbuffer);
-  curl_easy_setopt(d_curl_handle,CURLOPT_READDATA,(void *)f);
+  curl_easy_setopt(t->handle,CURLOPT_READDATA,(void *)t->file);
   if(st.st_size>0) {
-    curl_easy_setopt(d_curl_handle,CURLOPT_INFILESIZE,st.st_size);
+    curl_easy_setopt(t->handle,CURLOPT_INFILESIZE,st.st_size);
   }
-  curl_easy_setopt(d_curl_handle,CURLOPT_URL,url.toEncoded().constData());
-  curl_easy_setopt(d_curl_handle,CURLOPT_UPLOAD,1);
-  curl_easy_setopt(d_curl_handle,CURLOPT_FOLLOWLOCATION,1);
-  curl_easy_setopt(d_curl_handle,CURLOPT_USERAGENT,
+  curl_easy_setopt(t->handle,CURLOPT_URL,url.toEncoded().constData());
+  curl_easy_setopt(t->handle,CURLOPT_UPLOAD,1);
+  curl_easy_setopt(t->handle,CURLOPT_FOLLOWLOCATION,1);
+  curl_easy_setopt(t->handle,CURLOPT_USERAGENT,
 		   d_user_agent.toUtf8().constData());
-  CURLcode code=curl_easy_perform(d_curl_handle);
-  if(code==CURLE_OK) {
-    curl_easy_getinfo(d_curl_handle,CURLINFO_RESPONSE_CODE,&resp_code);
-    if(((resp_code<200)||(resp_code>=300))&&(resp_code!=0)) {
-      Log(LOG_WARNING,"upload of \"%s\" returned code %lu",
-	     srcname.toUtf8().constData(),resp_code);
-    }
-  }
-  else {
-    Log(LOG_WARNING,"upload of \"%s\" failed: %s",
-	   srcname.toUtf8().constData(),d_curl_errorbuffer);
-  }
-  fclose(f);
+
+  return true;
 }
 
 
-void MainObject::PutAwsS3(const QString &destname,const QString &srcname)
+bool MainObject::PutAwsS3(Transfer *t)
 {
 #ifdef HAVE_AWS_S3
   QStringList f0=d_dest_url->toDisplayString().split("/");
   QString bucket=f0.last();
-  QString key=destname;
-
-  Aws::S3::S3ClientConfiguration config;
-  config.profileName=d_username.toUtf8().constData();
-  Aws::S3::S3Client client(config);
+  QString key=t->destname;
+  uint64_t serial=t->serial;
 
   Aws::S3::Model::PutObjectRequest request;
   request.SetBucket(bucket.toUtf8().constData());
   request.SetKey(key.toUtf8().constData());
   SetS3FileMetadata(request,key);
   std::shared_ptr<Aws::IOStream> in=
-    Aws::MakeShared<Aws::FStream>("SomeTag",srcname.toUtf8().constData(),
+    Aws::MakeShared<Aws::FStream>("SomeTag",t->pathname.toUtf8().constData(),
 				  std::ios_base::in|std::ios_base::binary);
   if(!*in) {
-    Log(LOG_WARNING,"unable to read file \"%s\"",srcname.toUtf8().constData());
-    return;
+    Log(LOG_WARNING,"unable to read file \"%s\"",
+	t->pathname.toUtf8().constData());
+    return false;
   }
   request.SetBody(in);
-  Aws::S3::Model::PutObjectOutcome out=client.PutObject(request);
-  if(!out.IsSuccess()) {
-    auto err=out.GetError();
-    Log(LOG_WARNING,"S3 PutObject to \"%s\%s\" failed [%s]",
-	bucket.toUtf8().constData(),key.toUtf8().constData(),
-	err.GetMessage().c_str());
-
-  }
+  d_s3_client->PutObjectAsync(request,[this,bucket,key,serial]
+    (const Aws::S3::S3Client *,const Aws::S3::Model::PutObjectRequest &,
+     const Aws::S3::Model::PutObjectOutcome &out,
+     const std::shared_ptr<const Aws::Client::AsyncCallerContext> &) {
+      if(out.IsSuccess()) {
+	PostS3Result(serial,MainObject::Transfer::Success);
+	return;
+      }
+      auto err=out.GetError();
+      Log(LOG_WARNING,"S3 PutObject to \"%s/%s\" failed [%s]",
+	  bucket.toUtf8().constData(),key.toUtf8().constData(),
+	  err.GetMessage().c_str());
+      if(err.ShouldRetry()) {
+	PostS3Result(serial,MainObject::Transfer::Retry);
+      }
+      else {
+	PostS3Result(serial,MainObject::Transfer::Failure);
+      }
+    });
+  return true;
 #else  // HAVE_AWS_S3
   Log(LOG_WARNING,"AWS S3 support has not been enabled, ignoring PUT request");
+  return false;
 #endif  // HAVE_AWS_S3
 }
 
 
-void MainObject::Delete(const QString &destname)
+void MainObject::PostS3Result(uint64_t serial,
+			      MainObject::Transfer::Result result)
 {
-  Log(LOG_DEBUG,"removing \"%s/%s\"",
-	 d_dest_url->toDisplayString().toUtf8().constData(),
-	 destname.toUtf8().constData());
-
-  QString scheme=d_dest_url->scheme().toLower();
+  //
+  // Called from the SDK's threads
+  //
+  uint64_t count=1;
 
-  if((scheme=="http")||(scheme=="https")) {
-    DeleteHttp(destname);
-  }
-  if(scheme=="file") {
-    DeleteFile(destname);
-  }
-  if(scheme=="sftp") {
-    DeleteSftp(destname);
-  }
-  if(scheme=="s3") {
-    DeleteAwsS3(destname);
+  d_s3_mutex.lock();
+  d_s3_results.push_back(std::make_pair(serial,result));
+  d_s3_mutex.unlock();
+  if(write(d_s3_notify_fd,&count,sizeof(count))<0) {
+    Log(LOG_WARNING,"unable to post S3 completion [%s]",strerror(errno));
   }
 }
 
 
-void MainObject::DeleteHttp(const QString &destname)
+void MainObject::DeleteHttp(Transfer *t)
 {
-  long resp_code=0;
-  QUrl url(d_dest_url->toDisplayString()+"/"+destname);
+  QUrl url(d_dest_url->toDisplayString()+"/"+t->destname);
 
-  curl_easy_reset(d_curl_handle);
-  curl_easy_setopt(d_curl_handle,CURLOPT_ERRORBUFFER,d_curl_errorbuffer);
   if(!d_username.isEmpty()) {
-    curl_easy_setopt(d_curl_handle,CURLOPT_USERPWD,
+    curl_easy_setopt(t->handle,CURLOPT_USERPWD,
 		     (d_username+":"+d_password).toUtf8().constData());
   }
-  curl_easy_setopt(d_curl_handle,CURLOPT_URL,url.toEncoded().constData());
-  curl_easy_setopt(d_curl_handle,CURLOPT_CUSTOMREQUEST,"DELETE");
-  curl_easy_setopt(d_curl_handle,CURLOPT_FOLLOWLOCATION,1);
-  curl_easy_setopt(d_curl_handle,CURLOPT_USERAGENT,
+  curl_easy_setopt(t->handle,CURLOPT_URL,url.toEncoded().constData());
+  curl_easy_setopt(t->handle,CURLOPT_CUSTOMREQUEST,"DELETE");
+  curl_easy_setopt(t->handle,CURLOPT_FOLLOWLOCATION,1);
+  curl_easy_setopt(t->handle,CURLOPT_USERAGENT,
 		   d_user_agent.toUtf8().constData());
-  CURLcode code=curl_easy_perform(d_curl_handle);
-  if(code==CURLE_OK) {
-    curl_easy_getinfo(d_curl_handle,CURLINFO_RESPONSE_CODE,&resp_code);
-    if((resp_code<200)||(resp_code>=300)) {
-      Log(LOG_WARNING,"removal of \"%s\" returned code %lu",
-	     destname.toUtf8().constData(),resp_code);
-    }
-  }
-  else {
-    Log(LOG_WARNING,"removal of \"%s\" failed: %s",
-	   url.toDisplayString().toUtf8().constData(),d_curl_errorbuffer);
-  }
 }
 
 
-void MainObject::DeleteFile(const QString &destname)
+MainObject::Transfer::Result MainObject::DeleteFile(const QString &destname)
 {
   QUrl url(d_dest_url->toDisplayString()+"/"+destname);
   if((unlink(url.path().toUtf8())!=0)&&(errno!=ENOENT)) {
     Log(LOG_WARNING,"removal of \"%s\" failed: %s",
 	   url.toDisplayString().toUtf8().constData(),strerror(errno));
+    return MainObject::Transfer::Failure;
   }
+  return MainObject::Transfer::Success;
 }
 
 
-void MainObject::DeleteSftp(const QString &destname)
+void MainObject::DeleteSftp(Transfer *t)
 {
-  struct curl_slist *cmds=NULL;
-  QUrl url(d_dest_url->toDisplayString()+"/"+destname);
+  QUrl url(d_dest_url->toDisplayString()+"/"+t->destname);
 
-  //
-  // Set Up The Transaction
-  //
-  curl_easy_reset(d_curl_handle);
-  SetCurlAuthentication(d_curl_handle);
-  curl_easy_setopt(d_curl_handle,CURLOPT_URL,url.toEncoded().constData());
-  curl_easy_setopt(d_curl_handle,CURLOPT_HTTPAUTH,CURLAUTH_ANY);
-  curl_easy_setopt(d_curl_handle,CURLOPT_USERAGENT,
+  SetCurlAuthentication(t->handle);
+  curl_easy_setopt(t->handle,CURLOPT_URL,url.toEncoded().constData());
+  curl_easy_setopt(t->handle,CURLOPT_HTTPAUTH,CURLAUTH_ANY);
+  curl_easy_setopt(t->handle,CURLOPT_USERAGENT,
 		   d_user_agent.toUtf8().constData());
-  cmds=curl_slist_append(cmds,(QString("rm ")+url.path()).toUtf8());
-  curl_easy_setopt(d_curl_handle,CURLOPT_QUOTE,cmds);
+  t->quote=curl_slist_append(t->quote,(QString("rm ")+url.path()).toUtf8());
+  curl_easy_setopt(t->handle,CURLOPT_QUOTE,t->quote);
+}
 
-  //
-  // Execute It
-  //
-  CURLcode code=curl_easy_perform(d_curl_handle);
-  if((code!=CURLE_OK)&&(code!=CURLE_REMOTE_FILE_NOT_FOUND)) {
-    Log(LOG_WARNING,"removal of \"%s\" failed: [%d] %s",
-	   url.toDisplayString().toUtf8().constData(),code,d_curl_errorbuffer);
+
+void MainObject::DeleteAwsS3(const std::list<Transfer *> &batch)
+{
+#ifdef HAVE_AWS_S3
+  QStringList f0=d_dest_url->toDisplayString().split("/");
+  QString bucket=f0.last();
+  std::map<QString,uint64_t> serials;
+
+  Aws::Vector<Aws::S3::Model::ObjectIdentifier> objs;
+  for(std::list<Transfer *>::const_iterator it=batch.begin();
+      it!=batch.end();it++) {
+    objs.push_back(Aws::S3::Model::ObjectIdentifier().
+		   WithKey((*it)->destname.toUtf8().constData()));
+    serials[(*it)->destname]=(*it)->serial;
   }
+  Aws::S3::Model::DeleteObjectsRequest request;
+  request.SetBucket(bucket.toUtf8().constData());
+  request.SetDelete(Aws::S3::Model::Delete().WithObjects(objs).
+		    WithQuiet(true));
+  d_s3_client->DeleteObjectsAsync(request,[this,bucket,objs,serials]
+    (const Aws::S3::S3Client *,const Aws::S3::Model::DeleteObjectsRequest &,
+     const Aws::S3::Model::DeleteObjectsOutcome &out,
+     const std::shared_ptr<const Aws::Client::AsyncCallerContext> &) {
+      std::map<QString,MainObject::Transfer::Result> failed=
+	DeleteAwsS3Results(bucket,objs,out);
+      for(std::map<QString,uint64_t>::const_iterator it=serials.begin();
+	  it!=serials.end();it++) {
+	std::map<QString,MainObject::Transfer::Result>::const_iterator ft=
+	  failed.find(it->first);
+	if(ft==failed.end()) {
+	  PostS3Result(it->second,MainObject::Transfer::Success);
+	}
+	else {
+	  PostS3Result(it->second,ft->second);
+	}
+      }
+    });
+#else  // HAVE_AWS_S3
+  Log(LOG_WARNING,
+      "AWS S3 support has not been enabled, ignoring DELETE request");
+  for(std::list<Transfer *>::const_iterator it=batch.begin();
+      it!=batch.end();it++) {
+    CompleteTransfer(*it,MainObject::Transfer::Failure);
+  }
+#endif  // HAVE_AWS_S3
 }
 
 
-void MainObject::DeleteAwsS3(const QString &destname) const
+std::map<QString,MainObject::Transfer::Result>
+MainObject::DeleteAwsS3(const QStringList &keys) const
 {
+  std::map<QString,MainObject::Transfer::Result> failed;
+
 #ifdef HAVE_AWS_S3
   QStringList f0=d_dest_url->toDisplayString().split("/");
   QString bucket=f0.last();
-  QString key=destname;
-  
-  Aws::S3::S3ClientConfiguration config;
-  Aws::S3::S3Client client(config);
-  //  config.region="us-east-1";
-  Aws::S3::Model::DeleteObjectRequest request;
-  request.SetBucket(bucket.toUtf8().constData());
-  request.SetKey(key.toUtf8().constData());
-  Aws::S3::Model::DeleteObjectOutcome out=client.DeleteObject(request);
-  if(!out.IsSuccess()) {
-    auto err=out.GetError();
-    Log(LOG_WARNING,"S3 DeleteObject on \"%s\%s\" failed [%s]",
-	bucket.toUtf8().constData(),key.toUtf8().constData(),
-	err.GetMessage().c_str());
 
+  for(int i=0;i<keys.size();i+=GLASSCONV_S3_DELETE_BATCH_SIZE) {
+    Aws::Vector<Aws::S3::Model::ObjectIdentifier> objs;
+    for(int j=i;(j<keys.size())&&(j<(i+GLASSCONV_S3_DELETE_BATCH_SIZE));
+	j++) {
+      objs.push_back(Aws::S3::Model::ObjectIdentifier().
+		     WithKey(keys.at(j).toUtf8().constData()));
+    }
+    Aws::S3::Model::DeleteObjectsRequest request;
+    request.SetBucket(bucket.toUtf8().constData());
+    request.SetDelete(Aws::S3::Model::Delete().WithObjects(objs).
+		      WithQuiet(true));
+    std::map<QString,MainObject::Transfer::Result> results=
+      DeleteAwsS3Results(bucket,objs,d_s3_client->DeleteObjects(request));
+    failed.insert(results.begin(),results.end());
   }
-  //  Aws::ShutdownAPI(options);
 #else  // HAVE_AWS_S3
   Log(LOG_WARNING,
       "AWS S3 support has not been enabled, ignoring DELETE request");
+  for(int i=0;i<keys.size();i++) {
+    failed[keys.at(i)]=MainObject::Transfer::Failure;
+  }
 #endif  // HAVE_AWS_S3
+
+  return failed;
 }
 
 
+#ifdef HAVE_AWS_S3
+std::map<QString,MainObject::Transfer::Result>
+MainObject::DeleteAwsS3Results(const QString &bucket,
+		 const Aws::Vector<Aws::S3::Model::ObjectIdentifier> &objs,
+		 const Aws::S3::Model::DeleteObjectsOutcome &out) const
+{
+  std::map<QString,MainObject::Transfer::Result> failed;
+
+  if(!out.IsSuccess()) {
+    auto err=out.GetError();
+    Log(LOG_WARNING,"S3 DeleteObjects on \"%s\" failed [%s]",
+	bucket.toUtf8().constData(),err.GetMessage().c_str());
+    for(unsigned i=0;i<objs.size();i++) {
+      if(err.ShouldRetry()) {
+	failed[objs.at(i).GetKey().c_str()]=MainObject::Transfer::Retry;
+      }
+      else {
+	failed[objs.at(i).GetKey().c_str()]=MainObject::Transfer::Failure;
+      }
+    }
+    return failed;
+  }
+
+  //
+  // In quiet mode, only the failures are reported back
+  //
+  auto errs=out.GetResult().GetErrors();
+  for(unsigned i=0;i<errs.size();i++) {
+    QString code=errs.at(i).GetCode().c_str();
+    Log(LOG_WARNING,"S3 DeleteObjects on \"%s/%s\" failed [%s: %s]",
+	bucket.toUtf8().constData(),errs.at(i).GetKey().c_str(),
+	code.toUtf8().constData(),errs.at(i).GetMessage().c_str());
+    if((code=="InternalError")||(code=="SlowDown")||
+       (code=="ServiceUnavailable")) {
+      failed[errs.at(i).GetKey().c_str()]=MainObject::Transfer::Retry;
+    }
+    else {
+      failed[errs.at(i).GetKey().c_str()]=MainObject::Transfer::Failure;
+    }
+  }
+  return failed;
+}
+#endif  // HAVE_AWS_S3
+
+
 void MainObject::SetCurlAuthentication(CURL *handle) const
 {
   if(d_ssh_identity.isEmpty()) {
-    curl_easy_setopt(d_curl_handle,CURLOPT_USERPWD,
+    curl_easy_setopt(handle,CURLOPT_USERPWD,
 		     (d_username+":"+d_password).toUtf8().constData());
   }
   else {
-    curl_easy_setopt(d_curl_handle,
+    curl_easy_setopt(handle,
 		     CURLOPT_USERNAME,d_username.toUtf8().constData());
-    curl_easy_setopt(d_curl_handle,CURLOPT_SSH_PRIVATE_KEYFILE,
+    curl_easy_setopt(handle,CURLOPT_SSH_PRIVATE_KEYFILE,
 		     d_ssh_identity.toUtf8().constData());
-    curl_easy_setopt(d_curl_handle,CURLOPT_KEYPASSWD,
+    curl_easy_setopt(handle,CURLOPT_KEYPASSWD,
 		     d_password.toUtf8().constData());
   }
 }
@@ -529,24 +1423,27 @@ void MainObject::SetS3FileMetadata(Aws::S3::Model::PutObjectRequest &request,
 
   if(ext=="m3u8") {
     request.SetContentType("application/vnd.apple.mpegurl");
-    request.SetCacheControl(QString::asprintf("max-age=%d",HLS_SEGMENT_SIZE).
+    request.SetCacheControl(QString::asprintf("max-age=%d",d_target_duration).
 			    toUtf8().constData());
   }
   if(ext=="aac") {
     request.SetContentType("audio/aac");
     request.SetCacheControl("max-age=3600, stale-if-error=86400");
   }
+  if((ext=="m4s")||(ext=="mp4")) {
+    request.SetContentType("audio/mp4");
+    request.SetCacheControl("max-age=3600, stale-if-error=86400");
+  }
 }
 
 
 void MainObject::CleanS3Bucket(const QUrl &bucket_prefix) const
 {
   QStringList f0=ListS3Objects(bucket_prefix.path().split("/").last());
-  for(int i=0;i<f0.size();i++) {
-    DeleteAwsS3(f0.at(i));
-  }
   if(f0.size()>0) {
-    Log(LOG_INFO,"cleaned up %d stale files on publish point");
+    std::map<QString,MainObject::Transfer::Result> failed=DeleteAwsS3(f0);
+    Log(LOG_INFO,"cleaned up %d stale files on publish point",
+	f0.size()-(int)failed.size());
   }
 }
 
@@ -556,10 +1453,8 @@ QStringList MainObject::ListS3Objects(const QString &prefix) const
   QStringList f0=d_dest_url->toDisplayString().split("/");
   QString bucket=f0.last();
   QStringList objs;
-  
-  Aws::Vector<Aws::S3::Model::Object> objects;
-  Aws::S3::S3ClientConfiguration config;
-  Aws::S3::S3Client client(config);
+
+#ifdef HAVE_AWS_S3
   Aws::S3::Model::ListObjectsV2Request request;
   request.SetBucket(bucket.toUtf8().constData());
   request.SetPrefix(prefix.toUtf8().constData());
@@ -569,12 +1464,13 @@ QStringList MainObject::ListS3Objects(const QString &prefix) const
     if(!ctk.empty()) {
       request.SetContinuationToken(ctk);
     }
-    auto out=client.ListObjectsV2(request);
+    auto out=d_s3_client->ListObjectsV2(request);
     if(out.IsSuccess()) {
       auto contents=out.GetResult().GetContents();
-      for(int i=0;i<contents.size();i++) {
+      for(unsigned i=0;i<contents.size();i++) {
 	objs.push_back(contents.at(i).GetKey().c_str());
       }
+      ctk=out.GetResult().GetNextContinuationToken();
     }
     else {
       Log(LOG_WARNING,"failed to enumerate bucket \"%s\" [%s]",
@@ -582,15 +1478,54 @@ QStringList MainObject::ListS3Objects(const QString &prefix) const
       return objs;
     }
   } while(!ctk.empty());
+#endif  // HAVE_AWS_S3
 
   return objs;
 }
 
 
+#ifdef HAVE_AWS_S3
+Aws::S3::S3Client *MainObject::NewS3Client() const
+{
+  //
+  // One client, and hence one pool of kept-alive connections and worker
+  // threads, serves the whole session.  Each active transfer has at
+  // most one request in flight, so MaxTransfers connections is enough.
+  // The SDK's own retries are disabled; failed requests go through the
+  // retry queue like any other.
+  //
+  Aws::S3::S3ClientConfiguration config;
+  config.profileName=d_username.toUtf8().constData();
+  config.maxConnections=d_max_transfers;
+  config.executor=Aws::MakeShared<Aws::Utils::Threading::PooledThreadExecutor>
+    ("glassconv",d_max_transfers);
+  config.enableTcpKeepAlive=true;
+  config.connectTimeoutMs=GLASSCONV_S3_CONNECT_TIMEOUT;
+  config.requestTimeoutMs=1000*d_target_duration;
+  config.retryStrategy=
+    Aws::MakeShared<Aws::Client::DefaultRetryStrategy>("glassconv",0);
+
+  //
+  // For S3-compatible services (e.g. MinIO)
+  //
+  if(getenv("AWS_ENDPOINT_URL")!=NULL) {
+    config.endpointOverride=getenv("AWS_ENDPOINT_URL");
+    config.useVirtualAddressing=false;
+  }
+
+  return new Aws::S3::S3Client(config);
+}
+#endif  // HAVE_AWS_S3
+
+
 void MainObject::CleanExit(Config::ExitCode exit_code) const
 {
 #ifdef HAVE_AWS_S3
   if(d_dest_url->scheme().toLower()=="s3") {
+    delete d_s3_client;  // Must go before the API shuts down
+    if(d_s3_notify_fd>=0) {
+      close(d_s3_notify_fd);
+    }
     Aws::ShutdownAPI(d_aws_options);
   }
 #endif  // HAVE_AWS_S3
@@ -23,6 +23,11 @@
 
 #include <stdint.h>
 
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+
 #include <curl/curl.h>
 
 #ifdef HAVE_AWS_S3
@@ -32,12 +37,21 @@
 
 #include <QDir>
 #include <QObject>
+#include <QSocketNotifier>
 #include <QTimer>
 #include <QUrl>
 
 #include "config.h"
 
-#define GLASSCONV_USAGE "--source-dir=<dir> --dest-url=<url> [--debug]"
+#define GLASSCONV_USAGE \
+  "--source-dir=<dir> --dest-url=<url> [--conveyor-fd=<fd>] [--debug]"
+#define GLASSCONV_SCAN_INTERVAL 1000
+#define GLASSCONV_SWEEP_INTERVAL 10000
+#define GLASSCONV_INOTIFY_BUFFER_SIZE 4096
+#define GLASSCONV_RETRY_MIN_INTERVAL 500
+#define GLASSCONV_RETRY_MAX_INTERVAL 8000
+#define GLASSCONV_S3_CONNECT_TIMEOUT 3000
+#define GLASSCONV_S3_DELETE_BATCH_SIZE 1000
 
 class MainObject : public QObject
 {
@@ -47,17 +61,68 @@ class MainObject : public QObject
 
  private slots:
   void scanData();
+  void inotifyData(int fd);
+  void conveyorData(int fd);
+  void curlReadData(int fd);
+  void curlWriteData(int fd);
+  void curlTimeoutData();
+  void retryData();
+  void s3CompletionData(int fd);
 
  private:
+  struct Transfer {
+    enum Method {Put=0,Delete=1};
+    enum Result {Success=0,Retry=1,Failure=2};
+    Method method;
+    QString destname;
+    QString pathname;
+    int fd;
+    uint64_t serial;
+    unsigned attempts;
+    qint64 deadline;
+    qint64 retry_time;
+    CURL *handle;
+    FILE *file;
+    struct curl_slist *quote;
+    char errorbuffer[CURL_ERROR_SIZE];
+  };
+  void ProcessPendingFiles();
   void ProcessFile(const QString &filename);
-  void Put(const QString &destname,const QString &srcname);
-  void PutCurl(const QString &destname,const QString &srcname);
-  void PutAwsS3(const QString &destname,const QString &srcname);
-  void Delete(const QString &destname);
-  void DeleteHttp(const QString &destname);
-  void DeleteFile(const QString &destname);
-  void DeleteSftp(const QString &destname);
-  void DeleteAwsS3(const QString &destname) const;
+  void ProcessMessage(const struct NetConveyorMessage &msg,int fd);
+  qint64 TransferDeadline(qint64 timestamp) const;
+  void QueueTransfer(Transfer::Method meth,const QString &destname,
+		     const QString &pathname,int fd,qint64 deadline);
+  void StartTransfers();
+  bool StartNextTransfer(Transfer::Method meth);
+  bool StartS3Deletes(unsigned limit);
+  bool TransferIsBlocked(std::list<Transfer *>::iterator it) const;
+  bool TransferDependsOn(const Transfer *t,const Transfer *prev,
+			 bool playlist) const;
+  bool IsPlaylist(const QString &destname) const;
+  void StartTransfer(Transfer *t);
+  void CompleteTransfer(Transfer *t,Transfer::Result result);
+  void RetryTransfer(Transfer *t);
+  void AbandonTransfer(Transfer *t);
+  void FinishTransfer(Transfer *t);
+  void ReleaseTransfer(Transfer *t);
+  void ProcessCurlMessages();
+  Transfer::Result CurlResult(Transfer *t,CURLcode code) const;
+  void UpdateCurlSocket(curl_socket_t sock,int what);
+  bool PutCurl(Transfer *t);
+  bool PutAwsS3(Transfer *t);
+  void PostS3Result(uint64_t serial,Transfer::Result result);
+  void DeleteHttp(Transfer *t);
+  Transfer::Result DeleteFile(const QString &destname);
+  void DeleteSftp(Transfer *t);
+  void DeleteAwsS3(const std::list<Transfer *> &batch);
+  std::map<QString,Transfer::Result>
+    DeleteAwsS3(const QStringList &keys) const;
+#ifdef HAVE_AWS_S3
+  std::map<QString,Transfer::Result>
+    DeleteAwsS3Results(const QString &bucket,
+		const Aws::Vector<Aws::S3::Model::ObjectIdentifier> &objs,
+		const Aws::S3::Model::DeleteObjectsOutcome &out) const;
+#endif  // HAVE_AWS_S3
   void SetCurlAuthentication(CURL *handle) const;
   void UnlinkLocalFile(const QString &pathname) const;
   void Log(int prio,const char *fmt,...) const;
@@ -65,18 +130,49 @@ class MainObject : public QObject
 		       const QString &filename) const;
   void CleanS3Bucket(const QUrl &bucket_prefix) const;
   QStringList ListS3Objects(const QString &prefix) const;
+#ifdef HAVE_AWS_S3
+  Aws::S3::S3Client *NewS3Client() const;
+#endif  // HAVE_AWS_S3
   void CleanExit(Config::ExitCode exit_code) const;
+  friend int CurlSocketCallback(CURL *handle,curl_socket_t sock,int what,
+				void *priv,void *sock_priv);
+  friend int CurlTimerCallback(CURLM *multi,long timeout_msecs,void *priv);
   QDir *d_source_dir;
   QUrl *d_dest_url;
   QString d_username;
   QString d_password;
   QString d_ssh_identity;
   QTimer *d_scan_timer;
-  CURL *d_curl_handle;
-  char d_curl_errorbuffer[CURL_ERROR_SIZE];
+  int d_inotify_fd;
+  QSocketNotifier *d_inotify_notifier;
+  std::set<QString> d_pending_files;
+  int d_conveyor_fd;
+  QSocketNotifier *d_conveyor_notifier;
+  CURLM *d_curl_multi;
+  QTimer *d_curl_timer;
+  std::map<int,QSocketNotifier *> d_curl_read_notifiers;
+  std::map<int,QSocketNotifier *> d_curl_write_notifiers;
+  std::list<Transfer *> d_queued_transfers;
+  std::list<Transfer *> d_active_transfers;
+  std::set<QString> d_transfer_pathnames;
+  unsigned d_max_transfers;
+  bool d_stopping;
+  uint64_t d_transfer_serial;
+  QTimer *d_retry_timer;
+  unsigned d_retry_count;
+  unsigned d_abandon_count;
   QString d_user_agent;
+  int d_target_duration;
+  int d_window;
   QUrl d_preclean_url;
   Aws::SDKOptions d_aws_options;
+#ifdef HAVE_AWS_S3
+  Aws::S3::S3Client *d_s3_client;
+#endif  // HAVE_AWS_S3
+  int d_s3_notify_fd;
+  QSocketNotifier *d_s3_notifier;
+  std::mutex d_s3_mutex;
+  std::list<std::pair<uint64_t,Transfer::Result> > d_s3_results;
 };
 
 
@@ -39,12 +39,23 @@ HlsConnector::HlsConnector(Config *conf,QObject *parent)
   hls_config=conf;
   hls_sequence_head=0;
   hls_sequence_back=0;
+  hls_discontinuity_sequence=0;
+  hls_discontinuity_pending=false;
   hls_media_frames=0;
+  hls_segment_frames=0;
   hls_total_media_frames=0;
+  hls_origin_frames=0;
   hls_metadata_updated=false;
-
-  hls_conveyor=new NetConveyor(conf,this);
-  connect(hls_conveyor,SIGNAL(stopped()),this,SLOT(conveyorStoppedData()));
+  hls_parser=new FrameParser();
+  hls_muxer=NULL;
+  hls_init_published=false;
+  hls_master_published=false;
+  hls_origin=NULL;
+  hls_media_handle=NULL;
+  hls_part_frames=0;
+  hls_part_frames_max=0;
+  hls_part_index=0;
+  hls_conveyor=NULL;
 
   //
   // Create working directory
@@ -83,6 +94,10 @@ HlsConnector::~HlsConnector()
   }
   rmdir(hls_temp_dir->path().toUtf8());
   delete hls_temp_dir;
+  delete hls_parser;
+  if(hls_muxer!=NULL) {
+    delete hls_muxer;
+  }
 }
 
 
@@ -92,6 +107,54 @@ Connector::ServerType HlsConnector::serverType() const
 }
 
 
+void HlsConnector::setOrigin(HlsOrigin *origin)
+{
+  hls_origin=origin;
+}
+
+
+void HlsConnector::setOriginDateTime(const QDateTime &dt)
+{
+  hls_origin_datetime=dt;
+}
+
+
+void HlsConnector::setMasterPlaylist(const QString &mntpt)
+{
+  hls_master_mountpoint=mntpt;
+}
+
+
+void HlsConnector::addVariant(const QString &mntpt,unsigned bitrate,
+			      const QString &codecs)
+{
+  //
+  // BANDWIDTH is the peak rate, so allow for the container (ADTS
+  // headers, ID3 tags, 'moof' boxes) on top of the codec bitrate
+  //
+  hls_master_variants+=
+    QString().sprintf("#EXT-X-STREAM-INF:BANDWIDTH=%u,AVERAGE-BANDWIDTH=%u",
+		      10*bitrate*(100+HLS_BANDWIDTH_MARGIN),1000*bitrate);
+  if(!codecs.isEmpty()) {
+    hls_master_variants+=",CODECS=\""+codecs+"\"";
+  }
+  hls_master_variants+="\n"+playlistName(mntpt)+"\n";
+}
+
+
+QString HlsConnector::playlistName(const QString &mntpt)
+{
+  QStringList f0=mntpt.split("/",QString::SkipEmptyParts);
+  QString ret=f0[f0.size()-1];
+  QStringList f1=ret.split(".");
+
+  if((f1[f1.size()-1]!="m3u8")&&(f1[f1.size()-1]!="m3u")) {
+    ret+=".m3u8";
+  }
+  return ret;
+}
+
+
 void HlsConnector::sendMetadata(MetaEvent *e)
 {
   TagLib::ID3v2::Tag *tag=new TagLib::ID3v2::Tag();
@@ -124,22 +187,30 @@ void HlsConnector::sendMetadata(MetaEvent *e)
 
 void HlsConnector::startStopping()
 {
+  if(hls_conveyor==NULL) {
+    Connector::startStopping();
+    return;
+  }
   hls_conveyor->stop();
 }
 
 
 void HlsConnector::connectToHostConnector(const QUrl &url)
 {
+  //
+  // Renditions share their origin time, so that their segment names and
+  // timestamps match
+  //
+  if(!hls_origin_datetime.isValid()) {
+    hls_origin_datetime=QDateTime(QDate::currentDate(),QTime::currentTime());
+  }
+
   //
   // Calculate publish point info
   //
   QStringList f0=serverMountpoint().split("/",QString::SkipEmptyParts);
-  hls_put_basename=f0[f0.size()-1];
-  hls_put_basestamp=QString().sprintf("%ld",time(NULL));
-  QStringList f1=hls_put_basename.split(".");
-  if((f1[f1.size()-1]!="m3u8")&&(f1[f1.size()-1]!="m3u")) {
-    hls_put_basename+=".m3u8";
-  }
+  hls_put_basename=playlistName(serverMountpoint());
+  hls_put_basestamp=QString().sprintf("%u",hls_origin_datetime.toTime_t());
   hls_put_directory="";
   for(int i=0;i<f0.size()-1;i++) {
     hls_put_directory+="/";
@@ -152,27 +223,47 @@ void HlsConnector::connectToHostConnector(const QUrl &url)
   hls_playlist_filename=hls_temp_dir->path()+"/"+hls_put_basename;
 
   //
-  // Create initial media file
+  // A URL without a scheme means that we're only serving from the
+  // in-memory origin, so there's nothing to publish elsewhere
   //
-  hls_media_filename=GetMediaFilename(hls_sequence_back);
-  if((hls_media_handle=
-      fopen((hls_temp_dir->path()+"/"+hls_media_filename).toUtf8(),"w"))==
-     NULL) {
-    Log(LOG_WARNING,
-	QString().sprintf("unable to write media data to \"%s\" [%s]",
-			  (const char *)(hls_temp_dir->path()+"/"+
-					 hls_media_filename).toUtf8(),strerror(errno)));
+  if(!url.scheme().isEmpty()) {
+    hls_conveyor=new NetConveyor(hls_config,this);
+    connect(hls_conveyor,SIGNAL(stopped()),
+	    this,SLOT(conveyorStoppedData()));
+  }
+
+  //
+  // Find frame boundaries in the encoded stream
+  //
+  hls_parser->setFormat(FrameParser::format(contentType()));
+  hls_parser->setSamplerate(audioSamplerate());
+
+  //
+  // CMAF (fragmented MP4) packaging
+  //
+  if(hls_config->hlsFmp4()) {
+    hls_muxer=new Mp4Muxer(Mp4Muxer::format(contentType()),audioSamplerate(),
+			   audioChannels());
+  }
+
+  //
+  // Low-Latency HLS partial segments, served from the in-memory origin
+  //
+  hls_part_frames_max=0;
+  if((hls_origin!=NULL)&&(hls_config->hlsPartDuration()>0)) {
+    hls_part_frames_max=
+      (uint64_t)hls_config->hlsPartDuration()*audioSamplerate()/1000;
   }
 
   //
-  // Write ID3 tag(s)
+  // Create initial media file
   //
 #ifndef HLS_OMIT_ID3_TIMESTAMPS
-  uint8_t id3_header[HLS_ID3_HEADER_SIZE];
-  hls_total_media_frames=HLS_SEGMENT_SIZE*audioSamplerate();
-  GetStreamTimestamp(id3_header,hls_total_media_frames);
-  fwrite(id3_header,1,HLS_ID3_HEADER_SIZE,hls_media_handle);
+  hls_total_media_frames=
+    (uint64_t)hls_config->hlsSegmentDuration()*audioSamplerate();
 #endif  // HLS_OMIT_ID3_TIMESTAMPS
+  hls_origin_frames=hls_total_media_frames;
+  StartMediaFile();
 
   setConnected(true);
   emit unmuteRequested();
@@ -184,26 +275,123 @@ void HlsConnector::disconnectFromHostConnector()
 }
 
 
-int64_t HlsConnector::writeDataConnector(int frames,const unsigned char *data,
-					 int64_t len)
+int64_t HlsConnector::writePacketConnector(const EncodedPacket *pkt)
 {
-  int frame_start=-1;
-  QByteArray sdata((const char *)data,len);
+  //
+  // Capture audio went missing here, in every rendition at once, so
+  // start a fresh segment at the next frame.  As all of the renditions
+  // do the same, their segments stay lined up.
+  //
+  if(pkt->isDiscontinuity()) {
+    hls_discontinuity_pending=true;
+  }
+  if(hls_discontinuity_pending&&pkt->isFrameBoundary()) {
+    hls_discontinuity_pending=false;
+
+    //
+    // The codec's timestamps skip over the lost audio, so take the
+    // stream position from there rather than from our own count, which
+    // knows nothing of the gap.
+    //
+    hls_total_media_frames=hls_origin_frames+pkt->pts();
+    if(hls_media_frames>0) {
+      RotateMediaFile();
+    }
+    else {
+      hls_media_datetimes[hls_sequence_back]=GetMediaDateTime();
+      hls_playlist_lines[hls_sequence_back]=
+	GetDateTimeLine(hls_sequence_back);
+    }
+    if(hls_muxer!=NULL) {
+      hls_muxer->setDecodeTime((uint64_t)pkt->pts()*hls_muxer->timescale()/
+			       audioSamplerate());
+    }
+    hls_discontinuities.insert(hls_sequence_back);
+    hls_playlist_lines[hls_sequence_back]=
+      GetDiscontinuityLine(hls_sequence_back)+
+      hls_playlist_lines[hls_sequence_back];
+  }
+
+  if(hls_muxer!=NULL) {
+    return WriteFragmentedPacket(pkt);
+  }
+
+  const unsigned char *data=pkt->data();
+  uint64_t frames=pkt->duration();
+  unsigned count=hls_parser->parse(data,pkt->size());
+  int written=0;
+  int offset=0;
+
+  //
+  // Without a parsable bitstream, the best we can do is to treat the
+  // whole packet as a single frame
+  //
+  if(hls_parser->format()==FrameParser::Unknown) {
+    if(pkt->isFrameBoundary()) {
+      if((hls_media_frames+frames)>hls_segment_frames) {
+	RotateMediaFile();
+      }
+      else {
+	if(PartIsFull(frames)) {
+	  ClosePart(false);
+	}
+      }
+    }
+    hls_media_frames+=frames;
+    hls_part_frames+=frames;
+    hls_total_media_frames+=frames;
+    WriteMedia(data,pkt->size());
+    return pkt->size();
+  }
 
-  if((hls_media_frames+(uint64_t)frames)>(HLS_SEGMENT_SIZE*audioSamplerate())) {
-    RotateMediaFile();
+  //
+  // No frame starts in this packet, so it all belongs to the one
+  // already in progress.  Its duration was counted when it began.
+  //
+  if(count==0) {
+    WriteMedia(data,pkt->size());
+    return pkt->size();
   }
-  hls_media_frames+=(uint64_t)frames;
-  hls_total_media_frames+=(uint64_t)frames;
 
-  if(hls_metadata_updated) {
-    if((frame_start=sdata.indexOf(0xFF))>=0) {
-      sdata.insert(frame_start,hls_metadata_tag);
+  //
+  // Cut segments and parts and splice ID3 tags in exactly where frames
+  // begin
+  //
+  for(unsigned i=0;i<count;i++) {
+    frames=hls_parser->frameDuration(i);
+    if((offset=hls_parser->frameOffset(i))<0) {
+      hls_media_frames+=frames;  // Began in the previous packet
+      hls_part_frames+=frames;
+      hls_total_media_frames+=frames;
+      continue;
+    }
+    if((hls_media_frames>0)&&
+       ((hls_media_frames+frames)>hls_segment_frames)) {
+      WriteMedia(data+written,offset-written);
+      written=offset;
+      RotateMediaFile();
+    }
+    else {
+      if(PartIsFull(frames)) {
+	WriteMedia(data+written,offset-written);
+	written=offset;
+	ClosePart(false);
+      }
+    }
+    if(hls_metadata_updated) {
+      WriteMedia(data+written,offset-written);
+      written=offset;
+      WriteMedia((const unsigned char *)hls_metadata_tag.constData(),
+		 hls_metadata_tag.size());
       hls_metadata_updated=false;
     }
+    hls_media_frames+=frames;
+    hls_part_frames+=frames;
+    hls_total_media_frames+=frames;
   }
+  WriteMedia(data+written,pkt->size()-written);
 
-  return fwrite(sdata.constData(),sdata.size(),1,hls_media_handle);
+  return pkt->size();
 }
 
 
@@ -221,35 +409,137 @@ void HlsConnector::conveyorStoppedData()
 }
 
 
+void HlsConnector::StartMediaFile()
+{
+  hls_media_frames=0;
+  hls_part_frames=0;
+  hls_part_index=0;
+
+  //
+  // With fast start, the first segments are short, doubling in length
+  // until they reach the target duration
+  //
+  hls_segment_frames=
+    (uint64_t)hls_config->hlsSegmentDuration()*audioSamplerate();
+  if(hls_config->hlsFastStart()&&(hls_sequence_back<HLS_FAST_START_SEGMENTS)) {
+    uint64_t frames=
+      ((uint64_t)HLS_FAST_START_DURATION*audioSamplerate())<<hls_sequence_back;
+    if(frames<hls_segment_frames) {
+      hls_segment_frames=frames;
+    }
+  }
+  hls_media_filename=GetMediaFilename(hls_sequence_back);
+  if(hls_conveyor!=NULL) {
+    if(hls_conveyor->usesDescriptors()) {
+      int fd=hls_conveyor->
+	openBuffer(hls_temp_dir->path()+"/"+hls_media_filename);
+      if((fd>=0)&&((hls_media_handle=fdopen(fd,"w"))==NULL)) {
+	close(fd);
+      }
+    }
+    else {
+      if((hls_media_handle=
+	  fopen((hls_temp_dir->path()+"/"+hls_media_filename).toUtf8(),"w"))==
+	 NULL) {
+	Log(LOG_WARNING,
+	    QString().sprintf("unable to write media data to \"%s\" [%s]",
+			      (const char *)(hls_temp_dir->path()+"/"+
+			      hls_media_filename).toUtf8(),strerror(errno)));
+      }
+    }
+  }
+
+  hls_media_datetimes[hls_sequence_back]=GetMediaDateTime();
+  hls_playlist_lines[hls_sequence_back]=GetDateTimeLine(hls_sequence_back);
+  if(hls_part_frames_max>0) {
+    hls_origin->setPreloadHint(GetPlaylistUri(),
+			       GetPartUri(hls_sequence_back,hls_part_index));
+  }
+
+  //
+  // Write ID3 tag(s).  Fragmented MP4 segments carry their timing in
+  // the 'tfdt' box instead.
+  //
+#ifndef HLS_OMIT_ID3_TIMESTAMPS
+  if(hls_muxer==NULL) {
+    uint8_t id3_header[HLS_ID3_HEADER_SIZE];
+    GetStreamTimestamp(id3_header,hls_total_media_frames);
+    WriteMedia(id3_header,HLS_ID3_HEADER_SIZE);
+    if(hls_metadata_tag.size()>0) {
+      WriteMedia((const unsigned char *)hls_metadata_tag.constData(),
+		 hls_metadata_tag.size());
+      hls_metadata_updated=false;
+    }
+  }
+#endif  // HLS_OMIT_ID3_TIMESTAMPS
+}
+
+
 void HlsConnector::RotateMediaFile()
 {
   //
   // Update working files
   //
-  fclose(hls_media_handle);
-  hls_media_datetimes[hls_sequence_back]=
-    QDateTime(QDate::currentDate(),QTime::currentTime());
+  ClosePart(true);
+  if((hls_media_handle!=NULL)&&(!hls_conveyor->usesDescriptors())) {
+    fclose(hls_media_handle);
+    hls_media_handle=NULL;
+  }
   hls_media_durations[hls_sequence_back]=
     (double)hls_media_frames/(double)audioSamplerate();
-  if((hls_sequence_back-hls_sequence_head)>=HLS_MINIMUM_SEGMENT_QUAN) {
+  hls_playlist_lines[hls_sequence_back]+=GetExtinfLines(hls_sequence_back);
+  if((hls_sequence_back-hls_sequence_head)>=(int)hls_config->hlsWindow()) {
     // Schedule garbage collection
+    if(hls_discontinuities.erase(hls_sequence_head)>0) {
+      hls_discontinuity_sequence++;
+    }
     hls_media_killtimes[hls_sequence_head++]=hls_total_media_frames;
   }
-  WritePlaylistFile();
+
+  //
+  // In-memory origin (segment first, so the playlist never refers to
+  // something that isn't there yet)
+  //
+  if(hls_origin!=NULL) {
+    hls_origin->addSegment(GetMediaUri(hls_sequence_back),hls_media_data,
+			   GetMediaMimetype());
+    hls_media_data.clear();
+  }
 
   //
   // HTTP Uploads
   //
-  hls_conveyor->push(this,hls_temp_dir->path()+"/"+hls_media_filename,
-		     NetConveyorEvent::PutMethod);
-  unlink((hls_temp_dir->path()+"/"+hls_media_filename).toUtf8());
-  hls_conveyor->push(this,hls_playlist_filename,NetConveyorEvent::PutMethod);
-  unlink(hls_playlist_filename.toUtf8());
+  if(hls_conveyor!=NULL) {
+    if(hls_conveyor->usesDescriptors()) {
+      if(hls_media_handle!=NULL) {
+	fflush(hls_media_handle);
+	hls_conveyor->push(this,hls_temp_dir->path()+"/"+hls_media_filename,
+			   fileno(hls_media_handle));
+	fclose(hls_media_handle);
+	hls_media_handle=NULL;
+      }
+    }
+    else {
+      hls_conveyor->push(this,hls_temp_dir->path()+"/"+hls_media_filename,
+			 NetConveyorEvent::PutMethod);
+      unlink((hls_temp_dir->path()+"/"+hls_media_filename).toUtf8());
+    }
+  }
+
+  //
+  // Parts are only listed for the last few segments
+  //
+  int seqno=hls_sequence_back-HLS_PART_SEGMENT_QUAN;
+  if(hls_part_counts.find(seqno)!=hls_part_counts.end()) {
+    RemoveParts(seqno);
+    hls_playlist_lines[seqno]=GetDiscontinuityLine(seqno)+
+      GetDateTimeLine(seqno)+GetExtinfLines(seqno);
+  }
 
   //
   // Take out the trash
   //
-  if(!hls_config->serverNoDeletes()) {
+  if((hls_origin!=NULL)||!hls_config->serverNoDeletes()) {
     std::map<int,uint64_t>::iterator ci=hls_media_killtimes.begin();
     while(ci!=hls_media_killtimes.end()) {
       if(ci->second<hls_total_media_frames) {
@@ -271,9 +561,16 @@ void HlsConnector::RotateMediaFile()
 	    ++dj;
 	  }
 	}
-	hls_conveyor->
-	  push(this,hls_temp_dir->path()+"/"+GetMediaFilename(ci->first),
-	       NetConveyorEvent::DeleteMethod);
+	hls_playlist_lines.erase(ci->first);
+	if(hls_origin!=NULL) {
+	  RemoveParts(ci->first);
+	  hls_origin->removeResource(GetMediaUri(ci->first));
+	}
+	if((hls_conveyor!=NULL)&&(!hls_config->serverNoDeletes())) {
+	  hls_conveyor->
+	    push(this,hls_temp_dir->path()+"/"+GetMediaFilename(ci->first),
+		 NetConveyorEvent::DeleteMethod);
+	}
 	hls_media_killtimes.erase(ci++);
       }
       else {
@@ -286,60 +583,409 @@ void HlsConnector::RotateMediaFile()
   // Initialize for next segment
   //
   hls_sequence_back++;
-  hls_media_frames=0;
-  hls_media_filename=GetMediaFilename(hls_sequence_back);
-  if((hls_media_handle=
-      fopen((hls_temp_dir->path()+"/"+hls_media_filename).toUtf8(),"w"))==
-     NULL) {
-    Log(LOG_WARNING,
-	QString().sprintf("unable to write media data to \"%s\" [%s]",
-	   (const char *)(hls_temp_dir->path()+"/"+hls_media_filename).toUtf8(),
-			  strerror(errno)));
+  StartMediaFile();
+  PublishPlaylist(true);
+}
+
+
+void HlsConnector::ClosePart(bool last)
+{
+  FlushFragment();
+  if((hls_part_frames_max==0)||(hls_part_frames==0)) {
+    return;
   }
+  hls_origin->addSegment(GetPartUri(hls_sequence_back,hls_part_index),
+			 hls_part_data,GetMediaMimetype());
+  hls_playlist_lines[hls_sequence_back]+=
+    QString().sprintf("#EXT-X-PART:DURATION=%.5lf,URI=\"",
+		      (double)hls_part_frames/(double)audioSamplerate())+
+    GetPartFilename(hls_sequence_back,hls_part_index)+
+    "\",INDEPENDENT=YES\n";
+  hls_part_counts[hls_sequence_back]=++hls_part_index;
+  hls_part_frames=0;
+  hls_part_data.clear();
+
+  if(!last) {
+    //
+    // Each part gets its own timestamp, so that it can be played
+    // on its own
+    //
 #ifndef HLS_OMIT_ID3_TIMESTAMPS
-  uint8_t id3_header[HLS_ID3_HEADER_SIZE];
-  GetStreamTimestamp(id3_header,hls_total_media_frames);
-  fwrite(id3_header,1,HLS_ID3_HEADER_SIZE,hls_media_handle);
-  if(hls_metadata_tag.size()>0) {
-    fwrite(hls_metadata_tag.data(),1,hls_metadata_tag.size(),
-	   hls_media_handle);
-    hls_metadata_updated=false;
-  }
+    if(hls_muxer==NULL) {
+      uint8_t id3_header[HLS_ID3_HEADER_SIZE];
+      GetStreamTimestamp(id3_header,hls_total_media_frames);
+      hls_part_data.append((const char *)id3_header,HLS_ID3_HEADER_SIZE);
+    }
 #endif  // HLS_OMIT_ID3_TIMESTAMPS
+    hls_origin->setPreloadHint(GetPlaylistUri(),
+			       GetPartUri(hls_sequence_back,hls_part_index));
+    PublishPlaylist(false);
+  }
+}
+
+
+bool HlsConnector::PartIsFull(uint64_t frames) const
+{
+  return (hls_part_frames_max>0)&&(hls_part_frames>0)&&
+    ((hls_part_frames+frames)>hls_part_frames_max);
+}
+
+
+void HlsConnector::RemoveParts(int seqno)
+{
+  std::map<int,int>::iterator it=hls_part_counts.find(seqno);
+  if(it!=hls_part_counts.end()) {
+    for(int i=0;i<it->second;i++) {
+      hls_origin->removeResource(GetPartUri(seqno,i));
+    }
+    hls_part_counts.erase(it);
+  }
 }
 
 
-void HlsConnector::WritePlaylistFile()
+int64_t HlsConnector::WriteFragmentedPacket(const EncodedPacket *pkt)
 {
+  uint64_t frames;
+  unsigned count=hls_muxer->parse(pkt->data(),pkt->size());
+
+  //
+  // Fragment decode times carry on from the codec's packet timestamps.
+  // Those count frames at the stream samplerate, which is not the
+  // muxer's timescale for Opus (always 48 kHz).
+  //
+  if((count>0)&&(hls_muxer->decodeTime()==0)) {
+    hls_muxer->setDecodeTime((uint64_t)pkt->pts()*hls_muxer->timescale()/
+			     audioSamplerate());
+  }
+
+  //
+  // Segment and part bookkeeping is kept at the stream samplerate, so
+  // Opus durations need rescaling from 48 kHz
+  //
+  for(unsigned i=0;i<count;i++) {
+    frames=(uint64_t)hls_muxer->sampleDuration(i)*audioSamplerate()/
+      hls_muxer->timescale();
+    if((hls_media_frames>0)&&
+       ((hls_media_frames+frames)>hls_segment_frames)) {
+      RotateMediaFile();
+    }
+    else {
+      if(PartIsFull(frames)) {
+	ClosePart(false);
+      }
+    }
+    hls_muxer->addSample(i);
+    hls_media_frames+=frames;
+    hls_part_frames+=frames;
+    hls_total_media_frames+=frames;
+  }
+
+  return pkt->size();
+}
+
+
+void HlsConnector::FlushFragment()
+{
+  //
+  // Each part (or, without parts, each segment) is one 'moof'/'mdat' pair
+  //
+  if((hls_muxer!=NULL)&&(hls_muxer->fragmentSamples()>0)) {
+    QByteArray frag=hls_muxer->fragment();
+    WriteMedia((const unsigned char *)frag.constData(),frag.size());
+  }
+}
+
+
+void HlsConnector::WriteMedia(const unsigned char *data,int len)
+{
+  if(len<=0) {
+    return;
+  }
+  if(hls_origin!=NULL) {
+    hls_media_data.append((const char *)data,len);
+    if(hls_part_frames_max>0) {
+      hls_part_data.append((const char *)data,len);
+    }
+  }
+  if(hls_media_handle!=NULL) {
+    fwrite(data,1,len,hls_media_handle);
+  }
+}
+
+
+void HlsConnector::PublishInitSegment()
+{
+  QByteArray init=hls_muxer->initSegment();
+  QString filename=hls_temp_dir->path()+"/"+GetInitFilename();
   FILE *f=NULL;
 
-  if((f=fopen(hls_playlist_filename.toUtf8(),"w"))==NULL) {
+  if(hls_origin!=NULL) {
+    hls_origin->addSegment(GetInitUri(),init,GetMediaMimetype());
+  }
+  if(hls_conveyor!=NULL) {
+    if(hls_conveyor->usesDescriptors()) {
+      hls_conveyor->push(this,filename,init);
+    }
+    else {
+      if((f=fopen(filename.toUtf8(),"w"))==NULL) {
+	Log(LOG_WARNING,
+	    QString().sprintf("unable to write media data to \"%s\" [%s]",
+			      (const char *)filename.toUtf8(),
+			      strerror(errno)));
+	return;
+      }
+      fwrite(init.constData(),1,init.size(),f);
+      fclose(f);
+      hls_conveyor->push(this,filename,NetConveyorEvent::PutMethod);
+      unlink(filename.toUtf8());
+    }
+  }
+  hls_init_published=true;
+}
+
+
+void HlsConnector::PublishPlaylist(bool upload)
+{
+  //
+  // The init segment goes out ahead of the first playlist to refer to it
+  //
+  if((hls_muxer!=NULL)&&(!hls_init_published)&&hls_muxer->isReady()) {
+    PublishInitSegment();
+  }
+
+  QByteArray playlist=RenderPlaylist();
+
+  if(hls_origin!=NULL) {
+    hls_origin->setPlaylist(GetPlaylistUri(),playlist,
+			    hls_config->hlsSegmentDuration()/2,
+			    hls_sequence_back,hls_part_index-1);
+  }
+  if(upload&&(hls_conveyor!=NULL)) {
+    if(hls_conveyor->usesDescriptors()) {
+      hls_conveyor->push(this,hls_playlist_filename,playlist);
+    }
+    else {
+      WritePlaylistFile(hls_playlist_filename,playlist);
+      hls_conveyor->push(this,hls_playlist_filename,
+			 NetConveyorEvent::PutMethod);
+      unlink(hls_playlist_filename.toUtf8());
+    }
+  }
+  if(upload&&(!hls_master_published)&&(!hls_master_mountpoint.isEmpty())) {
+    PublishMasterPlaylist();
+  }
+}
+
+
+void HlsConnector::PublishMasterPlaylist()
+{
+  QByteArray playlist=RenderMasterPlaylist();
+  QString filename=
+    hls_temp_dir->path()+"/"+playlistName(hls_master_mountpoint);
+
+  //
+  // The renditions never change, so this need only go out once
+  //
+  if(hls_origin!=NULL) {
+    hls_origin->setPlaylist(hls_put_directory+"/"+
+			    playlistName(hls_master_mountpoint),playlist,
+			    hls_config->hlsSegmentDuration());
+  }
+  if(hls_conveyor!=NULL) {
+    if(hls_conveyor->usesDescriptors()) {
+      hls_conveyor->push(this,filename,playlist);
+    }
+    else {
+      WritePlaylistFile(filename,playlist);
+      hls_conveyor->push(this,filename,NetConveyorEvent::PutMethod);
+      unlink(filename.toUtf8());
+    }
+  }
+  hls_master_published=true;
+}
+
+
+QByteArray HlsConnector::RenderPlaylist()
+{
+  QString ret;
+
+  //
+  // Only the header is generated here; the lines for each segment
+  // are added as its parts and then the segment itself are completed.
+  //
+  ret+="#EXTM3U\n";
+  ret+=QString().sprintf("#EXT-X-TARGETDURATION:%u\n",
+			 hls_config->hlsSegmentDuration());
+  if(hls_part_frames_max>0) {
+    double part_target=(double)hls_part_frames_max/(double)audioSamplerate();
+    ret+=QString().sprintf("#EXT-X-VERSION:%d\n",HLS_LL_VERSION);
+    ret+=QString().sprintf("#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,"
+			   "PART-HOLD-BACK=%.5lf\n",
+			   HLS_PART_HOLD_BACK*part_target);
+    ret+=QString().sprintf("#EXT-X-PART-INF:PART-TARGET=%.5lf\n",part_target);
+  }
+  else {
+    if(hls_muxer!=NULL) {
+      ret+=QString().sprintf("#EXT-X-VERSION:%d\n",HLS_FMP4_VERSION);
+    }
+    else {
+      ret+=QString().sprintf("#EXT-X-VERSION:%d\n",HLS_VERSION);
+    }
+  }
+  ret+=QString().sprintf("#EXT-X-MEDIA-SEQUENCE:%d\n",hls_sequence_head);
+  if(hls_discontinuity_sequence>0) {
+    ret+=QString().sprintf("#EXT-X-DISCONTINUITY-SEQUENCE:%d\n",
+			   hls_discontinuity_sequence);
+  }
+  if(hls_muxer!=NULL) {
+    ret+="#EXT-X-MAP:URI=\""+GetInitFilename()+"\"\n";
+  }
+  for(int i=hls_sequence_head;i<hls_sequence_back;i++) {
+    ret+=hls_playlist_lines[i];
+  }
+  if(hls_part_frames_max>0) {
+    if(hls_part_index>0) {
+      ret+=hls_playlist_lines[hls_sequence_back];
+    }
+    ret+="#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\""+
+      GetPartFilename(hls_sequence_back,hls_part_index)+"\"\n";
+  }
+
+  return ret.toUtf8();
+}
+
+
+QByteArray HlsConnector::RenderMasterPlaylist()
+{
+  QString ret;
+
+  //
+  // Variant playlists live alongside this one, so relative URIs suffice
+  //
+  ret+="#EXTM3U\n";
+  ret+=QString().sprintf("#EXT-X-VERSION:%d\n",HLS_VERSION);
+  ret+="#EXT-X-INDEPENDENT-SEGMENTS\n";
+  ret+=hls_master_variants;
+
+  return ret.toUtf8();
+}
+
+
+void HlsConnector::WritePlaylistFile(const QString &filename,
+				     const QByteArray &data)
+{
+  FILE *f=NULL;
+
+  if((f=fopen(filename.toUtf8(),"w"))==NULL) {
     Log(LOG_ERR,
 	QString().sprintf("unable to write playlist data to \"%s\" [%s]",
-	   (const char *)(hls_temp_dir->path()+"/"+
-			  hls_playlist_filename).toUtf8(),strerror(errno)));
+			  (const char *)filename.toUtf8(),strerror(errno)));
     exit(256);
   }
-  fprintf(f,"#EXTM3U\n");
-  fprintf(f,"#EXT-X-TARGETDURATION:%d\n",HLS_SEGMENT_SIZE);
-  fprintf(f,"#EXT-X-VERSION:%d\n",HLS_VERSION);
-  fprintf(f,"#EXT-X-MEDIA-SEQUENCE:%d\n",hls_sequence_head);
-  for(int i=hls_sequence_head;i<=hls_sequence_back;i++) {
-    fprintf(f,"#EXT-X-PROGRAM-DATE-TIME:%s%s\n",(const char *)
-	    hls_media_datetimes[i].addSecs(streamTimestampOffset()).
-	    toString("yyyy-MM-ddThh:mm:ss.zzz").toUtf8(),
-	    (const char *)Connector::timezoneOffset().toUtf8());
-    fprintf(f,"#EXTINF:%7.5lf,\n%s\n",
-    	    hls_media_durations[i],(const char *)GetMediaFilename(i).toUtf8());
-  }
+  fwrite(data.constData(),1,data.size(),f);
   fclose(f);
 }
 
 
+QDateTime HlsConnector::GetMediaDateTime() const
+{
+  //
+  // When encoding faster than realtime, segment start times have to
+  // come from the sample count.  Live, that would drift with the sound
+  // card's clock, so use the wall clock instead.
+  //
+  if(!handoffBlocking()) {
+    return QDateTime(QDate::currentDate(),QTime::currentTime());
+  }
+  return hls_origin_datetime.
+    addMSecs(1000*(hls_total_media_frames-hls_origin_frames)/
+	     audioSamplerate());
+}
+
+
+QString HlsConnector::GetDateTimeLine(int seqno)
+{
+  return "#EXT-X-PROGRAM-DATE-TIME:"+hls_media_datetimes[seqno].
+    addSecs(streamTimestampOffset()).toString("yyyy-MM-ddThh:mm:ss.zzz")+
+    Connector::timezoneOffset()+"\n";
+}
+
+
+QString HlsConnector::GetDiscontinuityLine(int seqno)
+{
+  if(hls_discontinuities.find(seqno)==hls_discontinuities.end()) {
+    return QString();
+  }
+  return "#EXT-X-DISCONTINUITY\n";
+}
+
+
+QString HlsConnector::GetExtinfLines(int seqno)
+{
+  return QString().sprintf("#EXTINF:%7.5lf,\n",hls_media_durations[seqno])+
+    GetMediaFilename(seqno)+"\n";
+}
+
+
+QString HlsConnector::GetInitFilename()
+{
+  return hls_put_basename+"-"+hls_put_basestamp+"-init.mp4";
+}
+
+
+QString HlsConnector::GetInitUri()
+{
+  return hls_put_directory+"/"+GetInitFilename();
+}
+
+
+QString HlsConnector::GetMediaExtension() const
+{
+  if(hls_muxer!=NULL) {
+    return HLS_FMP4_EXTENSION;
+  }
+  return extension();
+}
+
+
+QString HlsConnector::GetMediaMimetype() const
+{
+  if(hls_muxer!=NULL) {
+    return HLS_FMP4_MIMETYPE;
+  }
+  return contentType();
+}
+
+
 QString HlsConnector::GetMediaFilename(int seqno)
 {
   return hls_put_basename+"-"+hls_put_basestamp+"-"+
-    QString().sprintf("%d.",seqno)+extension();
+    QString().sprintf("%d.",seqno)+GetMediaExtension();
+}
+
+
+QString HlsConnector::GetMediaUri(int seqno)
+{
+  return hls_put_directory+"/"+GetMediaFilename(seqno);
+}
+
+
+QString HlsConnector::GetPartFilename(int seqno,int partno)
+{
+  return hls_put_basename+"-"+hls_put_basestamp+"-"+
+    QString().sprintf("%d.%d.",seqno,partno)+GetMediaExtension();
+}
+
+
+QString HlsConnector::GetPartUri(int seqno,int partno)
+{
+  return hls_put_directory+"/"+GetPartFilename(seqno,partno);
+}
+
+
+QString HlsConnector::GetPlaylistUri()
+{
+  return hls_put_directory+"/"+hls_put_basename;
 }
 
 
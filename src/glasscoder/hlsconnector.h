@@ -21,10 +21,16 @@
 #ifndef HLSCONNECTOR_H
 #define HLSCONNECTOR_H
 
-#define HLS_SEGMENT_SIZE 10
 #define HLS_VERSION 3
-#define HLS_MINIMUM_SEGMENT_QUAN 4
 #define HLS_ID3_HEADER_SIZE 73
+#define HLS_LL_VERSION 6
+#define HLS_PART_HOLD_BACK 3
+#define HLS_PART_SEGMENT_QUAN 3
+#define HLS_FAST_START_SEGMENTS 8
+#define HLS_FMP4_VERSION 6
+#define HLS_FMP4_EXTENSION "m4s"
+#define HLS_FMP4_MIMETYPE "audio/mp4"
+#define HLS_BANDWIDTH_MARGIN 10
 
 //
 // The Pantos & May draft HLS spec calls for placing an ID3 PRIV timestamp
@@ -38,6 +44,7 @@
 #include <stdio.h>
 
 #include <map>
+#include <set>
 
 #include <id3v2tag.h>
 
@@ -50,6 +57,9 @@
 
 #include "config.h"
 #include "connector.h"
+#include "frameparser.h"
+#include "hlsorigin.h"
+#include "mp4muxer.h"
 #include "netconveyor.h"
 
 class HlsConnector : public Connector
@@ -59,6 +69,12 @@ class HlsConnector : public Connector
   HlsConnector(Config *conf,QObject *parent);
   ~HlsConnector();
   Connector::ServerType serverType() const;
+  void setOrigin(HlsOrigin *origin);
+  void setOriginDateTime(const QDateTime &dt);
+  void setMasterPlaylist(const QString &mntpt);
+  void addVariant(const QString &mntpt,unsigned bitrate,
+		  const QString &codecs);
+  static QString playlistName(const QString &mntpt);
 
  public slots:
   void sendMetadata(MetaEvent *e);
@@ -67,16 +83,40 @@ class HlsConnector : public Connector
   void startStopping();
   void connectToHostConnector(const QUrl &url);
   void disconnectFromHostConnector();
-  int64_t writeDataConnector(int frames,const unsigned char *data,int64_t len);
+  int64_t writePacketConnector(const EncodedPacket *pkt);
   void processConveyorEnvironment(QProcessEnvironment &env) const;
 
  private slots:
   void conveyorStoppedData();
 
  private:
+  void StartMediaFile();
   void RotateMediaFile();
-  void WritePlaylistFile();
+  void ClosePart(bool last);
+  bool PartIsFull(uint64_t frames) const;
+  void RemoveParts(int seqno);
+  int64_t WriteFragmentedPacket(const EncodedPacket *pkt);
+  void FlushFragment();
+  void WriteMedia(const unsigned char *data,int len);
+  void PublishInitSegment();
+  void PublishPlaylist(bool upload);
+  void PublishMasterPlaylist();
+  QByteArray RenderPlaylist();
+  QByteArray RenderMasterPlaylist();
+  void WritePlaylistFile(const QString &filename,const QByteArray &data);
+  QDateTime GetMediaDateTime() const;
+  QString GetDateTimeLine(int seqno);
+  QString GetDiscontinuityLine(int seqno);
+  QString GetExtinfLines(int seqno);
+  QString GetInitFilename();
+  QString GetInitUri();
+  QString GetMediaExtension() const;
+  QString GetMediaMimetype() const;
   QString GetMediaFilename(int seqno);
+  QString GetMediaUri(int seqno);
+  QString GetPartFilename(int seqno,int partno);
+  QString GetPartUri(int seqno,int partno);
+  QString GetPlaylistUri();
   void GetStreamTimestamp(uint8_t *bytes,uint64_t frames);
   void AddTextIdFrame(TagLib::ID3v2::Tag *tag,const QString &id,
 		      const QString &value) const;
@@ -89,10 +129,18 @@ class HlsConnector : public Connector
   std::map<int,double> hls_media_durations;
   std::map<int,QDateTime> hls_media_datetimes;
   std::map<int,uint64_t> hls_media_killtimes;
+  std::map<int,QString> hls_playlist_lines;
+  std::map<int,int> hls_part_counts;
+  std::set<int> hls_discontinuities;
+  int hls_discontinuity_sequence;
+  bool hls_discontinuity_pending;
   QString hls_media_filename;
   FILE *hls_media_handle;
   uint64_t hls_media_frames;
+  uint64_t hls_segment_frames;
   uint64_t hls_total_media_frames;
+  uint64_t hls_origin_frames;
+  QDateTime hls_origin_datetime;
   QString hls_put_directory;
   QString hls_put_basename;
   QString hls_put_basestamp;
@@ -100,6 +148,18 @@ class HlsConnector : public Connector
   QDateTime hls_start_datetime;
   QByteArray hls_metadata_tag;
   bool hls_metadata_updated;
+  FrameParser *hls_parser;
+  Mp4Muxer *hls_muxer;
+  bool hls_init_published;
+  QString hls_master_mountpoint;
+  QString hls_master_variants;
+  bool hls_master_published;
+  HlsOrigin *hls_origin;
+  QByteArray hls_media_data;
+  QByteArray hls_part_data;
+  uint64_t hls_part_frames;
+  uint64_t hls_part_frames_max;
+  int hls_part_index;
   Config *hls_config;
 };
 
@@ -0,0 +1,334 @@
+// hlsorigin.cpp
+//
+// HTTP origin server for in-memory HLS playlists and segments
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <time.h>
+
+#include <QDateTime>
+#include <QStringList>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include "hlsorigin.h"
+
+HlsOrigin::HlsOrigin(QObject *parent)
+  : HttpServer(parent)
+{
+  origin_resource_bytes=0;
+  origin_generation=0;
+  origin_blocking_timeout=HLSORIGIN_BLOCKING_TIMEOUT;
+
+  origin_blocking_timer=new QTimer(this);
+  connect(origin_blocking_timer,SIGNAL(timeout()),
+	  this,SLOT(blockingScanData()));
+
+  //
+  // So that ETags handed out by a previous instance never match
+  //
+  origin_etag_prefix=QString().sprintf("%lx",time(NULL));
+}
+
+
+HlsOrigin::~HlsOrigin()
+{
+}
+
+
+unsigned HlsOrigin::resources() const
+{
+  return origin_resources.size();
+}
+
+
+int64_t HlsOrigin::resourceBytes() const
+{
+  return origin_resource_bytes;
+}
+
+
+unsigned HlsOrigin::blockedRequests() const
+{
+  return origin_requests.size();
+}
+
+
+unsigned HlsOrigin::blockingTimeout() const
+{
+  return origin_blocking_timeout;
+}
+
+
+void HlsOrigin::setBlockingTimeout(unsigned msecs)
+{
+  origin_blocking_timeout=msecs;
+}
+
+
+void HlsOrigin::setPlaylist(const QString &uri,const QByteArray &data,
+			    unsigned max_age,int msn,int part)
+{
+  AddResource(uri,data,HLSORIGIN_PLAYLIST_MIMETYPE,
+	      QString().sprintf("max-age=%u",max_age),msn,part);
+}
+
+
+void HlsOrigin::setPreloadHint(const QString &playlist_uri,
+			       const QString &hint_uri)
+{
+  if(hint_uri.isEmpty()) {
+    origin_preload_hints.erase(playlist_uri);
+  }
+  else {
+    origin_preload_hints[playlist_uri]=hint_uri;
+  }
+}
+
+
+void HlsOrigin::addSegment(const QString &uri,const QByteArray &data,
+			   const QString &mimetype)
+{
+  AddResource(uri,data,mimetype,
+	      QString().sprintf("max-age=%u, immutable",
+				HLSORIGIN_SEGMENT_MAX_AGE));
+}
+
+
+void HlsOrigin::removeResource(const QString &uri)
+{
+  std::map<QString,Resource>::iterator it=origin_resources.find(uri);
+  if(it!=origin_resources.end()) {
+    origin_resource_bytes-=it->second.data.size();
+    origin_resources.erase(it);
+  }
+}
+
+
+void HlsOrigin::getRequestReceived(HttpConnection *conn)
+{
+  SendResource(conn,true);
+}
+
+
+void HlsOrigin::headRequestReceived(HttpConnection *conn)
+{
+  SendResource(conn,false);
+}
+
+
+void HlsOrigin::blockingScanData()
+{
+  int64_t now=QDateTime::currentMSecsSinceEpoch();
+
+  std::list<Request>::iterator it=origin_requests.begin();
+  while(it!=origin_requests.end()) {
+    if(it->conn.isNull()) {
+      origin_requests.erase(it++);
+      continue;
+    }
+    if(it->deadline<=now) {
+      if(it->msn<0) {
+	it->conn->sendError(404,"404 Not found");
+      }
+      else {
+	it->conn->sendError(503,"503 Service Unavailable");
+      }
+      origin_requests.erase(it++);
+      continue;
+    }
+    ++it;
+  }
+  if(origin_requests.size()==0) {
+    origin_blocking_timer->stop();
+  }
+}
+
+
+void HlsOrigin::AddResource(const QString &uri,const QByteArray &data,
+			    const QString &mimetype,
+			    const QString &cache_control,int msn,int part)
+{
+  removeResource(uri);
+
+  Resource &res=origin_resources[uri];
+  res.data=data;
+  res.mimetype=mimetype;
+  res.etag=QString().sprintf("\"%s-%lu\"",
+			     (const char *)origin_etag_prefix.toUtf8(),
+			     (unsigned long)origin_generation++);
+  res.cache_control=cache_control;
+  res.msn=msn;
+  res.part=part;
+  origin_resource_bytes+=data.size();
+
+  ServiceRequests(uri);
+}
+
+
+void HlsOrigin::SendResource(HttpConnection *conn,bool send_body)
+{
+  QUrl url(conn->uri());
+  QUrlQuery query(url);
+  QString uri=url.path();
+  int msn=-1;
+  int part=-1;
+  bool ok=false;
+
+  //
+  // Blocking playlist reload parameters
+  //
+  if(query.hasQueryItem("_HLS_msn")) {
+    msn=query.queryItemValue("_HLS_msn").toInt(&ok);
+    if((!ok)||(msn<0)) {
+      conn->sendError(400,"400 Bad Request");
+      return;
+    }
+  }
+  if(query.hasQueryItem("_HLS_part")) {
+    part=query.queryItemValue("_HLS_part").toInt(&ok);
+    if((!ok)||(part<0)||(msn<0)) {
+      conn->sendError(400,"400 Bad Request");
+      return;
+    }
+  }
+
+  std::map<QString,Resource>::const_iterator it=origin_resources.find(uri);
+  if(it==origin_resources.end()) {
+    if((msn>=0)||IsPreloadHint(uri)) {
+      HoldRequest(conn,uri,msn,part,send_body);
+      return;
+    }
+    conn->sendError(404,"404 Not found",
+		    QStringList()<<"Cache-Control",QStringList()<<"no-cache");
+    return;
+  }
+  if((msn>=0)&&(!Satisfies(it->second,msn,part))) {
+    if(msn>(it->second.msn+2)) {  // Too far in the future
+      conn->sendError(400,"400 Bad Request");
+      return;
+    }
+    HoldRequest(conn,uri,msn,part,send_body);
+    return;
+  }
+  SendResponse(conn,it->second,send_body);
+}
+
+
+void HlsOrigin::SendResponse(HttpConnection *conn,const Resource &res,
+			     bool send_body)
+{
+  bool not_modified=EtagMatches(conn,res.etag);
+
+  if(not_modified) {
+    conn->sendResponseHeader(304);
+  }
+  else {
+    conn->sendResponseHeader(200,res.mimetype);
+    conn->sendHeader("Content-Length",
+		     QString().sprintf("%d",res.data.size()));
+  }
+  conn->sendHeader("ETag",res.etag);
+  conn->sendHeader("Cache-Control",res.cache_control);
+  conn->sendHeader("Access-Control-Allow-Origin","*");
+  conn->sendHeader();
+  if(send_body&&(!not_modified)) {
+    conn->socket()->write(res.data);
+  }
+}
+
+
+void HlsOrigin::HoldRequest(HttpConnection *conn,const QString &uri,
+			    int msn,int part,bool send_body)
+{
+  Request req;
+
+  req.conn=conn;
+  req.uri=uri;
+  req.msn=msn;
+  req.part=part;
+  req.send_body=send_body;
+  req.deadline=QDateTime::currentMSecsSinceEpoch()+origin_blocking_timeout;
+  origin_requests.push_back(req);
+  if(!origin_blocking_timer->isActive()) {
+    origin_blocking_timer->start(HLSORIGIN_BLOCKING_SCAN_INTERVAL);
+  }
+}
+
+
+void HlsOrigin::ServiceRequests(const QString &uri)
+{
+  std::map<QString,Resource>::const_iterator ri=origin_resources.find(uri);
+
+  std::list<Request>::iterator it=origin_requests.begin();
+  while(it!=origin_requests.end()) {
+    if(it->conn.isNull()) {
+      origin_requests.erase(it++);
+      continue;
+    }
+    if((it->uri==uri)&&
+       ((it->msn<0)||Satisfies(ri->second,it->msn,it->part))) {
+      SendResponse(it->conn,ri->second,it->send_body);
+      origin_requests.erase(it++);
+      continue;
+    }
+    ++it;
+  }
+}
+
+
+bool HlsOrigin::IsPreloadHint(const QString &uri) const
+{
+  for(std::map<QString,QString>::const_iterator it=
+	origin_preload_hints.begin();it!=origin_preload_hints.end();it++) {
+    if(it->second==uri) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool HlsOrigin::Satisfies(const Resource &res,int msn,int part)
+{
+  //
+  // A resource's msn is that of the segment still being built, and
+  // its part the last part of it that is complete (if any)
+  //
+  if(part<0) {
+    return res.msn>msn;
+  }
+  return (res.msn>msn)||((res.msn==msn)&&(res.part>=part));
+}
+
+
+bool HlsOrigin::EtagMatches(HttpConnection *conn,const QString &etag) const
+{
+  QStringList f0=
+    conn->headerValue("if-none-match").split(",",QString::SkipEmptyParts);
+
+  for(int i=0;i<f0.size();i++) {
+    QString tag=f0.at(i).trimmed();
+    if(tag.startsWith("W/")) {
+      tag=tag.mid(2);
+    }
+    if((tag=="*")||(tag==etag)) {
+      return true;
+    }
+  }
+  return false;
+}
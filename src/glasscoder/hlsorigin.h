@@ -0,0 +1,114 @@
+// hlsorigin.h
+//
+// HTTP origin server for in-memory HLS playlists and segments
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef HLSORIGIN_H
+#define HLSORIGIN_H
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+
+#include <QByteArray>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+
+#include "httpserver.h"
+
+#define HLSORIGIN_PLAYLIST_MIMETYPE "application/vnd.apple.mpegurl"
+#define HLSORIGIN_SEGMENT_MAX_AGE 86400
+#define HLSORIGIN_BLOCKING_TIMEOUT 30000
+#define HLSORIGIN_BLOCKING_SCAN_INTERVAL 100
+
+//
+// Segment URIs are never reused, so segments can be cached indefinitely.
+// Playlists change with every segment, and so are given a max-age of
+// half the target duration.
+//
+// Low-Latency HLS blocking requests -- playlist reloads carrying
+// _HLS_msn/_HLS_part and fetches of a preload-hinted part -- are held
+// until the resource catches up, or the blocking timeout expires.
+//
+class HlsOrigin : public HttpServer
+{
+  Q_OBJECT;
+ public:
+  HlsOrigin(QObject *parent=0);
+  ~HlsOrigin();
+  unsigned resources() const;
+  int64_t resourceBytes() const;
+  unsigned blockedRequests() const;
+  unsigned blockingTimeout() const;
+  void setBlockingTimeout(unsigned msecs);
+  void setPlaylist(const QString &uri,const QByteArray &data,
+		   unsigned max_age,int msn=-1,int part=-1);
+  void setPreloadHint(const QString &playlist_uri,const QString &hint_uri);
+  void addSegment(const QString &uri,const QByteArray &data,
+		  const QString &mimetype);
+  void removeResource(const QString &uri);
+
+ protected:
+  void getRequestReceived(HttpConnection *conn);
+  void headRequestReceived(HttpConnection *conn);
+
+ private slots:
+  void blockingScanData();
+
+ private:
+  struct Resource {
+    QByteArray data;
+    QString mimetype;
+    QString etag;
+    QString cache_control;
+    int msn;
+    int part;
+  };
+  struct Request {
+    QPointer<HttpConnection> conn;
+    QString uri;
+    int msn;
+    int part;
+    bool send_body;
+    int64_t deadline;
+  };
+  void AddResource(const QString &uri,const QByteArray &data,
+		   const QString &mimetype,const QString &cache_control,
+		   int msn=-1,int part=-1);
+  void SendResource(HttpConnection *conn,bool send_body);
+  void SendResponse(HttpConnection *conn,const Resource &res,bool send_body);
+  void HoldRequest(HttpConnection *conn,const QString &uri,int msn,int part,
+		   bool send_body);
+  void ServiceRequests(const QString &uri);
+  bool IsPreloadHint(const QString &uri) const;
+  static bool Satisfies(const Resource &res,int msn,int part);
+  bool EtagMatches(HttpConnection *conn,const QString &etag) const;
+  std::map<QString,Resource> origin_resources;
+  std::map<QString,QString> origin_preload_hints;
+  std::list<Request> origin_requests;
+  QTimer *origin_blocking_timer;
+  unsigned origin_blocking_timeout;
+  int64_t origin_resource_bytes;
+  uint64_t origin_generation;
+  QString origin_etag_prefix;
+};
+
+
+#endif  // HLSORIGIN_H
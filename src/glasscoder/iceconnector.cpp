@@ -115,13 +115,12 @@ void IceConnector::disconnectFromHostConnector()
 }
 
 
-int64_t IceConnector::writeDataConnector(int frames,const unsigned char *data,
-					 int64_t len)
+int64_t IceConnector::writePacketConnector(const EncodedPacket *pkt)
 {
   if(ice_socket->state()==QAbstractSocket::ConnectedState) {
-    return ice_socket->write((const char *)data,len);
+    return ice_socket->write((const char *)pkt->data(),pkt->size());
   }
-  return len;
+  return pkt->size();
 }
 
 
@@ -66,12 +66,10 @@ void IceOutConnector::disconnectFromHostConnector()
 }
 
 
-int64_t IceOutConnector::writeDataConnector(int frames,
-					    const unsigned char *data,
-					    int64_t len)
+int64_t IceOutConnector::writePacketConnector(const EncodedPacket *pkt)
 {
-  fwrite(data,len,1,stdout);
-  return len;
+  fwrite(pkt->data(),pkt->size(),1,stdout);
+  return pkt->size();
 }
 
 
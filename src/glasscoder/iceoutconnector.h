@@ -35,7 +35,7 @@ class IceOutConnector : public Connector
   void startStopping();
   void connectToHostConnector(const QUrl &url);
   void disconnectFromHostConnector();
-  int64_t writeDataConnector(int frames,const unsigned char *data,int64_t len);
+  int64_t writePacketConnector(const EncodedPacket *pkt);
 
  private:
   void SendHeader(const QString &hdr="") const;
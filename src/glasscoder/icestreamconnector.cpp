@@ -20,7 +20,10 @@
 
 #include <errno.h>
 #include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <QCoreApplication>
@@ -40,14 +43,22 @@ IceStream::IceStream(QTcpSocket *sock,IceStream::Type type)
   ice_type=IceStream::New;
   ice_metadata_enabled=false;
   ice_metadata_bytes=0;
+  ice_queued_bytes=0;
   ice_timeout_timer=new QTimer();
   ice_timeout_timer->setSingleShot(true);
   ice_timeout_timer->start(ICESTREAM_CONNECTION_TIMEOUT);
+  ice_write_notifier=
+    new QSocketNotifier(sock->socketDescriptor(),QSocketNotifier::Write);
+  ice_write_notifier->setEnabled(false);
 }
 
 
 IceStream::~IceStream()
 {
+  for(unsigned i=0;i<ice_queue.size();i++) {
+    ice_queue.at(i).buf->unref();
+  }
+  delete ice_write_notifier;
   delete ice_socket;
   delete ice_timeout_timer;
 }
@@ -65,6 +76,12 @@ QTimer *IceStream::timeoutTimer() const
 }
 
 
+QSocketNotifier *IceStream::writeNotifier() const
+{
+  return ice_write_notifier;
+}
+
+
 IceStream::Type IceStream::type() const
 {
   return ice_type;
@@ -138,12 +155,121 @@ int IceStream::addMetadataBytes(int bytes)
 }
 
 
+void IceStream::queueData(PacketBuffer *buf,int offset,int len)
+{
+  Slice slice;
+
+  if(len<=0) {
+    return;
+  }
+  buf->ref();
+  slice.buf=buf;
+  slice.offset=offset;
+  slice.len=len;
+  ice_queue.push_back(slice);
+  ice_queued_bytes+=len;
+}
+
+
+int64_t IceStream::queuedBytes() const
+{
+  return ice_queued_bytes;
+}
+
+
+bool IceStream::flushQueue()
+{
+  //
+  // Whatever doesn't go now is sent as soon as the socket can take it:
+  // from writeNotifier() when we are writing the socket directly, or
+  // from bytesWritten() while Qt still has its own buffer to empty
+  // (arming both at once would give Qt two write notifiers on the same
+  // descriptor).  Returns false if the connection has failed.
+  //
+  bool ret=SendQueue();
+
+  ice_write_notifier->setEnabled(ret&&(ice_queue.size()>0)&&
+				 (ice_socket->bytesToWrite()==0));
+
+  return ret;
+}
+
+
+bool IceStream::SendQueue()
+{
+  //
+  // Send queued slices straight from the shared buffers with one
+  // gathered write, rather than copying them into the socket's own
+  // write buffer.
+  //
+  struct iovec iov[ICESTREAM_MAX_IOVECS];
+  struct msghdr msg;
+  unsigned count=0;
+  ssize_t total=0;
+  ssize_t n=0;
+
+  if(ice_queue.size()==0) {
+    return true;
+  }
+
+  //
+  // Anything Qt is still holding (headers, prologue) has to go first
+  //
+  ice_socket->flush();
+  if(ice_socket->bytesToWrite()>0) {
+    return true;
+  }
+
+  while(ice_queue.size()>0) {
+    count=0;
+    total=0;
+    for(std::deque<Slice>::const_iterator it=ice_queue.begin();
+	(it!=ice_queue.end())&&(count<ICESTREAM_MAX_IOVECS);it++) {
+      iov[count].iov_base=(void *)(it->buf->data()+it->offset);
+      iov[count].iov_len=it->len;
+      total+=it->len;
+      count++;
+    }
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov=iov;
+    msg.msg_iovlen=count;
+    if((n=sendmsg(ice_socket->socketDescriptor(),&msg,
+		  MSG_DONTWAIT|MSG_NOSIGNAL))<0) {
+      return (errno==EAGAIN)||(errno==EWOULDBLOCK)||(errno==EINTR);
+    }
+    ice_queued_bytes-=n;
+    for(ssize_t sent=n;sent>0;) {
+      Slice &slice=ice_queue.front();
+      if(sent>=slice.len) {
+	sent-=slice.len;
+	slice.buf->unref();
+	ice_queue.pop_front();
+      }
+      else {
+	slice.offset+=sent;
+	slice.len-=sent;
+	sent=0;
+      }
+    }
+    if(n<total) {
+      return true;  // Socket buffer is full, try again next time
+    }
+  }
+
+  return true;
+}
+
+
 
 
 IceStreamConnector::IceStreamConnector(QObject *parent)
   : Connector(parent)
 {
-  iceserv_metadata=QString().sprintf("%cStreamTitle=''; ",1).toUtf8();
+  QByteArray meta=QString().sprintf("%cStreamTitle=''; ",1).toUtf8();
+
+  iceserv_pool=new PacketPool();
+  iceserv_metadata=
+    iceserv_pool->copy((const unsigned char *)meta.constData(),meta.size());
   iceserv_socket_server=NULL;
 
   iceserv_server=new QTcpServer(this);
@@ -158,6 +284,10 @@ IceStreamConnector::IceStreamConnector(QObject *parent)
   connect(iceserv_timeout_mapper,SIGNAL(mapped(int)),
 	  this,SLOT(timeoutData(int)));
 
+  iceserv_write_mapper=new QSignalMapper(this);
+  connect(iceserv_write_mapper,SIGNAL(mapped(int)),
+	  this,SLOT(writeReadyData(int)));
+
   iceserv_garbage_timer=new QTimer(this);
   iceserv_garbage_timer->setSingleShot(true);
   connect(iceserv_garbage_timer,SIGNAL(timeout()),this,SLOT(garbageData()));
@@ -171,12 +301,15 @@ IceStreamConnector::~IceStreamConnector()
   }
   delete iceserv_garbage_timer;
   delete iceserv_readyread_mapper;
+  delete iceserv_write_mapper;
   for(unsigned i=0;i<iceserv_streams.size();i++) {
     if(iceserv_streams.at(i)!=NULL) {
       delete iceserv_streams.at(i);
     }
   }
   delete iceserv_server;
+  iceserv_metadata->unref();
+  delete iceserv_pool;
 }
 
 
@@ -211,6 +344,7 @@ void IceStreamConnector::newConnectionData()
   int id=GetFreeStreamId();
   iceserv_streams[id]=new IceStream(sock);
   connect(sock,SIGNAL(disconnected()),this,SLOT(disconnectedData()));
+  MapWrites(iceserv_streams.at(id),id);
   iceserv_readyread_mapper->setMapping(sock,id);
   connect(sock,SIGNAL(readyRead()),iceserv_readyread_mapper,SLOT(map()));
 
@@ -233,6 +367,7 @@ void IceStreamConnector::newPipeConnectionData()
   int id=GetFreeStreamId();
   iceserv_streams[id]=new IceStream(sock,IceStream::Player);
   connect(sock,SIGNAL(disconnected()),this,SLOT(disconnectedData()));
+  MapWrites(iceserv_streams.at(id),id);
   StartStream(iceserv_streams[id]);
 }
 
@@ -261,6 +396,17 @@ void IceStreamConnector::readyReadData(int id)
 }
 
 
+void IceStreamConnector::writeReadyData(int id)
+{
+  IceStream *strm=iceserv_streams.at(id);
+
+  if((strm!=NULL)&&(!strm->flushQueue())) {
+    strm->socket()->abort();
+    iceserv_garbage_timer->start(1);
+  }
+}
+
+
 void IceStreamConnector::timeoutData(int id)
 {
   iceserv_streams.at(id)->socket()->disconnectFromHost();
@@ -355,26 +501,42 @@ void IceStreamConnector::disconnectFromHostConnector()
 }
 
 
-int64_t IceStreamConnector::writeDataConnector(int frames,
-					       const unsigned char *data,
-					       int64_t len)
+int64_t IceStreamConnector::writePacketConnector(const EncodedPacket *pkt)
 {
   IceStream *strm=NULL;
   int offset=0;
+  int64_t len=pkt->size();
+  PacketBuffer *buf=NULL;
+
+  if(len==0) {
+    return 0;
+  }
 
+  //
+  // One copy of the packet, shared by every listener
+  //
+  buf=iceserv_pool->copy(pkt->data(),len);
   for(unsigned i=0;i<iceserv_streams.size();i++) {
     strm=iceserv_streams.at(i);
-    if((strm!=NULL)&&(strm->isNegotiated())) {
+    if((strm!=NULL)&&(strm->isNegotiated())&&
+       (strm->socket()->state()==QAbstractSocket::ConnectedState)) {
       if((offset=strm->addMetadataBytes(len))<0) {
-	strm->socket()->write((const char *)data,len);
+	strm->queueData(buf,0,len);
       }
       else {
-	strm->socket()->write((const char *)data,offset);
-	strm->socket()->write(iceserv_metadata);
-	strm->socket()->write((const char *)data+offset,len-offset);
+	strm->queueData(buf,0,offset);
+	strm->queueData(iceserv_metadata,0,iceserv_metadata->size());
+	strm->queueData(buf,offset,len-offset);
+      }
+      if((!strm->flushQueue())||
+	 (strm->queuedBytes()>ICESTREAM_MAX_QUEUED)) {
+	strm->socket()->abort();
+	iceserv_garbage_timer->start(1);
       }
     }
   }
+  buf->unref();
+
   return len;
 }
 
@@ -385,11 +547,18 @@ void IceStreamConnector::SetMetadata(const QString &title)
   // This has to be the lamest metadata protocol in existence.
   // Codecs have ancillary channels for this sort of thing!  ** BAD LLAMA!! **
   //
-  iceserv_metadata=("StreamTitle='"+title+"';").toUtf8();
-  while((iceserv_metadata.length()%16)!=0) {
-    iceserv_metadata.append((char)0);
+  QByteArray meta=("StreamTitle='"+title+"';").toUtf8();
+  while((meta.length()%16)!=0) {
+    meta.append((char)0);
   }
-  iceserv_metadata.prepend((char)(iceserv_metadata.length()/16));
+  meta.prepend((char)(meta.length()/16));
+
+  //
+  // Listeners may still have the old block queued
+  //
+  iceserv_metadata->unref();
+  iceserv_metadata=
+    iceserv_pool->copy((const unsigned char *)meta.constData(),meta.size());
 }
 
 
@@ -535,6 +704,17 @@ void IceStreamConnector::StartStream(IceStream *strm)
 }
 
 
+void IceStreamConnector::MapWrites(IceStream *strm,int id)
+{
+  iceserv_write_mapper->setMapping(strm->writeNotifier(),id);
+  connect(strm->writeNotifier(),SIGNAL(activated(int)),
+	  iceserv_write_mapper,SLOT(map()));
+  iceserv_write_mapper->setMapping(strm->socket(),id);
+  connect(strm->socket(),SIGNAL(bytesWritten(qint64)),
+	  iceserv_write_mapper,SLOT(map()));
+}
+
+
 int IceStreamConnector::GetFreeStreamId()
 {
   for(unsigned i=0;i<iceserv_streams.size();i++) {
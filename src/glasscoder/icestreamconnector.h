@@ -21,16 +21,22 @@
 #ifndef ICESTREAMCONNECTOR_H
 #define ICESTREAMCONNECTOR_H
 
+#include <deque>
+
 #include <QSignalMapper>
+#include <QSocketNotifier>
 #include <QTcpServer>
 #include <QTcpSocket>
 #include <QTimer>
 
 #include "connector.h"
+#include "packetpool.h"
 #include "socketserver.h"
 
 #define ICESTREAM_METADATA_INTERVAL 16000
 #define ICESTREAM_CONNECTION_TIMEOUT 10000
+#define ICESTREAM_MAX_QUEUED 1048576
+#define ICESTREAM_MAX_IOVECS 64
 
 class IceStream
 {
@@ -40,6 +46,7 @@ class IceStream
   ~IceStream();
   QTcpSocket *socket() const;
   QTimer *timeoutTimer() const;
+  QSocketNotifier *writeNotifier() const;
   Type type() const;
   void setType(Type type);
   bool isNegotiated() const;
@@ -51,18 +58,30 @@ class IceStream
   bool metadataEnabled() const;
   void setMetadataEnabled(bool state);
   int addMetadataBytes(int bytes);
+  void queueData(PacketBuffer *buf,int offset,int len);
+  int64_t queuedBytes() const;
+  bool flushQueue();
   QString accum;
 
  private:
+  struct Slice {
+    PacketBuffer *buf;
+    int offset;
+    int len;
+  };
+  bool SendQueue();
   unsigned ice_id;
   QTcpSocket *ice_socket;
   QTimer *ice_timeout_timer;
+  QSocketNotifier *ice_write_notifier;
   Type ice_type;
   bool ice_is_negotiated;
   bool ice_is_authenticated;
   QString ice_stream_title;
   bool ice_metadata_enabled;
   int ice_metadata_bytes;
+  std::deque<Slice> ice_queue;
+  int64_t ice_queued_bytes;
 };
 
 
@@ -84,6 +103,7 @@ class IceStreamConnector : public Connector
   void newConnectionData();
   void newPipeConnectionData();
   void readyReadData(int id);
+  void writeReadyData(int id);
   void timeoutData(int id);
   void disconnectedData();
   void garbageData();
@@ -92,7 +112,7 @@ class IceStreamConnector : public Connector
   void startStopping();
   void connectToHostConnector(const QUrl &url);
   void disconnectFromHostConnector();
-  int64_t writeDataConnector(int frames,const unsigned char *data,int64_t len);
+  int64_t writePacketConnector(const EncodedPacket *pkt);
 
  private:
   void SetMetadata(const QString &title);
@@ -101,13 +121,16 @@ class IceStreamConnector : public Connector
   void CloseConnection(IceStream *strm,int code,const QString &str,
 		       const QStringList &hdrs=QStringList());
   void StartStream(IceStream *strm);
+  void MapWrites(IceStream *strm,int id);
   int GetFreeStreamId();
   QTcpServer *iceserv_server;
   std::vector<IceStream *> iceserv_streams;
   QSignalMapper *iceserv_readyread_mapper;
   QSignalMapper *iceserv_timeout_mapper;
+  QSignalMapper *iceserv_write_mapper;
   QTimer *iceserv_garbage_timer;
-  QByteArray iceserv_metadata;
+  PacketPool *iceserv_pool;
+  PacketBuffer *iceserv_metadata;
   SocketServer *iceserv_socket_server;
   QByteArray iceserv_stream_prologue;
 };
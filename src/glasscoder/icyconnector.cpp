@@ -108,13 +108,12 @@ void IcyConnector::disconnectFromHostConnector()
 }
 
 
-int64_t IcyConnector::writeDataConnector(int frames,const unsigned char *data,
-					 int64_t len)
+int64_t IcyConnector::writePacketConnector(const EncodedPacket *pkt)
 {
   if(icy_socket->state()==QAbstractSocket::ConnectedState) {
-    return icy_socket->write((const char *)data,len);
+    return icy_socket->write((const char *)pkt->data(),pkt->size());
   }
-  return len;
+  return pkt->size();
 }
 
 
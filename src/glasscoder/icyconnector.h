@@ -38,7 +38,7 @@ class IcyConnector : public Connector
  protected:
   void connectToHostConnector(const QUrl &url);
   void disconnectFromHostConnector();
-  int64_t writeDataConnector(int frames,const unsigned char *data,int64_t len);
+  int64_t writePacketConnector(const EncodedPacket *pkt);
 
  private slots:
   void socketConnectedData();
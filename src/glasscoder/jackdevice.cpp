@@ -21,6 +21,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "glasslimits.h"
 #include "jackdevice.h"
@@ -30,8 +31,8 @@
 // JACK Callback
 //
 #ifdef JACK
-jack_default_audio_sample_t *jack_cb_buffers[MAX_AUDIO_CHANNELS];
-float jack_cb_interleave_buffer[MAX_AUDIO_CHANNELS*RINGBUFFER_SIZE];
+const jack_default_audio_sample_t *jack_cb_buffers[MAX_AUDIO_CHANNELS];
+float jack_cb_gain_buffer[MAX_AUDIO_CHANNELS][RINGBUFFER_SIZE];
 
 int JackProcess(jack_nframes_t nframes, void *arg)
 {
@@ -39,23 +40,31 @@ int JackProcess(jack_nframes_t nframes, void *arg)
   static jack_nframes_t j;
   static JackDevice *obj=(JackDevice *)arg;
   static float lvls[MAX_AUDIO_CHANNELS];
+  jack_default_audio_sample_t *port;
 
   //
   // Get Buffers
   //
-  for(i=0;i<obj->channels();i++) {
-    jack_cb_buffers[i]=(jack_default_audio_sample_t *)
-      jack_port_get_buffer(obj->jack_jack_ports[i],nframes);
-  }
-
-  //
-  // Interleave Channels
+  // JACK ports are already planar, so at unity gain they go straight
+  // into the ringbuffer.  Otherwise, the gain is applied on the way
+  // through a scratch plane.
   //
   for(i=0;i<obj->channels();i++) {
-    if(jack_cb_buffers[i]!=NULL) {
-      for(j=0;j<nframes;j++) {
-	jack_cb_interleave_buffer[obj->channels()*j+i]=
-	  (float)jack_cb_buffers[i][j]*obj->jack_gain;
+    port=(jack_default_audio_sample_t *)
+      jack_port_get_buffer(obj->jack_jack_ports[i],nframes);
+    if(port==NULL) {
+      memset(jack_cb_gain_buffer[i],0,nframes*sizeof(float));
+      jack_cb_buffers[i]=jack_cb_gain_buffer[i];
+    }
+    else {
+      if(obj->jack_gain==1.0) {
+	jack_cb_buffers[i]=port;
+      }
+      else {
+	for(j=0;j<nframes;j++) {
+	  jack_cb_gain_buffer[i][j]=port[j]*obj->jack_gain;
+	}
+	jack_cb_buffers[i]=jack_cb_gain_buffer[i];
       }
     }
   }
@@ -63,8 +72,8 @@ int JackProcess(jack_nframes_t nframes, void *arg)
   //
   // Write It
   //
-  obj->ringBuffer()->write(jack_cb_interleave_buffer,nframes);
-  obj->peakLevels(lvls,jack_cb_interleave_buffer,nframes,obj->channels());
+  obj->writeRingBufferPlanar(jack_cb_buffers,nframes);
+  obj->peakLevelsPlanar(lvls,jack_cb_buffers,nframes,obj->channels());
   for(i=0;i<obj->channels();i++) {
     obj->jack_meter_avg[i]->addValue(lvls[i]);
   }
@@ -75,7 +84,7 @@ int JackProcess(jack_nframes_t nframes, void *arg)
 
 
 JackDevice::JackDevice(unsigned chans,unsigned samprate,
-		       Ringbuffer *ring,QObject *parent)
+		       BroadcastRingbuffer *ring,QObject *parent)
   : AudioDevice(chans,samprate,ring,parent)
 {
 #ifdef JACK
@@ -204,6 +213,8 @@ bool JackDevice::start(QString *err)
     return false;
   }
   jack_set_process_callback(jack_jack_client,JackProcess,this);
+  jack_jack_sample_rate=jack_get_sample_rate(jack_jack_client);
+  allocateRingBuffer();
 
   //
   // Join the Graph
@@ -212,7 +223,6 @@ bool JackDevice::start(QString *err)
     *err=tr("unable to join JACK graph");
     return false;
   }
-  jack_jack_sample_rate=jack_get_sample_rate(jack_jack_client);
 
   //
   // Register Ports
@@ -245,6 +255,12 @@ unsigned JackDevice::deviceSamplerate() const
 }
 
 
+Ringbuffer::Layout JackDevice::nativeLayout() const
+{
+  return Ringbuffer::Planar;
+}
+
+
 void JackDevice::meterData()
 {
 #ifdef JACK
@@ -39,12 +39,13 @@ class JackDevice : public AudioDevice
   Q_OBJECT;
  public:
   JackDevice(unsigned chans,unsigned samprate,
-	     Ringbuffer *ring,QObject *parent=0);
+	     BroadcastRingbuffer *ring,QObject *parent=0);
   ~JackDevice();
   bool processOptions(QString *err,const QStringList &keys,
 		      const QStringList &values);
   bool start(QString *err);
   unsigned deviceSamplerate() const;
+  Ringbuffer::Layout nativeLayout() const;
 
  private slots:
   void meterData();
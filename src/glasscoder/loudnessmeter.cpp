@@ -0,0 +1,419 @@
+// loudnessmeter.cpp
+//
+// EBU R128 / ITU-R BS.1770 loudness and true-peak meter.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <math.h>
+#include <string.h>
+
+#include "loudnessmeter.h"
+
+//
+// 4x oversampling interpolator, from ITU-R BS.1770-4 Annex 2
+//
+static const float loudness_tp_coeffs
+  [LOUDNESS_TRUEPEAK_PHASES][LOUDNESS_TRUEPEAK_TAPS]=
+  {{0.0017089843750,0.0109863281250,-0.0196533203125,0.0332031250000,
+    -0.0594482421875,0.1373291015625,0.9721679687500,-0.1022949218750,
+    0.0476074218750,-0.0266113281250,0.0148925781250,-0.0083007812500},
+   {-0.0291748046875,0.0292968750000,-0.0517578125000,0.0891113281250,
+    -0.1665039062500,0.4650878906250,0.7797851562500,-0.2003173828125,
+    0.1015625000000,-0.0582275390625,0.0330810546875,-0.0189208984375},
+   {-0.0189208984375,0.0330810546875,-0.0582275390625,0.1015625000000,
+    -0.2003173828125,0.7797851562500,0.4650878906250,-0.1665039062500,
+    0.0891113281250,-0.0517578125000,0.0292968750000,-0.0291748046875},
+   {-0.0083007812500,0.0148925781250,-0.0266113281250,0.0476074218750,
+    -0.1022949218750,0.9721679687500,0.1373291015625,-0.0594482421875,
+    0.0332031250000,-0.0196533203125,0.0109863281250,0.0017089843750}};
+
+void *LoudnessMeterThread(void *ptr)
+{
+  LoudnessMeter *meter=(LoudnessMeter *)ptr;
+  Ringbuffer *ring=meter->meter_ring;
+  unsigned frames;
+
+  //
+  // The capture ringbuffer's writer never waits for us, so audio is
+  // copied out (read() discards torn copies) before it can reach the
+  // filter state or the gating histogram.
+  //
+  while(meter->meter_running) {
+    ring->waitForData(2*LOUDNESS_SUBBLOCK_MSEC);
+    while(ring->readSpace()>0) {
+      if(ring->layout()==Ringbuffer::Planar) {
+	frames=ring->readPlanar(meter->meter_pcm_planes,
+				meter->meter_subblock_frames);
+	if(frames>0) {
+	  meter->processPlanar(meter->meter_pcm_planes,frames);
+	}
+      }
+      else {
+	frames=ring->read(meter->meter_pcm,meter->meter_subblock_frames);
+	if(frames>0) {
+	  meter->process(meter->meter_pcm,frames);
+	}
+      }
+    }
+  }
+
+  return NULL;
+}
+
+
+LoudnessMeter::LoudnessMeter(Ringbuffer *ring,unsigned chans,
+			     unsigned samprate)
+{
+  double k;
+  double vh;
+  double vb;
+  double q;
+  double a0;
+
+  meter_ring=ring;
+  meter_channels=chans;
+  meter_samplerate=samprate;
+  meter_running=false;
+
+  //
+  // K-weighting filter, recalculated for the actual sample rate
+  // (see ITU-R BS.1770-4 Annex 1)
+  //
+  k=tan(M_PI*1681.974450955533/(double)samprate);
+  vh=pow(10.0,3.999843853973347/20.0);
+  vb=pow(vh,0.4996667741545416);
+  q=0.7071752369554196;
+  a0=1.0+k/q+k*k;
+  meter_shelf_b[0]=(vh+vb*k/q+k*k)/a0;
+  meter_shelf_b[1]=2.0*(k*k-vh)/a0;
+  meter_shelf_b[2]=(vh-vb*k/q+k*k)/a0;
+  meter_shelf_a[0]=1.0;
+  meter_shelf_a[1]=2.0*(k*k-1.0)/a0;
+  meter_shelf_a[2]=(1.0-k/q+k*k)/a0;
+
+  k=tan(M_PI*38.13547087602444/(double)samprate);
+  q=0.5003270373238773;
+  a0=1.0+k/q+k*k;
+  meter_hpf_b[0]=1.0;
+  meter_hpf_b[1]=-2.0;
+  meter_hpf_b[2]=1.0;
+  meter_hpf_a[0]=1.0;
+  meter_hpf_a[1]=2.0*(k*k-1.0)/a0;
+  meter_hpf_a[2]=(1.0-k/q+k*k)/a0;
+
+  memset(meter_shelf_z,0,sizeof(meter_shelf_z));
+  memset(meter_hpf_z,0,sizeof(meter_hpf_z));
+
+  meter_subblock_frames=samprate*LOUDNESS_SUBBLOCK_MSEC/1000;
+  meter_pcm=new float[meter_subblock_frames*MAX_AUDIO_CHANNELS];
+  for(unsigned i=0;i<MAX_AUDIO_CHANNELS;i++) {
+    meter_pcm_planes[i]=meter_pcm+i*meter_subblock_frames;
+  }
+  meter_subblock_count=0;
+  memset(meter_subblock_sum,0,sizeof(meter_subblock_sum));
+  memset(meter_subblock_peak,0,sizeof(meter_subblock_peak));
+  memset(meter_energy,0,sizeof(meter_energy));
+  memset(meter_peak,0,sizeof(meter_peak));
+  meter_slot=0;
+  meter_subblocks=0;
+
+  memset(meter_gate_count,0,sizeof(meter_gate_count));
+  memset(meter_gate_energy,0,sizeof(meter_gate_energy));
+  meter_gated_blocks=0;
+  meter_gated_energy=0.0;
+
+  memset(meter_tp_history,0,sizeof(meter_tp_history));
+  meter_tp_pos=0;
+
+  meter_momentary=LOUDNESS_FLOOR;
+  meter_shortterm=LOUDNESS_FLOOR;
+  meter_integrated=LOUDNESS_FLOOR;
+  for(unsigned i=0;i<MAX_AUDIO_CHANNELS;i++) {
+    meter_true_peak[i]=LOUDNESS_FLOOR;
+    meter_max_true_peak[i]=LOUDNESS_FLOOR;
+    meter_max_peak[i]=0.0;
+  }
+}
+
+
+LoudnessMeter::~LoudnessMeter()
+{
+  stop();
+  delete[] meter_pcm;
+}
+
+
+unsigned LoudnessMeter::channels() const
+{
+  return meter_channels;
+}
+
+
+unsigned LoudnessMeter::samplerate() const
+{
+  return meter_samplerate;
+}
+
+
+double LoudnessMeter::momentaryLoudness() const
+{
+  return meter_momentary;
+}
+
+
+double LoudnessMeter::shortTermLoudness() const
+{
+  return meter_shortterm;
+}
+
+
+double LoudnessMeter::integratedLoudness() const
+{
+  return meter_integrated;
+}
+
+
+double LoudnessMeter::truePeak(unsigned chan) const
+{
+  return meter_true_peak[chan];
+}
+
+
+double LoudnessMeter::maximumTruePeak(unsigned chan) const
+{
+  return meter_max_true_peak[chan];
+}
+
+
+void LoudnessMeter::process(const float *pcm,unsigned frames)
+{
+  const float *planes[MAX_AUDIO_CHANNELS];
+
+  for(unsigned i=0;i<meter_channels;i++) {
+    planes[i]=pcm+i;
+  }
+  Process(planes,meter_channels,frames);
+}
+
+
+void LoudnessMeter::processPlanar(const float *const *pcm,unsigned frames)
+{
+  Process(pcm,1,frames);
+}
+
+
+void LoudnessMeter::Process(const float *const *pcm,unsigned stride,
+			    unsigned frames)
+{
+  double x;
+  double y;
+  float peak;
+  float tp;
+  const float *hist;
+
+  for(unsigned i=0;i<frames;i++) {
+    for(unsigned j=0;j<meter_channels;j++) {
+      x=pcm[j][stride*i];
+
+      //
+      // True peak
+      //
+      meter_tp_history[j][meter_tp_pos]=x;
+      meter_tp_history[j][meter_tp_pos+LOUDNESS_TRUEPEAK_TAPS]=x;
+      hist=meter_tp_history[j]+meter_tp_pos+1;
+      peak=fabsf(x);
+      for(unsigned k=0;k<LOUDNESS_TRUEPEAK_PHASES;k++) {
+	tp=0.0;
+	for(unsigned l=0;l<LOUDNESS_TRUEPEAK_TAPS;l++) {
+	  tp+=loudness_tp_coeffs[k][l]*hist[l];
+	}
+	if(fabsf(tp)>peak) {
+	  peak=fabsf(tp);
+	}
+      }
+      if(peak>meter_subblock_peak[j]) {
+	meter_subblock_peak[j]=peak;
+      }
+
+      //
+      // K-weighting (transposed direct form II)
+      //
+      y=meter_shelf_b[0]*x+meter_shelf_z[j][0];
+      meter_shelf_z[j][0]=
+	meter_shelf_b[1]*x-meter_shelf_a[1]*y+meter_shelf_z[j][1];
+      meter_shelf_z[j][1]=meter_shelf_b[2]*x-meter_shelf_a[2]*y;
+      x=y;
+      y=meter_hpf_b[0]*x+meter_hpf_z[j][0];
+      meter_hpf_z[j][0]=meter_hpf_b[1]*x-meter_hpf_a[1]*y+meter_hpf_z[j][1];
+      meter_hpf_z[j][1]=meter_hpf_b[2]*x-meter_hpf_a[2]*y;
+      meter_subblock_sum[j]+=y*y;
+    }
+    meter_tp_pos=(meter_tp_pos+1)%LOUDNESS_TRUEPEAK_TAPS;
+    if(++meter_subblock_count==meter_subblock_frames) {
+      EndSubblock();
+    }
+  }
+}
+
+
+bool LoudnessMeter::start()
+{
+  meter_ring->setWakeThreshold(meter_subblock_frames);
+  meter_running=true;
+  if(pthread_create(&meter_thread,NULL,LoudnessMeterThread,this)!=0) {
+    meter_running=false;
+    return false;
+  }
+  return true;
+}
+
+
+void LoudnessMeter::stop()
+{
+  if(meter_running) {
+    meter_running=false;
+    meter_ring->wake();
+    pthread_join(meter_thread,NULL);
+  }
+}
+
+
+void LoudnessMeter::EndSubblock()
+{
+  double energy=0.0;
+  double gate;
+  double sum;
+  uint64_t count;
+  float peak;
+  int bin;
+
+  //
+  // Close out the sub-block (all channels weighted at 1.0, as for L/R/C)
+  //
+  for(unsigned i=0;i<meter_channels;i++) {
+    energy+=meter_subblock_sum[i]/(double)meter_subblock_frames;
+    meter_subblock_sum[i]=0.0;
+    meter_peak[meter_slot][i]=meter_subblock_peak[i];
+    if(meter_subblock_peak[i]>meter_max_peak[i]) {
+      meter_max_peak[i]=meter_subblock_peak[i];
+      meter_max_true_peak[i]=Decibels(meter_max_peak[i]);
+    }
+    meter_subblock_peak[i]=0.0;
+  }
+  meter_energy[meter_slot]=energy;
+  meter_slot=(meter_slot+1)%LOUDNESS_SHORTTERM_SUBBLOCKS;
+  meter_subblock_count=0;
+  meter_subblocks++;
+
+  //
+  // Momentary (400 mS) and short-term (3 S) windows
+  //
+  energy=WindowEnergy(LOUDNESS_MOMENTARY_SUBBLOCKS);
+  meter_momentary=Loudness(energy);
+  meter_shortterm=Loudness(WindowEnergy(LOUDNESS_SHORTTERM_SUBBLOCKS));
+  for(unsigned i=0;i<meter_channels;i++) {
+    peak=0.0;
+    for(unsigned j=1;j<=LOUDNESS_MOMENTARY_SUBBLOCKS;j++) {
+      unsigned slot=(meter_slot+LOUDNESS_SHORTTERM_SUBBLOCKS-j)%
+	LOUDNESS_SHORTTERM_SUBBLOCKS;
+      if(meter_peak[slot][i]>peak) {
+	peak=meter_peak[slot][i];
+      }
+    }
+    meter_true_peak[i]=Decibels(peak);
+  }
+
+  //
+  // Integrated loudness.  Each momentary window is a gating block (75%
+  // overlap).  Blocks are binned by loudness, keeping their summed energy
+  // so that the relative gate can be applied in constant memory.
+  //
+  if(meter_subblocks<LOUDNESS_MOMENTARY_SUBBLOCKS) {
+    return;
+  }
+  if(Loudness(energy)>LOUDNESS_ABSOLUTE_GATE) {
+    bin=(Loudness(energy)-LOUDNESS_ABSOLUTE_GATE)/LOUDNESS_HISTOGRAM_STEP;
+    if(bin>=LOUDNESS_HISTOGRAM_BINS) {
+      bin=LOUDNESS_HISTOGRAM_BINS-1;
+    }
+    meter_gate_count[bin]++;
+    meter_gate_energy[bin]+=energy;
+    meter_gated_blocks++;
+    meter_gated_energy+=energy;
+  }
+  if(meter_gated_blocks==0) {
+    return;
+  }
+  gate=Loudness(meter_gated_energy/(double)meter_gated_blocks)+
+    LOUDNESS_RELATIVE_GATE;
+  bin=(gate-LOUDNESS_ABSOLUTE_GATE)/LOUDNESS_HISTOGRAM_STEP;
+  if(bin<0) {
+    bin=0;
+  }
+  sum=0.0;
+  count=0;
+  for(int i=bin;i<LOUDNESS_HISTOGRAM_BINS;i++) {
+    sum+=meter_gate_energy[i];
+    count+=meter_gate_count[i];
+  }
+  if(count>0) {
+    meter_integrated=Loudness(sum/(double)count);
+  }
+}
+
+
+double LoudnessMeter::WindowEnergy(unsigned subblocks) const
+{
+  double energy=0.0;
+
+  for(unsigned i=1;i<=subblocks;i++) {
+    energy+=meter_energy[(meter_slot+LOUDNESS_SHORTTERM_SUBBLOCKS-i)%
+			 LOUDNESS_SHORTTERM_SUBBLOCKS];
+  }
+
+  return energy/(double)subblocks;
+}
+
+
+double LoudnessMeter::Loudness(double energy)
+{
+  double ret;
+
+  if(energy<=0.0) {
+    return LOUDNESS_FLOOR;
+  }
+  ret=-0.691+10.0*log10(energy);
+  if(ret<LOUDNESS_FLOOR) {
+    return LOUDNESS_FLOOR;
+  }
+  return ret;
+}
+
+
+double LoudnessMeter::Decibels(double peak)
+{
+  double ret;
+
+  if(peak<=0.0) {
+    return LOUDNESS_FLOOR;
+  }
+  ret=20.0*log10(peak);
+  if(ret<LOUDNESS_FLOOR) {
+    return LOUDNESS_FLOOR;
+  }
+  return ret;
+}
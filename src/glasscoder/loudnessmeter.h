@@ -0,0 +1,125 @@
+// loudnessmeter.h
+//
+// EBU R128 / ITU-R BS.1770 loudness and true-peak meter.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef LOUDNESSMETER_H
+#define LOUDNESSMETER_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include <pthread.h>
+
+#include "glasslimits.h"
+#include "ringbuffer.h"
+
+#define LOUDNESS_SUBBLOCK_MSEC 100
+#define LOUDNESS_MOMENTARY_SUBBLOCKS 4
+#define LOUDNESS_SHORTTERM_SUBBLOCKS 30
+#define LOUDNESS_ABSOLUTE_GATE -70.0
+#define LOUDNESS_RELATIVE_GATE -10.0
+#define LOUDNESS_HISTOGRAM_BINS 1000
+#define LOUDNESS_HISTOGRAM_STEP 0.1
+#define LOUDNESS_TRUEPEAK_TAPS 12
+#define LOUDNESS_TRUEPEAK_PHASES 4
+#define LOUDNESS_FLOOR -120.0
+
+class LoudnessMeter
+{
+ public:
+  LoudnessMeter(Ringbuffer *ring,unsigned chans,unsigned samprate);
+  ~LoudnessMeter();
+  unsigned channels() const;
+  unsigned samplerate() const;
+  double momentaryLoudness() const;
+  double shortTermLoudness() const;
+  double integratedLoudness() const;
+  double truePeak(unsigned chan) const;
+  double maximumTruePeak(unsigned chan) const;
+  void process(const float *pcm,unsigned frames);
+  void processPlanar(const float *const *pcm,unsigned frames);
+  bool start();
+  void stop();
+  friend void *LoudnessMeterThread(void *ptr);
+
+ private:
+  void Process(const float *const *pcm,unsigned stride,unsigned frames);
+  void EndSubblock();
+  double WindowEnergy(unsigned subblocks) const;
+  static double Loudness(double energy);
+  static double Decibels(double peak);
+  Ringbuffer *meter_ring;
+  unsigned meter_channels;
+  unsigned meter_samplerate;
+  float *meter_pcm;
+  float *meter_pcm_planes[MAX_AUDIO_CHANNELS];
+
+  //
+  // K-Weighting Filter (two cascaded biquads per channel)
+  //
+  double meter_shelf_b[3];
+  double meter_shelf_a[3];
+  double meter_hpf_b[3];
+  double meter_hpf_a[3];
+  double meter_shelf_z[MAX_AUDIO_CHANNELS][2];
+  double meter_hpf_z[MAX_AUDIO_CHANNELS][2];
+
+  //
+  // 100 mS Sub-blocks, kept for the 3 second short-term window
+  //
+  unsigned meter_subblock_frames;
+  unsigned meter_subblock_count;
+  double meter_subblock_sum[MAX_AUDIO_CHANNELS];
+  float meter_subblock_peak[MAX_AUDIO_CHANNELS];
+  double meter_energy[LOUDNESS_SHORTTERM_SUBBLOCKS];
+  float meter_peak[LOUDNESS_SHORTTERM_SUBBLOCKS][MAX_AUDIO_CHANNELS];
+  unsigned meter_slot;
+  uint64_t meter_subblocks;
+
+  //
+  // Gating histogram for integrated loudness
+  //
+  uint64_t meter_gate_count[LOUDNESS_HISTOGRAM_BINS];
+  double meter_gate_energy[LOUDNESS_HISTOGRAM_BINS];
+  uint64_t meter_gated_blocks;
+  double meter_gated_energy;
+
+  //
+  // 4x Oversampling True-Peak Filter
+  //
+  float meter_tp_history[MAX_AUDIO_CHANNELS][2*LOUDNESS_TRUEPEAK_TAPS];
+  unsigned meter_tp_pos;
+
+  //
+  // Published Results
+  //
+  std::atomic<double> meter_momentary;
+  std::atomic<double> meter_shortterm;
+  std::atomic<double> meter_integrated;
+  std::atomic<double> meter_true_peak[MAX_AUDIO_CHANNELS];
+  std::atomic<double> meter_max_true_peak[MAX_AUDIO_CHANNELS];
+  float meter_max_peak[MAX_AUDIO_CHANNELS];
+
+  pthread_t meter_thread;
+  std::atomic<bool> meter_running;
+};
+
+
+#endif  // LOUDNESSMETER_H
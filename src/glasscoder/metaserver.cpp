@@ -18,6 +18,7 @@
 //   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
 
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QUrl>
@@ -25,10 +26,13 @@
 
 #include "metaserver.h"
 
-MetaServer::MetaServer(Config *config,QObject *parent)
+MetaServer::MetaServer(Config *config,BroadcastRingbuffer *ring,
+		       LoudnessMeter *meter,QObject *parent)
   : HttpServer(parent)
 {
   meta_config=config;
+  meta_ring=ring;
+  meta_loudness_meter=meter;
 }
 
 
@@ -81,6 +85,16 @@ void MetaServer::getRequestReceived(HttpConnection *conn)
     }
   }
 
+  if(url.path()=="/stats") {   // Ringbuffer Statistics
+    conn->sendResponse(200,RingbufferStats(),"application/json");
+    return;
+  }
+
+  if((url.path()=="/loudness")&&(meta_loudness_meter!=NULL)) {
+    conn->sendResponse(200,LoudnessStats(),"application/json");
+    return;
+  }
+
   conn->sendError(resp_code,resp_str);
 }
 
@@ -120,6 +134,63 @@ bool MetaServer::authenticateUser(const QString &realm,const QString &name,
 }
 
 
+QByteArray MetaServer::RingbufferStats() const
+{
+  QJsonArray rings;
+  std::vector<unsigned> bitrates=meta_config->audioBitrates();
+  unsigned renditions=bitrates.size();
+
+  //
+  // One reader per rendition (just one for VBR); any others belong to
+  // the loudness meter.
+  //
+  if(renditions==0) {
+    renditions=1;
+  }
+  for(unsigned i=0;(i<renditions)&&(i<meta_ring->readerQuantity());i++) {
+    Ringbuffer *ring=meta_ring->reader(i);
+    QJsonObject obj;
+    obj.insert("Rendition",(int)i);
+    if(i<bitrates.size()) {
+      obj.insert("Bitrate",(int)bitrates.at(i));
+    }
+    obj.insert("FramesWritten",(double)ring->framesWritten());
+    obj.insert("FramesDropped",(double)ring->framesDropped());
+    obj.insert("Overruns",(double)ring->overruns());
+    obj.insert("Underruns",(double)ring->underruns());
+    obj.insert("HighWater",(int)ring->highWater());
+    obj.insert("Size",(int)ring->size());
+    rings.append(obj);
+  }
+  QJsonObject ret;
+  ret.insert("Ringbuffers",rings);
+
+  return QJsonDocument(ret).toJson();
+}
+
+
+QByteArray MetaServer::LoudnessStats() const
+{
+  QJsonArray peaks;
+  QJsonArray max_peaks;
+  QJsonObject obj;
+
+  obj.insert("Momentary",meta_loudness_meter->momentaryLoudness());
+  obj.insert("ShortTerm",meta_loudness_meter->shortTermLoudness());
+  obj.insert("Integrated",meta_loudness_meter->integratedLoudness());
+  for(unsigned i=0;i<meta_loudness_meter->channels();i++) {
+    peaks.append(meta_loudness_meter->truePeak(i));
+    max_peaks.append(meta_loudness_meter->maximumTruePeak(i));
+  }
+  obj.insert("TruePeak",peaks);
+  obj.insert("MaximumTruePeak",max_peaks);
+  QJsonObject ret;
+  ret.insert("Loudness",obj);
+
+  return QJsonDocument(ret).toJson();
+}
+
+
 bool MetaServer::ProcessJsonMetadataUpdates(const QJsonObject &obj)
 {
   QStringList keys=obj.keys();
@@ -24,13 +24,16 @@
 
 #include "config.h"
 #include "httpserver.h"
+#include "loudnessmeter.h"
 #include "metaevent.h"
+#include "ringbuffer.h"
 
 class MetaServer : public HttpServer
 {
   Q_OBJECT;
  public:
-  MetaServer(Config *config,QObject *parent=0);
+  MetaServer(Config *config,BroadcastRingbuffer *ring,LoudnessMeter *meter,
+	     QObject *parent=0);
 
  signals:
   void metadataReceived(MetaEvent *e);
@@ -43,7 +46,11 @@ class MetaServer : public HttpServer
 
  private:
   bool ProcessJsonMetadataUpdates(const QJsonObject &obj);
+  QByteArray RingbufferStats() const;
+  QByteArray LoudnessStats() const;
   Config *meta_config;
+  BroadcastRingbuffer *meta_ring;
+  LoudnessMeter *meta_loudness_meter;
 };
 
 
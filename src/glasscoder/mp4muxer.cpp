@@ -0,0 +1,604 @@
+// mp4muxer.cpp
+//
+// Fragmented MP4 (CMAF) muxer for AAC and Opus audio.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <string.h>
+
+#include "frameparser.h"
+#include "mp4muxer.h"
+
+static const unsigned mp4muxer_adts_samplerates[16]=
+  {96000,88200,64000,48000,44100,32000,24000,22050,
+   16000,12000,11025,8000,7350,0,0,0};
+
+static const uint32_t mp4muxer_unity_matrix[9]=
+  {0x00010000,0,0,0,0x00010000,0,0,0,0x40000000};
+
+static void Put8(QByteArray *data,uint8_t val)
+{
+  data->append((char)val);
+}
+
+
+static void Put16(QByteArray *data,uint16_t val)
+{
+  data->append(0xFF&(val>>8));
+  data->append(0xFF&val);
+}
+
+
+static void Put32(QByteArray *data,uint32_t val)
+{
+  for(int i=0;i<4;i++) {
+    data->append(0xFF&(val>>(24-8*i)));
+  }
+}
+
+
+static void Put64(QByteArray *data,uint64_t val)
+{
+  Put32(data,val>>32);
+  Put32(data,0xFFFFFFFF&val);
+}
+
+
+static void PutZeros(QByteArray *data,int len)
+{
+  data->append(QByteArray(len,0));
+}
+
+
+static void PutMatrix(QByteArray *data)
+{
+  for(int i=0;i<9;i++) {
+    Put32(data,mp4muxer_unity_matrix[i]);
+  }
+}
+
+
+static QByteArray Box(const char *type,const QByteArray &payload)
+{
+  QByteArray ret;
+
+  Put32(&ret,8+payload.size());
+  ret.append(type,4);
+  ret.append(payload);
+
+  return ret;
+}
+
+
+static QByteArray FullBox(const char *type,uint8_t version,uint32_t flags,
+			  const QByteArray &payload)
+{
+  QByteArray body;
+
+  Put32(&body,(version<<24)|(0xFFFFFF&flags));
+  body.append(payload);
+
+  return Box(type,body);
+}
+
+
+static QByteArray Descriptor(uint8_t tag,const QByteArray &payload)
+{
+  QByteArray ret;
+
+  //
+  // Always use the four byte size form, as some demuxers insist on it
+  //
+  Put8(&ret,tag);
+  Put8(&ret,0x80|(0x7F&(payload.size()>>21)));
+  Put8(&ret,0x80|(0x7F&(payload.size()>>14)));
+  Put8(&ret,0x80|(0x7F&(payload.size()>>7)));
+  Put8(&ret,0x7F&payload.size());
+  ret.append(payload);
+
+  return ret;
+}
+
+
+Mp4Muxer::Mp4Muxer(Mp4Muxer::Format fmt,unsigned samprate,unsigned chans)
+{
+  mux_format=fmt;
+  mux_samplerate=samprate;
+  mux_channels=chans;
+  mux_frag_decode_time=0;
+  mux_decode_time=0;
+  mux_sequence=1;
+}
+
+
+Mp4Muxer::Format Mp4Muxer::format() const
+{
+  return mux_format;
+}
+
+
+unsigned Mp4Muxer::timescale() const
+{
+  if(mux_format==Mp4Muxer::Opus) {
+    return MP4MUXER_OPUS_TIMESCALE;
+  }
+  return mux_samplerate;
+}
+
+
+bool Mp4Muxer::isReady() const
+{
+  return mux_decoder_config.size()>0;
+}
+
+
+QByteArray Mp4Muxer::decoderConfig() const
+{
+  return mux_decoder_config;
+}
+
+
+QByteArray Mp4Muxer::initSegment() const
+{
+  QByteArray ftyp;
+  QByteArray mvhd;
+  QByteArray tkhd;
+  QByteArray mdhd;
+  QByteArray hdlr;
+  QByteArray smhd;
+  QByteArray dref;
+  QByteArray stsd;
+  QByteArray trex;
+  QByteArray zero32;
+  QByteArray zero64;
+
+  Put32(&zero32,0);
+  Put64(&zero64,0);
+
+  //
+  // CMAF media profile brands
+  //
+  ftyp.append("iso6",4);
+  Put32(&ftyp,0);
+  ftyp.append("iso6",4);
+  ftyp.append("cmfc",4);
+  ftyp.append("mp41",4);
+
+  Put32(&mvhd,0);  // Creation time
+  Put32(&mvhd,0);  // Modification time
+  Put32(&mvhd,timescale());
+  Put32(&mvhd,0);  // Duration (unknown)
+  Put32(&mvhd,0x00010000);  // Rate
+  Put16(&mvhd,0x0100);  // Volume
+  PutZeros(&mvhd,10);
+  PutMatrix(&mvhd);
+  PutZeros(&mvhd,24);
+  Put32(&mvhd,MP4MUXER_TRACK_ID+1);  // Next track ID
+
+  Put32(&tkhd,0);  // Creation time
+  Put32(&tkhd,0);  // Modification time
+  Put32(&tkhd,MP4MUXER_TRACK_ID);
+  Put32(&tkhd,0);
+  Put32(&tkhd,0);  // Duration (unknown)
+  PutZeros(&tkhd,8);
+  Put16(&tkhd,0);  // Layer
+  Put16(&tkhd,1);  // Alternate group
+  Put16(&tkhd,0x0100);  // Volume
+  Put16(&tkhd,0);
+  PutMatrix(&tkhd);
+  Put32(&tkhd,0);  // Width
+  Put32(&tkhd,0);  // Height
+
+  Put32(&mdhd,0);  // Creation time
+  Put32(&mdhd,0);  // Modification time
+  Put32(&mdhd,timescale());
+  Put32(&mdhd,0);  // Duration (unknown)
+  Put16(&mdhd,0x55C4);  // Language ("und")
+  Put16(&mdhd,0);
+
+  Put32(&hdlr,0);
+  hdlr.append("soun",4);
+  PutZeros(&hdlr,12);
+  hdlr.append("SoundHandler",13);
+
+  Put32(&smhd,0);  // Balance
+
+  Put32(&dref,1);
+  dref.append(FullBox("url ",0,1,QByteArray()));  // Self-contained
+
+  Put32(&stsd,1);
+  stsd.append(SampleEntry());
+
+  Put32(&trex,MP4MUXER_TRACK_ID);
+  Put32(&trex,1);  // Sample description index
+  Put32(&trex,0);  // Default sample duration
+  Put32(&trex,0);  // Default sample size
+  Put32(&trex,0);  // Default sample flags (all sync samples)
+
+  //
+  // The sample tables are empty, as all of the samples are in the
+  // fragments
+  //
+  QByteArray stbl=FullBox("stsd",0,0,stsd)+
+    FullBox("stts",0,0,zero32)+
+    FullBox("stsc",0,0,zero32)+
+    FullBox("stsz",0,0,zero64)+
+    FullBox("stco",0,0,zero32);
+  QByteArray minf=FullBox("smhd",0,0,smhd)+
+    Box("dinf",FullBox("dref",0,0,dref))+
+    Box("stbl",stbl);
+  QByteArray mdia=FullBox("mdhd",0,0,mdhd)+
+    FullBox("hdlr",0,0,hdlr)+
+    Box("minf",minf);
+  QByteArray trak=FullBox("tkhd",0,3,tkhd)+
+    Box("mdia",mdia);
+  QByteArray moov=FullBox("mvhd",0,0,mvhd)+
+    Box("trak",trak)+
+    Box("mvex",FullBox("trex",0,0,trex));
+
+  return Box("ftyp",ftyp)+Box("moov",moov);
+}
+
+
+unsigned Mp4Muxer::parse(const unsigned char *data,int len)
+{
+  int used=0;
+  int n;
+
+  mux_parse_data.clear();
+  mux_parse_offsets.clear();
+  mux_parse_sizes.clear();
+  mux_parse_durations.clear();
+
+  //
+  // Codecs hand us whole frames (pages), but don't rely on it
+  //
+  mux_carry.append((const char *)data,len);
+  while(used<mux_carry.size()) {
+    if(mux_format==Mp4Muxer::Aac) {
+      n=ParseAdts((const unsigned char *)mux_carry.constData()+used,
+		  mux_carry.size()-used);
+    }
+    else {
+      n=ParseOgg((const unsigned char *)mux_carry.constData()+used,
+		 mux_carry.size()-used);
+    }
+    if(n==0) {
+      break;
+    }
+    used+=n;
+  }
+  mux_carry.remove(0,used);
+
+  return mux_parse_offsets.size();
+}
+
+
+unsigned Mp4Muxer::samples() const
+{
+  return mux_parse_offsets.size();
+}
+
+
+unsigned Mp4Muxer::sampleDuration(unsigned n) const
+{
+  return mux_parse_durations.at(n);
+}
+
+
+void Mp4Muxer::addSample(unsigned n)
+{
+  if(mux_frag_sizes.size()==0) {
+    mux_frag_decode_time=mux_decode_time;
+  }
+  mux_frag_data.append(mux_parse_data.constData()+mux_parse_offsets.at(n),
+		       mux_parse_sizes.at(n));
+  mux_frag_sizes.push_back(mux_parse_sizes.at(n));
+  mux_frag_durations.push_back(mux_parse_durations.at(n));
+  mux_decode_time+=mux_parse_durations.at(n);
+}
+
+
+unsigned Mp4Muxer::fragmentSamples() const
+{
+  return mux_frag_sizes.size();
+}
+
+
+uint64_t Mp4Muxer::decodeTime() const
+{
+  return mux_decode_time;
+}
+
+
+void Mp4Muxer::setDecodeTime(uint64_t time)
+{
+  mux_decode_time=time;
+}
+
+
+QByteArray Mp4Muxer::fragment()
+{
+  QByteArray mfhd;
+  QByteArray tfhd;
+  QByteArray tfdt;
+  QByteArray trun;
+  QByteArray mdat_hdr;
+
+  if(mux_frag_sizes.size()==0) {
+    return QByteArray();
+  }
+  Put32(&mfhd,mux_sequence++);
+  Put32(&tfhd,MP4MUXER_TRACK_ID);
+  Put64(&tfdt,mux_frag_decode_time);
+
+  //
+  // The data offset is relative to the start of the 'moof' box
+  // (default-base-is-moof), and points just past the 'mdat' header
+  //
+  int trun_size=8+4+4+4+8*mux_frag_sizes.size();
+  int moof_size=8+(8+4+4)+8+(8+4+4)+(8+4+8)+trun_size;
+  Put32(&trun,mux_frag_sizes.size());
+  Put32(&trun,moof_size+8);
+  for(unsigned i=0;i<mux_frag_sizes.size();i++) {
+    Put32(&trun,mux_frag_durations.at(i));
+    Put32(&trun,mux_frag_sizes.at(i));
+  }
+  QByteArray traf=FullBox("tfhd",0,0x020000,tfhd)+
+    FullBox("tfdt",1,0,tfdt)+
+    FullBox("trun",0,0x000301,trun);
+  QByteArray ret=Box("moof",FullBox("mfhd",0,0,mfhd)+Box("traf",traf))+
+    Box("mdat",mux_frag_data);
+
+  mux_frag_data.clear();
+  mux_frag_sizes.clear();
+  mux_frag_durations.clear();
+
+  return ret;
+}
+
+
+Mp4Muxer::Format Mp4Muxer::format(const QString &content_type)
+{
+  switch(FrameParser::format(content_type)) {
+  case FrameParser::Adts:
+    return Mp4Muxer::Aac;
+
+  case FrameParser::Ogg:
+    return Mp4Muxer::Opus;
+
+  case FrameParser::Mpeg:
+  case FrameParser::Unknown:
+    break;
+  }
+  return Mp4Muxer::Unknown;
+}
+
+
+unsigned Mp4Muxer::opusPacketDuration(const unsigned char *data,int len)
+{
+  //
+  // Per the TOC byte [RFC 6716 Section 3.1], in 48 kHz samples
+  //
+  static const unsigned silk[4]={480,960,1920,2880};
+  static const unsigned celt[4]={120,240,480,960};
+  unsigned config;
+  unsigned frame;
+  unsigned count=1;
+
+  if(len<1) {
+    return 0;
+  }
+  config=data[0]>>3;
+  if(config<12) {
+    frame=silk[config&0x03];
+  }
+  else {
+    if(config<16) {
+      frame=480<<(config&0x01);  // Hybrid
+    }
+    else {
+      frame=celt[config&0x03];
+    }
+  }
+  switch(data[0]&0x03) {
+  case 1:
+  case 2:
+    count=2;
+    break;
+
+  case 3:
+    if(len<2) {
+      return 0;
+    }
+    count=data[1]&0x3F;
+    break;
+  }
+
+  return frame*count;
+}
+
+
+int Mp4Muxer::ParseAdts(const unsigned char *data,int len)
+{
+  //
+  // Returns the number of bytes consumed, or zero if more data is needed
+  //
+  unsigned samples=0;
+  unsigned rate=0;
+  int size=FrameParser::adtsFrameSize(data,len,&samples,&rate);
+  int hdr_size;
+
+  if(size<0) {  // Lost sync
+    return 1;
+  }
+  if((size==0)||(size>len)) {
+    return 0;
+  }
+  hdr_size=((data[1]&0x01)==0)?9:7;  // CRC present?
+  if(size<=hdr_size) {
+    return size;
+  }
+
+  if(mux_decoder_config.size()==0) {
+    //
+    // AudioSpecificConfig [ISO/IEC 14496-3 Section 1.6.2.1].  For HE-AAC,
+    // the ADTS header carries the AAC-LC core, so signal SBR explicitly
+    // in the backward-compatible way.
+    //
+    unsigned aot=(data[2]>>6)+1;
+    unsigned index=(data[2]>>2)&0x0F;
+    unsigned chans=((data[2]&0x01)<<2)|(data[3]>>6);
+    uint64_t bits=(aot<<11)|(index<<7)|(chans<<3);
+    int nbits=16;
+    if((rate>0)&&(mux_samplerate==2*rate)) {
+      for(unsigned i=0;i<13;i++) {
+	if(mp4muxer_adts_samplerates[i]==mux_samplerate) {
+	  bits=(bits<<24)|(0x2B7<<13)|(5<<8)|(1<<7)|(i<<3);
+	  nbits+=24;
+	  break;
+	}
+      }
+    }
+    for(int i=nbits-8;i>=0;i-=8) {
+      mux_decoder_config.append(0xFF&(bits>>i));
+    }
+  }
+
+  //
+  // HE-AAC headers carry the core rate, which is half the output rate
+  //
+  if((rate>0)&&(rate!=timescale())) {
+    samples=(uint64_t)samples*timescale()/rate;
+  }
+  AddParsedSample(data+hdr_size,size-hdr_size,samples);
+
+  return size;
+}
+
+
+int Mp4Muxer::ParseOgg(const unsigned char *data,int len)
+{
+  int64_t granulepos;
+  int size=FrameParser::oggPageSize(data,len,&granulepos);
+  int offset;
+
+  if(size<0) {  // Lost sync
+    return 1;
+  }
+  if((size==0)||(size>len)) {
+    return 0;
+  }
+  if((data[5]&0x02)!=0) {  // Beginning of stream
+    mux_packet_carry.clear();
+  }
+
+  //
+  // Reassemble packets from the lacing values.  A packet continues onto
+  // the next page if the last lacing value on this one is 255.
+  //
+  offset=27+data[26];
+  for(int i=0;i<data[26];i++) {
+    mux_packet_carry.append((const char *)data+offset,data[27+i]);
+    offset+=data[27+i];
+    if(data[27+i]<255) {
+      const unsigned char *pkt=
+	(const unsigned char *)mux_packet_carry.constData();
+      int pkt_len=mux_packet_carry.size();
+      if((pkt_len>=8)&&(memcmp(pkt,"OpusHead",8)==0)) {
+	mux_decoder_config=mux_packet_carry;
+      }
+      else {
+	if((pkt_len>0)&&
+	   ((pkt_len<8)||(memcmp(pkt,"OpusTags",8)!=0))) {
+	  AddParsedSample(pkt,pkt_len,opusPacketDuration(pkt,pkt_len));
+	}
+      }
+      mux_packet_carry.clear();
+    }
+  }
+
+  return size;
+}
+
+
+void Mp4Muxer::AddParsedSample(const unsigned char *data,int len,
+			       unsigned duration)
+{
+  mux_parse_offsets.push_back(mux_parse_data.size());
+  mux_parse_sizes.push_back(len);
+  mux_parse_durations.push_back(duration);
+  mux_parse_data.append((const char *)data,len);
+}
+
+
+QByteArray Mp4Muxer::SampleEntry() const
+{
+  QByteArray entry;
+  QByteArray config;
+
+  PutZeros(&entry,6);
+  Put16(&entry,1);  // Data reference index
+  PutZeros(&entry,8);
+  Put16(&entry,mux_channels);
+  Put16(&entry,16);  // Sample size
+  Put16(&entry,0);
+  Put16(&entry,0);
+  Put32(&entry,(0xFFFF&timescale())<<16);
+
+  if(mux_format==Mp4Muxer::Opus) {
+    //
+    // OpusSpecificBox [Encapsulation of Opus in ISOBMFF Section 4.3.2].
+    // Same content as the OpusHead, but big-endian.
+    //
+    const unsigned char *head=
+      (const unsigned char *)mux_decoder_config.constData();
+    Put8(&config,0);  // Version
+    Put8(&config,head[9]);
+    Put16(&config,head[10]|(head[11]<<8));
+    Put32(&config,head[12]|(head[13]<<8)|(head[14]<<16)|(head[15]<<24));
+    Put16(&config,head[16]|(head[17]<<8));
+    Put8(&config,head[18]);
+    if((head[18]!=0)&&(mux_decoder_config.size()>=(21+head[9]))) {
+      config.append(mux_decoder_config.mid(19,2+head[9]));
+    }
+    entry.append(Box("dOps",config));
+    return Box("Opus",entry);
+  }
+
+  //
+  // ES_Descriptor [ISO/IEC 14496-1 Section 7.2.6.5]
+  //
+  QByteArray dcd;
+  QByteArray es;
+  QByteArray sl;
+  Put8(&dcd,0x40);  // Audio ISO/IEC 14496-3
+  Put8(&dcd,0x15);  // Audio stream
+  Put8(&dcd,0);  // Buffer size
+  Put16(&dcd,0);
+  Put32(&dcd,0);  // Max bitrate
+  Put32(&dcd,0);  // Average bitrate
+  dcd.append(Descriptor(0x05,mux_decoder_config));
+  Put16(&es,0);  // ES ID
+  Put8(&es,0);
+  es.append(Descriptor(0x04,dcd));
+  Put8(&sl,0x02);
+  es.append(Descriptor(0x06,sl));
+  entry.append(FullBox("esds",0,0,Descriptor(0x03,es)));
+
+  return Box("mp4a",entry);
+}
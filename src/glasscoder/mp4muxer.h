@@ -0,0 +1,92 @@
+// mp4muxer.h
+//
+// Fragmented MP4 (CMAF) muxer for AAC and Opus audio.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef MP4MUXER_H
+#define MP4MUXER_H
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#define MP4MUXER_OPUS_TIMESCALE 48000
+#define MP4MUXER_TRACK_ID 1
+
+//
+// Takes the codec bitstream (ADTS for AAC, Ogg pages for Opus) one
+// block at a time, and splits it into access units ("samples").  The
+// caller then adds whichever of those it wants to the current fragment,
+// and collects the finished 'moof'/'mdat' pair with fragment().
+//
+// The decoder configuration is taken from the bitstream itself -- the
+// first ADTS header, or the OpusHead packet -- so initSegment() is only
+// valid once isReady() returns true.
+//
+// Sample durations and decode times are in timescale() units, which is
+// the stream samplerate for AAC and 48 kHz for Opus.
+//
+class Mp4Muxer
+{
+ public:
+  enum Format {Unknown=0,Aac=1,Opus=2};
+  Mp4Muxer(Mp4Muxer::Format fmt,unsigned samprate,unsigned chans);
+  Mp4Muxer::Format format() const;
+  unsigned timescale() const;
+  bool isReady() const;
+  QByteArray decoderConfig() const;
+  QByteArray initSegment() const;
+  unsigned parse(const unsigned char *data,int len);
+  unsigned samples() const;
+  unsigned sampleDuration(unsigned n) const;
+  void addSample(unsigned n);
+  unsigned fragmentSamples() const;
+  uint64_t decodeTime() const;
+  void setDecodeTime(uint64_t time);
+  QByteArray fragment();
+  static Mp4Muxer::Format format(const QString &content_type);
+  static unsigned opusPacketDuration(const unsigned char *data,int len);
+
+ private:
+  int ParseAdts(const unsigned char *data,int len);
+  int ParseOgg(const unsigned char *data,int len);
+  void AddParsedSample(const unsigned char *data,int len,unsigned duration);
+  QByteArray SampleEntry() const;
+  Mp4Muxer::Format mux_format;
+  unsigned mux_samplerate;
+  unsigned mux_channels;
+  QByteArray mux_decoder_config;
+  QByteArray mux_carry;
+  QByteArray mux_packet_carry;
+  QByteArray mux_parse_data;
+  std::vector<int> mux_parse_offsets;
+  std::vector<int> mux_parse_sizes;
+  std::vector<unsigned> mux_parse_durations;
+  QByteArray mux_frag_data;
+  std::vector<unsigned> mux_frag_sizes;
+  std::vector<unsigned> mux_frag_durations;
+  uint64_t mux_frag_decode_time;
+  uint64_t mux_decode_time;
+  uint32_t mux_sequence;
+};
+
+
+#endif  // MP4MUXER_H
@@ -26,6 +26,7 @@ MpegL2Codec::MpegL2Codec(Ringbuffer *ring,QObject *parent)
 {
 #ifdef HAVE_TWOLAME
   twolame_handle=NULL;
+  twolame_pending_frames=0;
 #endif  // HAVE_TWOLAME
 }
 
@@ -63,7 +64,7 @@ QString MpegL2Codec::formatIdentifier() const
   //
   // See RFC 6381
   //
-  return QString("mp4a/40.33");
+  return QString("mp4a.40.33");
 }
 
 
@@ -149,11 +150,49 @@ void MpegL2Codec::encodeData(Connector *conn,const float *pcm,int frames)
 {
 #ifdef HAVE_TWOLAME
   int s;
-  unsigned char mpeg[8640];
+  unsigned nframes=0;
+  EncodedPacket *pkt=packet();
 
+  //
+  // TwoLAME emits a frame each time it has a full frame's worth of PCM
+  // buffered, so the output duration follows from the count of samples
+  // fed in.
+  //
+  pkt->reserve(MPEGL2_MAX_OUTPUT);
   if((s=twolame_encode_buffer_float32_interleaved(twolame_lameopts,pcm,frames,
-						  mpeg,8640))>=0) {
-    conn->writeData(frames,mpeg,s);
+						  pkt->data(),
+						  MPEGL2_MAX_OUTPUT))>=0) {
+    twolame_pending_frames+=frames;
+    nframes=twolame_pending_frames/MPEGL2_FRAME_SAMPLES;
+    twolame_pending_frames-=nframes*MPEGL2_FRAME_SAMPLES;
+    pkt->setSize(s);
+    writePacket(conn,nframes*MPEGL2_FRAME_SAMPLES,
+		EncodedPacket::FrameBoundary|EncodedPacket::Keyframe);
+  }
+#endif  // HAVE_TWOLAME
+}
+
+
+void MpegL2Codec::flushEncoder(Connector *conn)
+{
+#ifdef HAVE_TWOLAME
+  int s;
+  unsigned nframes=0;
+  EncodedPacket *pkt=packet();
+
+  //
+  // TwoLAME pads out any partial frame it is still holding
+  //
+  pkt->reserve(MPEGL2_MAX_OUTPUT);
+  if((s=twolame_encode_flush(twolame_lameopts,pkt->data(),
+			     MPEGL2_MAX_OUTPUT))>0) {
+    if(twolame_pending_frames>0) {
+      nframes=1;
+    }
+    twolame_pending_frames=0;
+    pkt->setSize(s);
+    writePacket(conn,nframes*MPEGL2_FRAME_SAMPLES,
+		EncodedPacket::FrameBoundary|EncodedPacket::Keyframe);
   }
 #endif  // HAVE_TWOLAME
 }
@@ -27,6 +27,9 @@
 
 #include "codec.h"
 
+#define MPEGL2_FRAME_SAMPLES 1152
+#define MPEGL2_MAX_OUTPUT 8640
+
 class MpegL2Codec : public Codec
 {
   Q_OBJECT;
@@ -41,6 +44,7 @@ class MpegL2Codec : public Codec
 
  protected:
   void encodeData(Connector *conn,const float *pcm,int frames);
+  void flushEncoder(Connector *conn);
 
  private:
 #ifdef HAVE_TWOLAME
@@ -62,6 +66,7 @@ class MpegL2Codec : public Codec
   int (*twolame_set_energy_levels)(twolame_options *,int);
   int (*twolame_set_VBR)(twolame_options *, int);
   int (*twolame_set_VBR_level)(twolame_options *, float);
+  unsigned twolame_pending_frames;
 #endif  // HAVE_TWOLAME
 };
 
@@ -27,6 +27,7 @@ MpegL3Codec::MpegL3Codec(Ringbuffer *ring,QObject *parent)
 #ifdef HAVE_LAME
   l3_lameopts=NULL;
   l3_lame_handle=NULL;
+  l3_frame_number=0;
 #endif  // HAVE_LAME
 }
 
@@ -127,6 +128,10 @@ bool MpegL3Codec::startCodec()
     dlsym(l3_lame_handle,"lame_set_disable_reservoir");
   *(void **)(&lame_get_disable_reservoir)=
     dlsym(l3_lame_handle,"lame_get_disable_reservoir");
+  *(void **)(&lame_get_frameNum)=
+    dlsym(l3_lame_handle,"lame_get_frameNum");
+  *(void **)(&lame_get_framesize)=
+    dlsym(l3_lame_handle,"lame_get_framesize");
   if(lame_encode_buffer_ieee_float==NULL) {  // Earlier versions of LAME didn't include this!
     return false;
   }
@@ -183,19 +188,57 @@ void MpegL3Codec::encodeData(Connector *conn,const float *pcm,int frames)
 {
 #ifdef HAVE_LAME
   int s;
-  unsigned char mpeg[8640];
+  int nframes=0;
+  unsigned flags=EncodedPacket::FrameBoundary;
+  EncodedPacket *pkt=packet();
 
+  pkt->reserve(MPEGL3_MAX_OUTPUT);
   if(channels()==2) {
-    if((s=lame_encode_buffer_interleaved_ieee_float(l3_lameopts,pcm,
-						    frames,mpeg,8640))>=0) {
-      conn->writeData(frames,mpeg,s);
-    }
+    s=lame_encode_buffer_interleaved_ieee_float(l3_lameopts,pcm,frames,
+						pkt->data(),MPEGL3_MAX_OUTPUT);
   }
   else {
-    if((s=lame_encode_buffer_ieee_float(l3_lameopts,pcm,NULL,frames,
-					mpeg,8640))>=0) {
-      conn->writeData(frames,mpeg,s);
+    s=lame_encode_buffer_ieee_float(l3_lameopts,pcm,NULL,frames,
+				    pkt->data(),MPEGL3_MAX_OUTPUT);
+  }
+  if(s>=0) {
+    //
+    // LAME's look-ahead means that the frames coming out are not the
+    // ones just fed in, so ask it how many it has actually completed.
+    // Frames can only be decoded on their own without the bit reservoir.
+    //
+    nframes=lame_get_frameNum(l3_lameopts)-l3_frame_number;
+    l3_frame_number+=nframes;
+    if(completeFrames()) {
+      flags|=EncodedPacket::Keyframe;
+    }
+    pkt->setSize(s);
+    writePacket(conn,nframes*lame_get_framesize(l3_lameopts),flags);
+  }
+#endif  // HAVE_LAME
+}
+
+
+void MpegL3Codec::flushEncoder(Connector *conn)
+{
+#ifdef HAVE_LAME
+  int s;
+  int nframes=0;
+  unsigned flags=EncodedPacket::FrameBoundary;
+  EncodedPacket *pkt=packet();
+
+  //
+  // Empty out LAME's look-ahead and bit reservoir
+  //
+  pkt->reserve(MPEGL3_MAX_OUTPUT);
+  if((s=lame_encode_flush(l3_lameopts,pkt->data(),MPEGL3_MAX_OUTPUT))>0) {
+    nframes=lame_get_frameNum(l3_lameopts)-l3_frame_number;
+    l3_frame_number+=nframes;
+    if(completeFrames()) {
+      flags|=EncodedPacket::Keyframe;
     }
+    pkt->setSize(s);
+    writePacket(conn,nframes*lame_get_framesize(l3_lameopts),flags);
   }
 #endif  // HAVE_LAME
 }
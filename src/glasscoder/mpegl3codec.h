@@ -27,6 +27,8 @@
 
 #include "codec.h"
 
+#define MPEGL3_MAX_OUTPUT 8640
+
 class MpegL3Codec : public Codec
 {
   Q_OBJECT;
@@ -41,6 +43,7 @@ class MpegL3Codec : public Codec
 
  protected:
   void encodeData(Connector *conn,const float *pcm,int frames);
+  void flushEncoder(Connector *conn);
 
  private:
 #ifdef HAVE_LAME
@@ -84,6 +87,9 @@ class MpegL3Codec : public Codec
   int (*lame_set_VBR_quality)(lame_global_flags *, float);
   int (*lame_set_disable_reservoir)(lame_global_flags *,int);
   int (*lame_get_disable_reservoir)(const lame_global_flags *);
+  int (*lame_get_frameNum)(const lame_global_flags *);
+  int (*lame_get_framesize)(const lame_global_flags *);
+  int l3_frame_number;
 #endif  // HAVE_LAME
 };
 
@@ -22,7 +22,13 @@
 #include <fcntl.h>
 #include <stdlib.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
@@ -95,6 +101,8 @@ NetConveyor::NetConveyor(Config *conf,QObject *parent)
 {
   conv_config=conf;
   conv_process=NULL;
+  conv_socket=-1;
+  conv_spooling=false;
 
   //
   // Create temp directory
@@ -134,6 +142,9 @@ NetConveyor::~NetConveyor()
     conv_process->kill();
     delete conv_process;
   }
+  if(conv_socket>=0) {
+    close(conv_socket);
+  }
 }
 
 
@@ -151,13 +162,17 @@ void NetConveyor::push(const NetConveyorEvent &evt)
   //  printf("pushing: %s\n",evt.dump().toUtf8().constData());
   int fd=-1;
   QString timestamp=Connector::timeStampString();
-  QString temp_pathname=conv_temp_dir->path()+"/"+
-    timestamp+"-"+
-    NetConveyorEvent::httpMethodString(evt.method())+"-"+
-    evt.pathname().split("/",QString::SkipEmptyParts).last();
+  QString temp_pathname=SpoolPathname(timestamp,evt);
   //  printf("sourcePathname: %s\n",evt.pathname().toUtf8().constData());
   //  printf("temp_pathname: %s\n",temp_pathname.toUtf8().constData());
 
+  if((evt.method()!=NetConveyorEvent::PutMethod)&&SendMessage(evt,-1)) {
+    if(evt.method()==NetConveyorEvent::DeleteMethod) {
+      conv_putted_files.removeAll(evt.pathname());
+    }
+    return;
+  }
+
   switch(evt.method()) {
   case NetConveyorEvent::DeleteMethod:
     if((fd=open(temp_pathname.toUtf8(),O_CREAT|O_WRONLY,S_IRUSR|S_IWUSR))>=0) {
@@ -190,6 +205,77 @@ void NetConveyor::push(const NetConveyorEvent &evt)
 }
 
 
+void NetConveyor::push(void *orig,const QString &pathname,int fd)
+{
+  NetConveyorEvent evt(orig,pathname,NetConveyorEvent::PutMethod);
+
+  //
+  // Once sealed, the object can no longer be changed by anybody, so
+  // glassconv(1) can read it for as long as it likes
+  //
+  if(fcntl(fd,F_ADD_SEALS,F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_WRITE|
+	   F_SEAL_SEAL)<0) {
+    Log(LOG_WARNING,QString::asprintf("unable to seal \"%s\": %s",
+				      pathname.toUtf8().constData(),
+				      strerror(errno)));
+  }
+  if(!SendMessage(evt,fd)) {
+    if(!SpoolDescriptor(fd,SpoolPathname(Connector::timeStampString(),evt))) {
+      return;
+    }
+  }
+  if((!conv_putted_files.contains(pathname))&&
+     (!conv_config->serverNoDeletes())) {
+    conv_putted_files.push_back(pathname);
+  }
+}
+
+
+void NetConveyor::push(void *orig,const QString &pathname,
+		       const QByteArray &data)
+{
+  int fd=-1;
+  ssize_t n=0;
+
+  if((fd=openBuffer(pathname))<0) {
+    return;
+  }
+  while(n<data.size()) {
+    ssize_t m=write(fd,data.constData()+n,data.size()-n);
+    if(m<0) {
+      Log(LOG_WARNING,QString::asprintf("unable to buffer \"%s\": %s",
+					pathname.toUtf8().constData(),
+					strerror(errno)));
+      close(fd);
+      return;
+    }
+    n+=m;
+  }
+  push(orig,pathname,fd);
+  close(fd);
+}
+
+
+bool NetConveyor::usesDescriptors() const
+{
+  return conv_config->serverMemfd();
+}
+
+
+int NetConveyor::openBuffer(const QString &pathname) const
+{
+  int fd=-1;
+
+  if((fd=memfd_create(pathname.split("/",QString::SkipEmptyParts).last().
+		      toUtf8(),MFD_CLOEXEC|MFD_ALLOW_SEALING))<0) {
+    Log(LOG_WARNING,
+	QString::asprintf("unable to create memory file for \"%s\": %s",
+			  pathname.toUtf8().constData(),strerror(errno)));
+  }
+  return fd;
+}
+
+
 void NetConveyor::stop()
 {
   //
@@ -232,6 +318,9 @@ void NetConveyor::startConveyorProcess()
   }
   fprintf(f,"UserAgent=%s\n",
 	  conv_config->serverUserAgent().toUtf8().constData());
+  fprintf(f,"TargetDuration=%u\n",conv_config->hlsSegmentDuration());
+  fprintf(f,"Window=%u\n",conv_config->hlsWindow());
+  fprintf(f,"MaxTransfers=%u\n",conv_config->serverMaxUploads());
   if(conv_config->serverPrecleanPublishPoint()) {
     fprintf(f,"PrecleanUrl=%s\n",
 	    conv_config->serverUrl().toString(QUrl::RemovePort).
@@ -243,9 +332,30 @@ void NetConveyor::startConveyorProcess()
   // Start glassconv(1)
   //
   QStringList args;
+  int socks[2]={-1,-1};
 
   args.push_back("--dest-url="+conv_config->serverBaseUrl());
   args.push_back("--source-dir="+conv_temp_dir->path());
+  if(conv_config->serverMemfd()) {
+    //
+    // Anything still in the old socket went down with the old process
+    //
+    if(conv_socket>=0) {
+      close(conv_socket);
+      conv_socket=-1;
+    }
+    if(socketpair(AF_UNIX,SOCK_SEQPACKET|SOCK_NONBLOCK|SOCK_CLOEXEC,0,
+		  socks)<0) {
+      Log(LOG_WARNING,
+	  QString::asprintf("unable to create conveyor socket, spooling "
+			    "instead [%s]",strerror(errno)));
+    }
+    else {
+      fcntl(socks[1],F_SETFD,0);  // To be inherited by glassconv(1)
+      conv_socket=socks[0];
+      args.push_back(QString::asprintf("--conveyor-fd=%d",socks[1]));
+    }
+  }
 
   conv_process=new QProcess(this);
   QProcessEnvironment env=QProcessEnvironment::systemEnvironment();
@@ -256,6 +366,9 @@ void NetConveyor::startConveyorProcess()
   connect(conv_process,SIGNAL(finished(int,QProcess::ExitStatus)),
 	  this,SLOT(processFinishedData(int,QProcess::ExitStatus)));
   conv_process->start(GLASSCODER_PREFIX+"/bin/glassconv",args);
+  if(socks[1]>=0) {
+    close(socks[1]);
+  }
 }
 
 
@@ -305,3 +418,144 @@ void NetConveyor::processReadyReadData()
     }
   }
 }
+
+
+QString NetConveyor::SpoolPathname(const QString &timestamp,
+				   const NetConveyorEvent &evt) const
+{
+  return conv_temp_dir->path()+"/"+
+    timestamp+"-"+
+    NetConveyorEvent::httpMethodString(evt.method())+"-"+
+    evt.pathname().split("/",QString::SkipEmptyParts).last();
+}
+
+
+bool NetConveyor::SendMessage(const NetConveyorEvent &evt,int fd)
+{
+  struct NetConveyorMessage cmsg;
+  struct msghdr msg;
+  struct iovec iov[1];
+  union {
+    struct cmsghdr cm;
+    char control[CMSG_SPACE(sizeof(int))];
+  } control_un;
+  struct cmsghdr *cmptr;
+  struct stat st;
+  QByteArray destname=
+    evt.pathname().split("/",QString::SkipEmptyParts).last().toUtf8();
+
+  if((conv_socket<0)||(destname.size()>NETCONVEYOR_MAX_DESTNAME)) {
+    return false;
+  }
+
+  //
+  // Once anything has gone to the spool, everything after it has to go
+  // the same way until glassconv(1) has caught up, or a playlist sent
+  // over the socket could overtake the segment that it refers to
+  //
+  if(conv_spooling) {
+    if(!SpoolDrained()) {
+      return false;
+    }
+    conv_spooling=false;
+  }
+
+  //
+  // Header
+  //
+  memset(&cmsg,0,sizeof(cmsg));
+  cmsg.magic=NETCONVEYOR_MESSAGE_MAGIC;
+  cmsg.method=evt.method();
+  cmsg.timestamp=time(NULL);
+  if(fd>=0) {
+    memset(&st,0,sizeof(st));
+    fstat(fd,&st);
+    cmsg.length=st.st_size;
+  }
+  strncpy(cmsg.destname,destname.constData(),NETCONVEYOR_MAX_DESTNAME);
+
+  //
+  // Descriptor
+  //
+  memset(&msg,0,sizeof(msg));
+  memset(iov,0,sizeof(struct iovec));
+  if(fd>=0) {
+    msg.msg_control=control_un.control;
+    msg.msg_controllen=sizeof(control_un.control);
+    cmptr=CMSG_FIRSTHDR(&msg);
+    cmptr->cmsg_len=CMSG_LEN(sizeof(int));
+    cmptr->cmsg_level=SOL_SOCKET;
+    cmptr->cmsg_type=SCM_RIGHTS;
+    *((int *)CMSG_DATA(cmptr))=fd;
+  }
+  iov[0].iov_base=&cmsg;
+  iov[0].iov_len=sizeof(cmsg);
+  msg.msg_iov=iov;
+  msg.msg_iovlen=1;
+
+  if(sendmsg(conv_socket,&msg,MSG_NOSIGNAL)!=sizeof(cmsg)) {
+    conv_spooling=true;
+    Log(LOG_WARNING,
+	QString::asprintf("unable to pass \"%s\" to glassconv, spooling "
+			  "instead [%s]",destname.constData(),strerror(errno)));
+    return false;
+  }
+  return true;
+}
+
+
+bool NetConveyor::SpoolDrained() const
+{
+  //
+  // Caught up means that glassconv(1) has read everything sent over the
+  // socket and finished with (and so removed) everything spooled
+  //
+  int pending=0;
+
+  if((ioctl(conv_socket,SIOCOUTQ,&pending)<0)||(pending>0)) {
+    return false;
+  }
+  return conv_temp_dir->entryList(QDir::Files).isEmpty();
+}
+
+
+bool NetConveyor::SpoolDescriptor(int fd,const QString &pathname) const
+{
+  //
+  // The copy gets its name only once it is complete, so that
+  // glassconv(1) never sees a partial file
+  //
+  int tfd=-1;
+  struct stat st;
+  off_t offset=0;
+
+  memset(&st,0,sizeof(st));
+  fstat(fd,&st);
+  if((tfd=open(conv_temp_dir->path().toUtf8(),O_TMPFILE|O_WRONLY,
+	       S_IRUSR|S_IWUSR))<0) {
+    Log(LOG_WARNING,
+	QString::asprintf("unable to spool \"%s\": %s",
+			  pathname.toUtf8().constData(),strerror(errno)));
+    return false;
+  }
+  while(offset<st.st_size) {
+    if(sendfile(tfd,fd,&offset,st.st_size-offset)<=0) {
+      Log(LOG_WARNING,
+	  QString::asprintf("unable to spool \"%s\": %s",
+			    pathname.toUtf8().constData(),strerror(errno)));
+      close(tfd);
+      return false;
+    }
+  }
+  if(linkat(AT_FDCWD,QString::asprintf("/proc/self/fd/%d",tfd).toUtf8(),
+	    AT_FDCWD,pathname.toUtf8(),AT_SYMLINK_FOLLOW)<0) {
+    Log(LOG_WARNING,
+	QString::asprintf("unable to spool \"%s\": %s",
+			  pathname.toUtf8().constData(),strerror(errno)));
+    close(tfd);
+    return false;
+  }
+  close(tfd);
+
+  return true;
+}
@@ -21,6 +21,8 @@
 #ifndef NETCONVEYOR_H
 #define NETCONVEYOR_H
 
+#include <stdint.h>
+
 #include <QDir>
 #include <QObject>
 #include <QProcess>
@@ -30,6 +32,22 @@
 
 #include "config.h"
 
+#define NETCONVEYOR_MESSAGE_MAGIC 0x474c4331  // "GLC1"
+#define NETCONVEYOR_MAX_DESTNAME 255
+
+//
+// One of these goes over the --conveyor-fd socket for each event, with
+// the sealed memfd holding the object attached for PUTs.
+//
+struct NetConveyorMessage
+{
+  uint32_t magic;
+  uint32_t method;     // NetConveyorEvent::HttpMethod
+  uint64_t timestamp;  // Seconds since the epoch
+  uint64_t length;     // Size of the attached object
+  char destname[NETCONVEYOR_MAX_DESTNAME+1];
+};
+
 class NetConveyorEvent
 {
  public:
@@ -59,6 +77,10 @@ class NetConveyor : public QObject
   void push(void *orig,const QString &pathname,
 	    NetConveyorEvent::HttpMethod meth);
   void push(const NetConveyorEvent &evt);
+  void push(void *orig,const QString &pathname,int fd);
+  void push(void *orig,const QString &pathname,const QByteArray &data);
+  bool usesDescriptors() const;
+  int openBuffer(const QString &pathname) const;
   void stop();
 
  signals:
@@ -70,11 +92,18 @@ class NetConveyor : public QObject
   void processReadyReadData();
 
  private:
+  QString SpoolPathname(const QString &timestamp,
+			const NetConveyorEvent &evt) const;
+  bool SendMessage(const NetConveyorEvent &evt,int fd);
+  bool SpoolDrained() const;
+  bool SpoolDescriptor(int fd,const QString &pathname) const;
   QProcess *conv_process;
   QTimer *conv_restart_timer;
   QDir *conv_temp_dir;
   QStringList conv_putted_files;
   Config *conv_config;
+  int conv_socket;
+  bool conv_spooling;
 };
 
 
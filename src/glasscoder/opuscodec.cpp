@@ -28,6 +28,7 @@ OpusCodec::OpusCodec(Ringbuffer *ring,QObject *parent)
 {
   opus_packet_number=0;
   opus_packet_granulepos=0;
+  opus_page_granulepos=0;
 }
 
 
@@ -68,7 +69,10 @@ QString OpusCodec::defaultExtension() const
 
 QString OpusCodec::formatIdentifier() const
 {
-  return QString();
+  //
+  // See RFC 7845 and the Opus in ISOBMFF encapsulation spec
+  //
+  return QString("opus");
 }
 
 
@@ -256,8 +260,9 @@ void OpusCodec::encodeData(Connector *conn,const float *pcm,int frames)
   unsigned char data[4096];
 
   if(!opus_prologue_sent) {
-    conn->writeData(0,(const unsigned char *)opus_stream_prologue.constData(),
-		    opus_stream_prologue.size());
+    packet()->setData((const unsigned char *)opus_stream_prologue.constData(),
+		      opus_stream_prologue.size());
+    writePacket(conn,0,EncodedPacket::Header);
     opus_prologue_sent=true;
   }
 
@@ -270,11 +275,7 @@ void OpusCodec::encodeData(Connector *conn,const float *pcm,int frames)
     opus_ogg_packet.granulepos=opus_packet_granulepos;
     opus_ogg_packet.packetno=opus_packet_number++;
     ogg_stream_packetin(&opus_ogg_stream,&opus_ogg_packet);
-    while(ogg_stream_pageout(&opus_ogg_stream,&opus_ogg_page)!=0) {
-      conn->
-	writeData(frames,opus_ogg_page.header,opus_ogg_page.header_len);
-      conn->writeData(0,opus_ogg_page.body,opus_ogg_page.body_len);
-    }
+    WritePages(conn,false);
   }
   else {
     Log(LOG_WARNING,QString().sprintf("opus encoding error %d",s));
@@ -284,6 +285,46 @@ void OpusCodec::encodeData(Connector *conn,const float *pcm,int frames)
 }
 
 
+void OpusCodec::flushEncoder(Connector *conn)
+{
+#ifdef HAVE_OPUS
+  //
+  // Don't leave the last packets sitting in a partly filled page
+  //
+  WritePages(conn,true);
+#endif  // HAVE_OPUS
+}
+
+
+#ifdef HAVE_OPUS
+void OpusCodec::WritePages(Connector *conn,bool flush)
+{
+  int (*next_page)(ogg_stream_state *,ogg_page *)=
+    flush ? ogg_stream_flush : ogg_stream_pageout;
+
+  while(next_page(&opus_ogg_stream,&opus_ogg_page)!=0) {
+    //
+    // Send each page whole, timed by the advance in its granule
+    // position.  A page on which no packet ends has none.
+    //
+    unsigned duration=0;
+    unsigned flags=EncodedPacket::FrameBoundary;
+    int64_t granulepos=ogg_page_granulepos(&opus_ogg_page);
+    if(granulepos>=0) {
+      duration=granulepos-opus_page_granulepos;
+      opus_page_granulepos=granulepos;
+    }
+    if(ogg_page_continued(&opus_ogg_page)==0) {
+      flags|=EncodedPacket::Keyframe;
+    }
+    packet()->setData(opus_ogg_page.header,opus_ogg_page.header_len);
+    packet()->append(opus_ogg_page.body,opus_ogg_page.body_len);
+    writePacket(conn,duration,flags);
+  }
+}
+#endif  // HAVE_OPUS
+
+
 QByteArray OpusCodec::MakeInfoHeader(unsigned chans,unsigned samprate)
 {
   QByteArray hdr(19,0);
@@ -45,11 +45,13 @@ class OpusCodec : public Codec
 
  protected:
   void encodeData(Connector *conn,const float *pcm,int frames);
+  void flushEncoder(Connector *conn);
 
  private:
   QByteArray MakeInfoHeader(unsigned chans,unsigned samprate);
   QByteArray MakeCommentHeader();
 #ifdef HAVE_OPUS
+  void WritePages(Connector *conn,bool flush);
   void *opus_handle;
   void *opus_ogg_handle;
   OpusEncoder *opus_encoder;
@@ -141,6 +143,7 @@ class OpusCodec : public Codec
 #endif  // HAVE_OPUS
   uint64_t opus_packet_number;
   uint64_t opus_packet_granulepos;
+  int64_t opus_page_granulepos;
   QByteArray opus_stream_prologue;
   bool opus_prologue_sent;
 };
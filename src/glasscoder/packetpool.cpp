@@ -0,0 +1,193 @@
+// packetpool.cpp
+//
+// Pooled, reference-counted buffers for encoded audio.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <string.h>
+
+#include "packetpool.h"
+
+PacketBuffer::PacketBuffer(PacketPool *pool,unsigned char *data,int capacity,
+			   bool pooled)
+{
+  buf_pool=pool;
+  buf_data=data;
+  buf_size=0;
+  buf_capacity=capacity;
+  buf_refs=0;
+  buf_pooled=pooled;
+}
+
+
+PacketBuffer::~PacketBuffer()
+{
+  if(!buf_pooled) {
+    delete[] buf_data;
+  }
+}
+
+
+const unsigned char *PacketBuffer::data() const
+{
+  return buf_data;
+}
+
+
+unsigned char *PacketBuffer::data()
+{
+  return buf_data;
+}
+
+
+int PacketBuffer::size() const
+{
+  return buf_size;
+}
+
+
+void PacketBuffer::setSize(int bytes)
+{
+  if(bytes<0) {
+    bytes=0;
+  }
+  if(bytes>buf_capacity) {
+    bytes=buf_capacity;
+  }
+  buf_size=bytes;
+}
+
+
+int PacketBuffer::capacity() const
+{
+  return buf_capacity;
+}
+
+
+unsigned PacketBuffer::refCount() const
+{
+  return buf_refs;
+}
+
+
+void PacketBuffer::ref()
+{
+  buf_refs++;
+}
+
+
+void PacketBuffer::unref()
+{
+  if(--buf_refs==0) {
+    buf_pool->Release(this);
+  }
+}
+
+
+
+
+PacketPool::PacketPool(int chunk_size,unsigned slab_chunks)
+{
+  pool_chunk_size=chunk_size;
+  pool_slab_chunks=slab_chunks;
+}
+
+
+PacketPool::~PacketPool()
+{
+  for(unsigned i=0;i<pool_chunks.size();i++) {
+    delete pool_chunks.at(i);
+  }
+  for(unsigned i=0;i<pool_slabs.size();i++) {
+    delete[] pool_slabs.at(i);
+  }
+}
+
+
+int PacketPool::chunkSize() const
+{
+  return pool_chunk_size;
+}
+
+
+unsigned PacketPool::chunks() const
+{
+  return pool_chunks.size();
+}
+
+
+unsigned PacketPool::freeChunks() const
+{
+  return pool_free.size();
+}
+
+
+PacketBuffer *PacketPool::allocate(int bytes)
+{
+  PacketBuffer *buf=NULL;
+
+  if(bytes>pool_chunk_size) {
+    buf=new PacketBuffer(this,new unsigned char[bytes],bytes,false);
+  }
+  else {
+    if(pool_free.size()==0) {
+      AddSlab();
+    }
+    buf=pool_free.back();
+    pool_free.pop_back();
+  }
+  buf->buf_size=0;
+  buf->buf_refs=1;
+
+  return buf;
+}
+
+
+PacketBuffer *PacketPool::copy(const unsigned char *data,int len)
+{
+  PacketBuffer *buf=allocate(len);
+
+  memcpy(buf->data(),data,len);
+  buf->setSize(len);
+
+  return buf;
+}
+
+
+void PacketPool::Release(PacketBuffer *buf)
+{
+  if(buf->buf_pooled) {
+    pool_free.push_back(buf);
+  }
+  else {
+    delete buf;
+  }
+}
+
+
+void PacketPool::AddSlab()
+{
+  unsigned char *slab=new unsigned char[pool_chunk_size*pool_slab_chunks];
+  PacketBuffer *buf=NULL;
+
+  pool_slabs.push_back(slab);
+  for(unsigned i=0;i<pool_slab_chunks;i++) {
+    buf=new PacketBuffer(this,slab+i*pool_chunk_size,pool_chunk_size,true);
+    pool_chunks.push_back(buf);
+    pool_free.push_back(buf);
+  }
+}
@@ -0,0 +1,94 @@
+// packetpool.h
+//
+// Pooled, reference-counted buffers for encoded audio.
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef PACKETPOOL_H
+#define PACKETPOOL_H
+
+#include <vector>
+
+#define PACKETPOOL_CHUNK_SIZE 16384
+#define PACKETPOOL_SLAB_CHUNKS 64
+
+class PacketPool;
+
+//
+// A buffer is handed out with one reference.  Each additional holder
+// calls ref(), and every holder calls unref() when done with it; the last
+// unref() returns it to its pool.  Not thread-safe: buffers and pools
+// belong to the event loop thread.
+//
+class PacketBuffer
+{
+ public:
+  const unsigned char *data() const;
+  unsigned char *data();
+  int size() const;
+  void setSize(int bytes);
+  int capacity() const;
+  unsigned refCount() const;
+  void ref();
+  void unref();
+
+ private:
+  PacketBuffer(PacketPool *pool,unsigned char *data,int capacity,
+	       bool pooled);
+  ~PacketBuffer();
+  PacketPool *buf_pool;
+  unsigned char *buf_data;
+  int buf_size;
+  int buf_capacity;
+  unsigned buf_refs;
+  bool buf_pooled;
+  friend class PacketPool;
+};
+
+
+
+
+//
+// Hands out fixed-size chunks carved from slabs that are allocated as
+// needed and kept for reuse.  Requests larger than a chunk get a buffer
+// of their own from the heap.  The pool must outlive its buffers.
+//
+class PacketPool
+{
+ public:
+  PacketPool(int chunk_size=PACKETPOOL_CHUNK_SIZE,
+	     unsigned slab_chunks=PACKETPOOL_SLAB_CHUNKS);
+  ~PacketPool();
+  int chunkSize() const;
+  unsigned chunks() const;
+  unsigned freeChunks() const;
+  PacketBuffer *allocate(int bytes);
+  PacketBuffer *copy(const unsigned char *data,int len);
+
+ private:
+  void Release(PacketBuffer *buf);
+  void AddSlab();
+  int pool_chunk_size;
+  unsigned pool_slab_chunks;
+  std::vector<unsigned char *> pool_slabs;
+  std::vector<PacketBuffer *> pool_chunks;
+  std::vector<PacketBuffer *> pool_free;
+  friend class PacketBuffer;
+};
+
+
+#endif  // PACKETPOOL_H
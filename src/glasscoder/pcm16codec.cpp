@@ -18,10 +18,9 @@
 //   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
 
-#include <arpa/inet.h>
-
 #include <samplerate.h>
 
+#include "dspkernels.h"
 #include "pcm16codec.h"
 
 Pcm16Codec::Pcm16Codec(Ringbuffer *ring,QObject *parent)
@@ -62,16 +61,26 @@ QString Pcm16Codec::formatIdentifier() const
 
 bool Pcm16Codec::startCodec()
 {
+  packet()->reserve(2*PCM16_MAX_FRAMES*MAX_AUDIO_CHANNELS);
   return true;
 }
 
 
 void Pcm16Codec::encodeData(Connector *conn,const float *pcm,int frames)
 {
-  src_float_to_short_array(pcm,pcm16_buffer,frames*channels());
-  for(int i=0;i<(frames*(int)channels());i++) {
-    pcm16_buffer[i]=htons(pcm16_buffer[i]);
-  }
-  conn->writeData(frames,(const unsigned char *)pcm16_buffer,
-		  frames*channels()*2);
+  EncodedPacket *pkt=packet();
+  short *pcm16=NULL;
+
+  //
+  // Convert straight into the packet payload
+  //
+  pkt->reserve(frames*channels()*2);
+  pcm16=(short *)pkt->data();
+  src_float_to_short_array(pcm,pcm16,frames*channels());
+#if __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+  DspKernels::swap16((int16_t *)pcm16,frames*channels());
+#endif  // __BYTE_ORDER__==__ORDER_LITTLE_ENDIAN__
+  pkt->setSize(frames*channels()*2);
+  writePacket(conn,frames,EncodedPacket::FrameBoundary|
+	      EncodedPacket::Keyframe);
 }
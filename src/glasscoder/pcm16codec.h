@@ -39,9 +39,6 @@ class Pcm16Codec : public Codec
 
  protected:
   void encodeData(Connector *conn,const float *pcm,int frames);
-
- private:
-  short pcm16_buffer[PCM16_MAX_FRAMES*MAX_AUDIO_CHANNELS];
 };
 
 
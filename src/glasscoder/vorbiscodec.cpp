@@ -18,8 +18,11 @@
 //   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 //
 
+#include <string.h>
+
 #include <samplerate.h>
 
+#include "dspkernels.h"
 #include "logging.h"
 #include "vorbiscodec.h"
 
@@ -27,6 +30,7 @@ VorbisCodec::VorbisCodec(Ringbuffer *ring,QObject *parent)
   : Codec(Codec::TypeVorbis,ring,parent)
 {
   vorbis_prologue_sent=false;
+  vorbis_page_granulepos=0;
   vorbis_buffer=NULL;
 }
 
@@ -325,11 +329,48 @@ bool VorbisCodec::startCodec()
 void VorbisCodec::encodeData(Connector *conn,const float *pcm,int frames)
 {
 #ifdef HAVE_VORBIS
+  DspKernels::deinterleave(AnalysisBuffer(conn,frames),pcm,frames,channels());
+  Analyze(conn,frames);
+#endif  // HAVE_VORBIS
+}
+
+
+void VorbisCodec::encodePlanarData(Connector *conn,const float *const *pcm,
+				   int frames)
+{
+#ifdef HAVE_VORBIS
+  float **vorbis=AnalysisBuffer(conn,frames);
+
+  for(unsigned i=0;i<channels();i++) {
+    memcpy(vorbis[i],pcm[i],frames*sizeof(float));
+  }
+  Analyze(conn,frames);
+#endif  // HAVE_VORBIS
+}
+
+
+void VorbisCodec::flushEncoder(Connector *conn)
+{
+#ifdef HAVE_VORBIS
+  //
+  // Zero frames marks the end of the stream, which makes libvorbis give
+  // up its remaining blocks and libogg flush the final page.
+  //
+  Analyze(conn,0);
+#endif  // HAVE_VORBIS
+}
+
+
+#ifdef HAVE_VORBIS
+float **VorbisCodec::AnalysisBuffer(Connector *conn,int frames)
+{
   float **vorbis;
 
   if(!vorbis_prologue_sent) {
-    conn->writeData(0,(const unsigned char *)vorbis_stream_prologue.constData(),
-		    vorbis_stream_prologue.size());
+    packet()->
+      setData((const unsigned char *)vorbis_stream_prologue.constData(),
+	      vorbis_stream_prologue.size());
+    writePacket(conn,0,EncodedPacket::Header);
     vorbis_prologue_sent=true;
   }
 
@@ -337,11 +378,13 @@ void VorbisCodec::encodeData(Connector *conn,const float *pcm,int frames)
     Log(LOG_ERR,"unable to allocate stream buffer");
     exit(256);
   }
-  for(int i=0;i<frames;i++) {
-    for(unsigned j=0;j<channels();j++) {
-      vorbis[j][i]=pcm[channels()*i+j];
-    }
-  }
+
+  return vorbis;
+}
+
+
+void VorbisCodec::Analyze(Connector *conn,int frames)
+{
   vorbis_analysis_wrote(&vorbis_vorbis_dsp,frames);
   while(vorbis_analysis_blockout(&vorbis_vorbis_dsp,&vorbis_vorbis_block)>0) {
     vorbis_analysis(&vorbis_vorbis_block,&vorbis_ogg_packet);
@@ -349,11 +392,25 @@ void VorbisCodec::encodeData(Connector *conn,const float *pcm,int frames)
     while(vorbis_bitrate_flushpacket(&vorbis_vorbis_dsp,&vorbis_ogg_packet)) {
       ogg_stream_packetin(&vorbis_ogg_stream,&vorbis_ogg_packet);
       while(ogg_stream_pageout(&vorbis_ogg_stream,&vorbis_ogg_page)!=0) {
-	conn->
-	  writeData(frames,vorbis_ogg_page.header,vorbis_ogg_page.header_len);
-	conn->writeData(frames,vorbis_ogg_page.body,vorbis_ogg_page.body_len);
+	//
+	// Send each page whole, timed by the advance in its granule
+	// position.  A page on which no packet ends has none.
+	//
+	unsigned duration=0;
+	unsigned flags=EncodedPacket::FrameBoundary;
+	int64_t granulepos=ogg_page_granulepos(&vorbis_ogg_page);
+	if(granulepos>=0) {
+	  duration=granulepos-vorbis_page_granulepos;
+	  vorbis_page_granulepos=granulepos;
+	}
+	if(ogg_page_continued(&vorbis_ogg_page)==0) {
+	  flags|=EncodedPacket::Keyframe;
+	}
+	packet()->setData(vorbis_ogg_page.header,vorbis_ogg_page.header_len);
+	packet()->append(vorbis_ogg_page.body,vorbis_ogg_page.body_len);
+	writePacket(conn,duration,flags);
       }
     }
   }
-#endif  // HAVE_VORBIS
 }
+#endif  // HAVE_VORBIS
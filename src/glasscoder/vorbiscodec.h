@@ -44,6 +44,8 @@ class VorbisCodec : public Codec
 
  protected:
   void encodeData(Connector *conn,const float *pcm,int frames);
+  void encodePlanarData(Connector *conn,const float *const *pcm,int frames);
+  void flushEncoder(Connector *conn);
 
  private:
 #ifdef HAVE_VORBIS
@@ -175,8 +177,11 @@ class VorbisCodec : public Codec
   ogg_stream_state vorbis_ogg_stream;
   ogg_page vorbis_ogg_page;
   ogg_packet vorbis_ogg_packet;
+  float **AnalysisBuffer(Connector *conn,int frames);
+  void Analyze(Connector *conn,int frames);
 #endif  // HAVE_VORBIS
   unsigned long vorbis_input_samples;
+  int64_t vorbis_page_granulepos;
   unsigned long vorbis_buffer_size;
   unsigned char *vorbis_buffer;
   QByteArray vorbis_stream_prologue;
@@ -643,7 +643,7 @@ void MainWidget::ProcessFeedback(const QString &str)
   }
 
   if(f0[0]=="ME") {  // Meter Levels
-    if((f0.size()==2)&&(f0[1].length()==8)) {
+    if((f0.size()>=2)&&(f0[1].length()==8)) {
       level=f0[1].left(4).toInt(&ok,16);
       if(ok) {
 	gui_meter->setLeftPeakBar(-level);
@@ -0,0 +1,230 @@
+// dspkernels_bench.cpp
+//
+// Correctness check and microbenchmark for the DSP kernels
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//   Checks every kernel implementation available on this CPU against
+//   the scalar one, then reports the throughput of each.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "dspkernels_bench.h"
+
+#define FRAMES DSPKERNELS_BENCH_FRAMES
+
+//
+// Test data
+//
+int16_t s16_in[2*FRAMES];
+int32_t s32_in[2*FRAMES];
+float mono_in[FRAMES];
+float stereo_in[2*FRAMES];
+
+//
+// Results, indexed by kernel type
+//
+struct Results {
+  float s16[2*FRAMES];
+  float s32[2*FRAMES];
+  float m2s[2*FRAMES];
+  float s2m[FRAMES];
+  float peaks1[1];
+  float peaks2[2];
+  int16_t swapped[2*FRAMES];
+  float left[FRAMES];
+  float right[FRAMES];
+} results[DspKernels::LastType];
+
+
+void MakeTestData()
+{
+  uint32_t seed=1;
+
+  for(unsigned i=0;i<2*FRAMES;i++) {
+    seed=seed*1103515245+12345;
+    s32_in[i]=(int32_t)seed;
+    s16_in[i]=(int16_t)(seed>>16);
+    stereo_in[i]=(float)s16_in[i]/65536.0f;  // Peaks below -6 dBFS
+  }
+  for(unsigned i=0;i<FRAMES;i++) {
+    mono_in[i]=stereo_in[2*i];
+  }
+
+  //
+  // Make the peaks negative, and put one near the end
+  //
+  stereo_in[2*(FRAMES-2)]=-1.0f;
+  stereo_in[2*(FRAMES-7)+1]=-0.999f;
+  mono_in[FRAMES-3]=-1.0f;
+}
+
+
+void RunKernels(Results *r)
+{
+  float *chans[2]={r->left,r->right};
+
+  DspKernels::s16ToFloat(r->s16,s16_in,2*FRAMES);
+  DspKernels::s32ToFloat(r->s32,s32_in,2*FRAMES);
+  DspKernels::monoToStereo(r->m2s,mono_in,FRAMES);
+  DspKernels::stereoToMono(r->s2m,stereo_in,FRAMES);
+  DspKernels::absPeaks(r->peaks1,mono_in,FRAMES,1);
+  DspKernels::absPeaks(r->peaks2,stereo_in,FRAMES,2);
+  memcpy(r->swapped,s16_in,sizeof(s16_in));
+  DspKernels::swap16(r->swapped,2*FRAMES);
+  DspKernels::deinterleave(chans,stereo_in,FRAMES,2);
+}
+
+
+double Now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec+(double)ts.tv_nsec/1000000000.0;
+}
+
+
+void Bench(const char *name,unsigned iterations,unsigned samples,
+	   void (*func)(Results *),Results *r)
+{
+  double start=Now();
+  double secs;
+
+  for(unsigned i=0;i<iterations;i++) {
+    func(r);
+  }
+  secs=Now()-start;
+  printf("  %-14s %9.1f Msamples/sec\n",name,
+	 (double)iterations*(double)samples/(secs*1000000.0));
+}
+
+
+void BenchS16(Results *r)
+{
+  DspKernels::s16ToFloat(r->s16,s16_in,2*FRAMES);
+}
+
+
+void BenchS32(Results *r)
+{
+  DspKernels::s32ToFloat(r->s32,s32_in,2*FRAMES);
+}
+
+
+void BenchMonoToStereo(Results *r)
+{
+  DspKernels::monoToStereo(r->m2s,mono_in,FRAMES);
+}
+
+
+void BenchStereoToMono(Results *r)
+{
+  DspKernels::stereoToMono(r->s2m,stereo_in,FRAMES);
+}
+
+
+void BenchAbsPeaks(Results *r)
+{
+  DspKernels::absPeaks(r->peaks2,stereo_in,FRAMES,2);
+}
+
+
+void BenchSwap16(Results *r)
+{
+  DspKernels::swap16(r->swapped,2*FRAMES);
+}
+
+
+void BenchDeinterleave(Results *r)
+{
+  float *chans[2]={r->left,r->right};
+
+  DspKernels::deinterleave(chans,stereo_in,FRAMES,2);
+}
+
+
+int main(int argc,char *argv[])
+{
+  unsigned iterations=DSPKERNELS_BENCH_DEFAULT_ITERATIONS;
+  bool ok=true;
+
+  if(argc>2) {
+    fprintf(stderr,"dspkernels_bench %s",DSPKERNELS_BENCH_USAGE);
+    exit(1);
+  }
+  if(argc==2) {
+    if((iterations=strtoul(argv[1],NULL,10))==0) {
+      fprintf(stderr,"dspkernels_bench: invalid iteration count\n");
+      exit(1);
+    }
+  }
+  MakeTestData();
+  printf("default kernels: %s\n",
+	 DspKernels::typeText(DspKernels::type()));
+
+  //
+  // Scalar reference
+  //
+  DspKernels::setType(DspKernels::Scalar);
+  RunKernels(&results[DspKernels::Scalar]);
+  if((results[DspKernels::Scalar].peaks1[0]!=1.0f)||
+     (results[DspKernels::Scalar].peaks2[0]!=1.0f)||
+     (results[DspKernels::Scalar].peaks2[1]!=0.999f)) {
+    printf("scalar: incorrect peak levels\n");
+    ok=false;
+  }
+
+  for(int i=0;i<DspKernels::LastType;i++) {
+    DspKernels::Type type=(DspKernels::Type)i;
+    if(!DspKernels::setType(type)) {
+      continue;
+    }
+
+    //
+    // Check
+    //
+    if(type!=DspKernels::Scalar) {
+      RunKernels(&results[type]);
+      if(memcmp(&results[type],&results[DspKernels::Scalar],
+		sizeof(Results))!=0) {
+	printf("%s: results differ from scalar kernels\n",
+	       DspKernels::typeText(type));
+	ok=false;
+      }
+    }
+
+    //
+    // Time
+    //
+    printf("%s:\n",DspKernels::typeText(type));
+    Bench("s16ToFloat",iterations,2*FRAMES,BenchS16,&results[type]);
+    Bench("s32ToFloat",iterations,2*FRAMES,BenchS32,&results[type]);
+    Bench("monoToStereo",iterations,FRAMES,BenchMonoToStereo,&results[type]);
+    Bench("stereoToMono",iterations,2*FRAMES,BenchStereoToMono,
+	  &results[type]);
+    Bench("absPeaks",iterations,2*FRAMES,BenchAbsPeaks,&results[type]);
+    Bench("swap16",iterations,2*FRAMES,BenchSwap16,&results[type]);
+    Bench("deinterleave",iterations,2*FRAMES,BenchDeinterleave,
+	  &results[type]);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+// dspkernels_bench.h
+//
+// Correctness check and microbenchmark for the DSP kernels
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef DSPKERNELS_BENCH_H
+#define DSPKERNELS_BENCH_H
+
+#include "dspkernels.h"
+
+#define DSPKERNELS_BENCH_USAGE "[<iterations>]\n"
+#define DSPKERNELS_BENCH_DEFAULT_ITERATIONS 20000
+
+//
+// An odd frame count, so that the scalar tail of each kernel gets
+// exercised too.
+//
+#define DSPKERNELS_BENCH_FRAMES 1031
+
+
+#endif  // DSPKERNELS_BENCH_H
@@ -0,0 +1,650 @@
+// ringbuffer_stress.cpp
+//
+// Multi-threaded stress test for the lock-free ringbuffer
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//   Hammers a single-producer/single-consumer ringbuffer from two
+//   threads with odd-sized, wrapping transfers, verifying that every
+//   byte arrives intact and in order.  A planar BroadcastRingbuffer is
+//   then run through the same paces, mixing interleaved and planar
+//   transfers.  Finally, a BroadcastRingbuffer is fed to one fast and
+//   one deliberately stalled reader, checking that the fast reader
+//   loses nothing and that the slow one accounts for exactly what it
+//   missed, and that readers in lockstep resume together.  Build the
+//   'ringbuffer_stress_tsan' target to run the same tests under
+//   ThreadSanitizer.
+//
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ringbuffer_stress.h"
+
+//
+// Expected value of the n'th byte in the stream
+//
+static inline char StreamByte(uint64_t n)
+{
+  return (char)(0xFF&(n^(n>>8)^(n>>16)));
+}
+
+
+//
+// Cheap per-thread PRNG, for transfer sizes
+//
+static inline unsigned NextChunk(uint32_t *seed)
+{
+  *seed=*seed*1103515245+12345;
+  return 1+((*seed>>8)%RINGBUFFER_STRESS_MAX_CHUNK);
+}
+
+
+void *ByteProducer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  char data[RINGBUFFER_STRESS_MAX_CHUNK];
+  glass_ringbuffer_data_t vec[2];
+  uint64_t pos=0;
+  uint32_t seed=1;
+  unsigned chunk;
+  size_t n;
+
+  while(pos<cxt->total) {
+    chunk=NextChunk(&seed);
+    if(chunk>(cxt->total-pos)) {
+      chunk=cxt->total-pos;
+    }
+    if((chunk%2)==0) {
+      //
+      // Copying writer
+      //
+      for(unsigned i=0;i<chunk;i++) {
+	data[i]=StreamByte(pos+i);
+      }
+      n=0;
+      while(n<chunk) {
+	if((n+=glass_ringbuffer_write(cxt->rb,data+n,chunk-n))<chunk) {
+	  sched_yield();
+	}
+      }
+    }
+    else {
+      //
+      // Zero-copy writer
+      //
+      glass_ringbuffer_get_write_vector(cxt->rb,vec);
+      n=0;
+      for(unsigned i=0;i<2;i++) {
+	for(size_t j=0;(j<vec[i].len)&&(n<chunk);j++) {
+	  vec[i].buf[j]=StreamByte(pos+n++);
+	}
+      }
+      glass_ringbuffer_write_advance(cxt->rb,n);
+      if(n==0) {
+	sched_yield();
+      }
+      chunk=n;
+    }
+    pos+=chunk;
+  }
+
+  return NULL;
+}
+
+
+void *ByteConsumer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  char data[RINGBUFFER_STRESS_MAX_CHUNK];
+  glass_ringbuffer_data_t vec[2];
+  uint64_t pos=0;
+  uint32_t seed=2;
+  unsigned chunk;
+  size_t n;
+
+  while(pos<cxt->total) {
+    chunk=NextChunk(&seed);
+    if((chunk%2)==0) {
+      //
+      // Copying reader
+      //
+      n=glass_ringbuffer_read(cxt->rb,data,chunk);
+      for(size_t i=0;i<n;i++) {
+	if(data[i]!=StreamByte(pos+i)) {
+	  cxt->errors++;
+	}
+      }
+    }
+    else {
+      //
+      // Zero-copy reader
+      //
+      glass_ringbuffer_get_read_vector(cxt->rb,vec);
+      n=0;
+      for(unsigned i=0;i<2;i++) {
+	for(size_t j=0;(j<vec[i].len)&&(n<chunk);j++) {
+	  if(vec[i].buf[j]!=StreamByte(pos+n++)) {
+	    cxt->errors++;
+	  }
+	}
+      }
+      glass_ringbuffer_read_advance(cxt->rb,n);
+    }
+    if(n==0) {
+      sched_yield();
+    }
+    pos+=n;
+  }
+
+  return NULL;
+}
+
+
+void *FrameProducer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  float pcm[RINGBUFFER_STRESS_CHANNELS*RINGBUFFER_STRESS_MAX_CHUNK];
+  uint64_t pos=0;
+  uint32_t seed=3;
+  unsigned chunk;
+  unsigned n;
+
+  while(pos<cxt->total) {
+    chunk=NextChunk(&seed);
+    if(chunk>(cxt->total-pos)) {
+      chunk=cxt->total-pos;
+    }
+    for(unsigned i=0;i<chunk;i++) {
+      for(unsigned j=0;j<RINGBUFFER_STRESS_CHANNELS;j++) {
+	pcm[RINGBUFFER_STRESS_CHANNELS*i+j]=(float)((pos+i)%16777216);
+      }
+    }
+    n=0;
+    while(n<chunk) {
+      if((n+=cxt->ring->write(pcm+RINGBUFFER_STRESS_CHANNELS*n,chunk-n))<
+	 chunk) {
+	sched_yield();
+      }
+    }
+    pos+=chunk;
+  }
+  cxt->ring->wake();
+
+  return NULL;
+}
+
+
+void *FrameConsumer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  float buffer[RINGBUFFER_STRESS_CHANNELS*RINGBUFFER_STRESS_MAX_CHUNK];
+  const float *pcm;
+  uint64_t pos=0;
+  unsigned pass=0;
+  unsigned n;
+
+  //
+  // Alternate between the copying and the zero-copy read paths
+  //
+  while(pos<cxt->total) {
+    cxt->ring->waitForData(10);
+    while(true) {
+      if((pass++%2)==0) {
+	pcm=buffer;
+	n=cxt->ring->read(buffer,RINGBUFFER_STRESS_MAX_CHUNK);
+      }
+      else {
+	pcm=cxt->ring->readSpan(&n);
+      }
+      if(n==0) {
+	break;
+      }
+      for(unsigned i=0;i<n;i++) {
+	for(unsigned j=0;j<RINGBUFFER_STRESS_CHANNELS;j++) {
+	  if(pcm[RINGBUFFER_STRESS_CHANNELS*i+j]!=
+	     (float)((pos+i)%16777216)) {
+	    cxt->errors++;
+	  }
+	}
+      }
+      if(pcm!=buffer) {
+	cxt->ring->readAdvance(n);
+      }
+      pos+=n;
+    }
+  }
+
+  return NULL;
+}
+
+
+//
+// Expected value of channel 'chan' in the n'th frame of a planar stream
+//
+static inline float PlanarSample(uint64_t n,unsigned chan)
+{
+  return (float)((n%16777216))*(chan==0 ? 1.0 : -1.0);
+}
+
+
+void *PlanarProducer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  float pcm[RINGBUFFER_STRESS_CHANNELS*RINGBUFFER_STRESS_MAX_CHUNK];
+  float *planes[RINGBUFFER_STRESS_CHANNELS];
+  uint64_t pos=0;
+  uint32_t seed=4;
+  unsigned chunk;
+
+  for(unsigned i=0;i<RINGBUFFER_STRESS_CHANNELS;i++) {
+    planes[i]=pcm+i*RINGBUFFER_STRESS_MAX_CHUNK;
+  }
+  while(pos<cxt->total) {
+    chunk=NextChunk(&seed);
+    if(chunk>(cxt->total-pos)) {
+      chunk=cxt->total-pos;
+    }
+    //
+    // The broadcast writer never blocks, so pace it against the reader
+    //
+    while(cxt->bcast->writeSpace()<chunk) {
+      sched_yield();
+    }
+    if((chunk%2)==0) {
+      for(unsigned i=0;i<chunk;i++) {
+	for(unsigned j=0;j<RINGBUFFER_STRESS_CHANNELS;j++) {
+	  pcm[RINGBUFFER_STRESS_CHANNELS*i+j]=PlanarSample(pos+i,j);
+	}
+      }
+      cxt->bcast->write(pcm,chunk);
+    }
+    else {
+      for(unsigned i=0;i<RINGBUFFER_STRESS_CHANNELS;i++) {
+	for(unsigned j=0;j<chunk;j++) {
+	  planes[i][j]=PlanarSample(pos+j,i);
+	}
+      }
+      cxt->bcast->writePlanar(planes,chunk);
+    }
+    pos+=chunk;
+  }
+  cxt->ring->wake();
+
+  return NULL;
+}
+
+
+void *PlanarConsumer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  float buffer[RINGBUFFER_STRESS_CHANNELS*RINGBUFFER_STRESS_MAX_CHUNK];
+  float *planes[RINGBUFFER_STRESS_CHANNELS];
+  const float *spans[RINGBUFFER_STRESS_CHANNELS];
+  uint64_t pos=0;
+  unsigned pass=0;
+  unsigned n;
+
+  for(unsigned i=0;i<RINGBUFFER_STRESS_CHANNELS;i++) {
+    planes[i]=buffer+i*RINGBUFFER_STRESS_MAX_CHUNK;
+  }
+
+  //
+  // Rotate between interleaved copies, planar copies and planar spans
+  //
+  while(pos<cxt->total) {
+    cxt->ring->waitForData(10);
+    while(true) {
+      switch(pass++%3) {
+      case 0:
+	n=cxt->ring->read(buffer,RINGBUFFER_STRESS_MAX_CHUNK);
+	for(unsigned i=0;i<n;i++) {
+	  for(unsigned j=0;j<RINGBUFFER_STRESS_CHANNELS;j++) {
+	    if(buffer[RINGBUFFER_STRESS_CHANNELS*i+j]!=PlanarSample(pos+i,j)) {
+	      cxt->errors++;
+	    }
+	  }
+	}
+	break;
+
+      case 1:
+	n=cxt->ring->readPlanar(planes,RINGBUFFER_STRESS_MAX_CHUNK);
+	for(unsigned i=0;i<RINGBUFFER_STRESS_CHANNELS;i++) {
+	  for(unsigned j=0;j<n;j++) {
+	    if(planes[i][j]!=PlanarSample(pos+j,i)) {
+	      cxt->errors++;
+	    }
+	  }
+	}
+	break;
+
+      default:
+	cxt->ring->readPlanarSpan(spans,&n);
+	for(unsigned i=0;(n>0)&&(i<RINGBUFFER_STRESS_CHANNELS);i++) {
+	  for(unsigned j=0;j<n;j++) {
+	    if(spans[i][j]!=PlanarSample(pos+j,i)) {
+	      cxt->errors++;
+	    }
+	  }
+	}
+	if(n>0) {
+	  cxt->ring->readAdvance(n);
+	}
+	break;
+      }
+      if(n==0) {
+	break;
+      }
+      pos+=n;
+    }
+  }
+
+  return NULL;
+}
+
+
+void *OverrunProducer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  float pcm[RINGBUFFER_STRESS_CHANNELS*RINGBUFFER_STRESS_MAX_CHUNK];
+  uint64_t pos=0;
+  uint32_t seed=5;
+  unsigned chunk;
+
+  while(pos<cxt->total) {
+    chunk=NextChunk(&seed);
+    if(chunk>(cxt->total-pos)) {
+      chunk=cxt->total-pos;
+    }
+    if((pos<cxt->stall)&&(chunk>(cxt->stall-pos))) {
+      chunk=cxt->stall-pos;
+    }
+    for(unsigned i=0;i<chunk;i++) {
+      for(unsigned j=0;j<RINGBUFFER_STRESS_CHANNELS;j++) {
+	pcm[RINGBUFFER_STRESS_CHANNELS*i+j]=(float)((pos+i)%16777216);
+      }
+    }
+    //
+    // Pace against both readers until the slow one has reached its
+    // stall point, then only against the fast one, so that the slow one
+    // gets lapped
+    //
+    if(pos<cxt->stall) {
+      while(cxt->bcast->writeSpace()<chunk) {
+	sched_yield();
+      }
+    }
+    else {
+      while((pos==cxt->stall)&&(cxt->slow->readSpace()>0)) {
+	sched_yield();
+      }
+      while((cxt->bcast->size()-cxt->ring->readSpace())<chunk) {
+	sched_yield();
+      }
+    }
+    cxt->bcast->write(pcm,chunk);
+    pos+=chunk;
+  }
+  cxt->ring->wake();
+  cxt->slow->wake();
+
+  return NULL;
+}
+
+
+void *StalledConsumer(void *ptr)
+{
+  StressContext *cxt=(StressContext *)ptr;
+  float buffer[RINGBUFFER_STRESS_CHANNELS*RINGBUFFER_STRESS_MAX_CHUNK];
+  uint64_t pos=0;
+  uint64_t dropped;
+  unsigned chunk;
+  unsigned n;
+
+  while(pos<cxt->total) {
+    //
+    // Stop dead at the stall point until the writer has finished
+    //
+    if(pos==cxt->stall) {
+      while(cxt->bcast->framesWritten()<cxt->total) {
+	sched_yield();
+      }
+    }
+    chunk=RINGBUFFER_STRESS_MAX_CHUNK;
+    if((pos<cxt->stall)&&(chunk>(cxt->stall-pos))) {
+      chunk=cxt->stall-pos;
+    }
+    dropped=cxt->slow->framesDropped();
+    n=cxt->slow->read(buffer,chunk);
+
+    //
+    // Whatever we were lapped by is skipped before the copy is made
+    //
+    pos+=cxt->slow->framesDropped()-dropped;
+    for(unsigned i=0;i<n;i++) {
+      for(unsigned j=0;j<RINGBUFFER_STRESS_CHANNELS;j++) {
+	if(buffer[RINGBUFFER_STRESS_CHANNELS*i+j]!=
+	   (float)((pos+i)%16777216)) {
+	  cxt->slow_errors++;
+	}
+      }
+    }
+    if(n==0) {
+      cxt->slow->waitForData(10);
+    }
+    pos+=n;
+    cxt->slow_received+=n;
+  }
+
+  return NULL;
+}
+
+
+bool RunOverrunTest(const char *name,StressContext *cxt)
+{
+  pthread_t threads[3];
+  uint64_t lost=cxt->total-cxt->stall;
+
+  if((pthread_create(threads,NULL,OverrunProducer,cxt)!=0)||
+     (pthread_create(threads+1,NULL,FrameConsumer,cxt)!=0)||
+     (pthread_create(threads+2,NULL,StalledConsumer,cxt)!=0)) {
+    fprintf(stderr,"ringbuffer_stress: unable to start threads\n");
+    exit(1);
+  }
+  for(unsigned i=0;i<3;i++) {
+    pthread_join(threads[i],NULL);
+  }
+
+  //
+  // The slow reader sees the first 'stall' frames, then resyncs to the
+  // end of the stream in a single overrun
+  //
+  if(cxt->slow_received!=cxt->stall) {
+    fprintf(stderr,"%s: slow reader received %lu frames, expected %lu\n",
+	    name,(unsigned long)cxt->slow_received,
+	    (unsigned long)cxt->stall);
+    cxt->slow_errors++;
+  }
+  if(cxt->slow->framesDropped()!=lost) {
+    fprintf(stderr,"%s: slow reader dropped %lu frames, expected %lu\n",
+	    name,(unsigned long)cxt->slow->framesDropped(),
+	    (unsigned long)lost);
+    cxt->slow_errors++;
+  }
+  if(cxt->slow->overruns()!=1) {
+    fprintf(stderr,"%s: slow reader reported %lu overruns, expected 1\n",
+	    name,(unsigned long)cxt->slow->overruns());
+    cxt->slow_errors++;
+  }
+  if(cxt->ring->framesDropped()!=0) {
+    fprintf(stderr,"%s: fast reader dropped %lu frames\n",
+	    name,(unsigned long)cxt->ring->framesDropped());
+    cxt->errors++;
+  }
+  printf("%s: %lu errors\n",name,
+	 (unsigned long)(cxt->errors+cxt->slow_errors));
+
+  return (cxt->errors+cxt->slow_errors)==0;
+}
+
+
+bool RunLockstepTest(const char *name)
+{
+  //
+  // Single threaded: one reader in a lockstep pair gets lapped, and both
+  // must then resume from the same frame
+  //
+  BroadcastRingbuffer *bcast=
+    new BroadcastRingbuffer(RINGBUFFER_STRESS_RING_SIZE*sizeof(float),1);
+  Ringbuffer *ahead=bcast->addReader(true);
+  Ringbuffer *behind=bcast->addReader(true);
+  float pcm[RINGBUFFER_STRESS_RING_SIZE];
+  float first[2];
+  uint64_t pos=0;
+  uint64_t errors=0;
+
+  for(unsigned i=0;i<4;i++) {
+    for(unsigned j=0;j<RINGBUFFER_STRESS_RING_SIZE/2;j++) {
+      pcm[j]=(float)(pos++);
+    }
+    bcast->write(pcm,RINGBUFFER_STRESS_RING_SIZE/2);
+    ahead->dump(ahead->readSpace());
+  }
+  for(unsigned j=0;j<RINGBUFFER_STRESS_RING_SIZE/2;j++) {
+    pcm[j]=(float)(pos++);
+  }
+  bcast->write(pcm,RINGBUFFER_STRESS_RING_SIZE/2);
+
+  //
+  // 'behind' has now been lapped; 'ahead' has only the last write pending
+  //
+  if(behind->read(first+1,1)!=0) {
+    errors++;  // The first call resyncs
+  }
+  for(unsigned j=0;j<RINGBUFFER_STRESS_RING_SIZE/4;j++) {
+    pcm[j]=(float)(pos++);
+  }
+  bcast->write(pcm,RINGBUFFER_STRESS_RING_SIZE/4);
+  if((ahead->read(first,1)!=1)||(behind->read(first+1,1)!=1)||
+     (first[0]!=first[1])||
+     (first[0]!=(float)(pos-RINGBUFFER_STRESS_RING_SIZE/4))) {
+    errors++;
+  }
+  if((ahead->overruns()!=1)||(behind->overruns()!=1)||
+     (ahead->framesDropped()!=RINGBUFFER_STRESS_RING_SIZE/2)||
+     (behind->framesDropped()!=(pos-RINGBUFFER_STRESS_RING_SIZE/4))) {
+    errors++;
+  }
+  delete bcast;
+  printf("%s: %lu errors\n",name,(unsigned long)errors);
+
+  return errors==0;
+}
+
+
+bool RunTest(const char *name,StressContext *cxt,
+	     void *(*producer)(void *),void *(*consumer)(void *))
+{
+  pthread_t threads[2];
+
+  if((pthread_create(threads,NULL,producer,cxt)!=0)||
+     (pthread_create(threads+1,NULL,consumer,cxt)!=0)) {
+    fprintf(stderr,"ringbuffer_stress: unable to start threads\n");
+    exit(1);
+  }
+  pthread_join(threads[0],NULL);
+  pthread_join(threads[1],NULL);
+  printf("%s: %lu errors\n",name,(unsigned long)cxt->errors);
+
+  return cxt->errors==0;
+}
+
+
+int main(int argc,char *argv[])
+{
+  StressContext cxt;
+  uint64_t mbytes=RINGBUFFER_STRESS_DEFAULT_MEGABYTES;
+  bool ok=true;
+
+  if(argc>2) {
+    fprintf(stderr,"ringbuffer_stress %s",RINGBUFFER_STRESS_USAGE);
+    exit(1);
+  }
+  if(argc==2) {
+    if((mbytes=strtoul(argv[1],NULL,10))==0) {
+      fprintf(stderr,"ringbuffer_stress: invalid size\n");
+      exit(1);
+    }
+  }
+
+  //
+  // Raw byte stream, copying and zero-copy paths
+  //
+  memset(&cxt,0,sizeof(cxt));
+  cxt.rb=glass_ringbuffer_create(RINGBUFFER_STRESS_RING_SIZE);
+  cxt.total=mbytes*1048576;
+  ok=RunTest("glass_ringbuffer_t",&cxt,ByteProducer,ByteConsumer)&&ok;
+  glass_ringbuffer_free(cxt.rb);
+
+  //
+  // PCM frames, with eventfd wakeups
+  //
+  memset(&cxt,0,sizeof(cxt));
+  cxt.ring=new Ringbuffer(RINGBUFFER_STRESS_RING_SIZE*
+			  RINGBUFFER_STRESS_CHANNELS*sizeof(float),
+			  RINGBUFFER_STRESS_CHANNELS);
+  cxt.ring->setWakeThreshold(RINGBUFFER_STRESS_WAKE_FRAMES);
+  cxt.total=mbytes*1048576/(RINGBUFFER_STRESS_CHANNELS*sizeof(float));
+  ok=RunTest("Ringbuffer",&cxt,FrameProducer,FrameConsumer)&&ok;
+  delete cxt.ring;
+
+  //
+  // Planar PCM frames, written and read in both layouts
+  //
+  memset(&cxt,0,sizeof(cxt));
+  cxt.bcast=new BroadcastRingbuffer(RINGBUFFER_STRESS_RING_SIZE*
+				    RINGBUFFER_STRESS_CHANNELS*sizeof(float),
+				    RINGBUFFER_STRESS_CHANNELS);
+  cxt.bcast->setLayout(Ringbuffer::Planar);
+  cxt.ring=cxt.bcast->addReader();
+  cxt.ring->setWakeThreshold(RINGBUFFER_STRESS_WAKE_FRAMES);
+  cxt.total=mbytes*1048576/(RINGBUFFER_STRESS_CHANNELS*sizeof(float));
+  ok=RunTest("BroadcastRingbuffer",&cxt,PlanarProducer,PlanarConsumer)&&ok;
+  delete cxt.bcast;
+
+  //
+  // One fast and one stalled reader on the same broadcast buffer
+  //
+  memset(&cxt,0,sizeof(cxt));
+  cxt.bcast=new BroadcastRingbuffer(RINGBUFFER_STRESS_RING_SIZE*
+				    RINGBUFFER_STRESS_CHANNELS*sizeof(float),
+				    RINGBUFFER_STRESS_CHANNELS);
+  cxt.ring=cxt.bcast->addReader();
+  cxt.ring->setWakeThreshold(RINGBUFFER_STRESS_WAKE_FRAMES);
+  cxt.slow=cxt.bcast->addReader();
+  cxt.slow->setWakeThreshold(RINGBUFFER_STRESS_WAKE_FRAMES);
+  cxt.total=mbytes*1048576/(RINGBUFFER_STRESS_CHANNELS*sizeof(float));
+  cxt.stall=cxt.total/4;
+  ok=RunOverrunTest("BroadcastRingbuffer overrun",&cxt)&&ok;
+  delete cxt.bcast;
+
+  ok=RunLockstepTest("BroadcastRingbuffer lockstep")&&ok;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+// ringbuffer_stress.h
+//
+// Multi-threaded stress test for the lock-free ringbuffer
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#ifndef RINGBUFFER_STRESS_H
+#define RINGBUFFER_STRESS_H
+
+#include <stdint.h>
+
+#include "ringbuffer.h"
+
+#define RINGBUFFER_STRESS_USAGE "[<megabytes>]\n"
+#define RINGBUFFER_STRESS_DEFAULT_MEGABYTES 256
+#define RINGBUFFER_STRESS_RING_SIZE 4096
+#define RINGBUFFER_STRESS_MAX_CHUNK 1531
+#define RINGBUFFER_STRESS_CHANNELS 2
+#define RINGBUFFER_STRESS_WAKE_FRAMES 64
+
+//
+// Shared state for one producer/consumer pair
+//
+struct StressContext {
+  glass_ringbuffer_t *rb;
+  Ringbuffer *ring;
+  BroadcastRingbuffer *bcast;
+  uint64_t total;
+  uint64_t errors;
+  Ringbuffer *slow;
+  uint64_t stall;
+  uint64_t slow_received;
+  uint64_t slow_errors;
+};
+
+
+#endif  // RINGBUFFER_STRESS_H
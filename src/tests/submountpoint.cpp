@@ -0,0 +1,64 @@
+// submountpoint.cpp
+//
+// Test rendition mountpoint naming
+//
+//   (C) Copyright 2026 Fred Gleason <fredg@paravelsystems.com>
+//
+//   This program is free software; you can redistribute it and/or modify
+//   it under the terms of the GNU General Public License version 2 as
+//   published by the Free Software Foundation.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//   GNU General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public
+//   License along with this program; if not, write to the Free Software
+//   Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QCoreApplication>
+
+#include "submountpoint.h"
+
+MainObject::MainObject(QObject *parent)
+{
+  const char *cases[][3]={{"/stream","32","/stream.32"},
+			  {"/stream.mp3","32","/stream.32.mp3"},
+			  {"/live/stream.aac","128","/live/stream.128.aac"},
+			  {"/hls/stream.m3u8","64","/hls/stream.64.m3u8"},
+			  {"/v1.2/stream","32","/v1.2/stream.32"},
+			  {"/live/.stream","32","/live/.stream.32"},
+			  {NULL,NULL,NULL}};
+  int ret=0;
+
+  for(int i=0;cases[i][0]!=NULL;i++) {
+    QString result=
+      Connector::subMountpointName(cases[i][0],QString(cases[i][1]).toUInt());
+    printf("%s @ %s => %s",cases[i][0],cases[i][1],
+	   (const char *)result.toUtf8());
+    if(result==cases[i][2]) {
+      printf("  OK\n");
+    }
+    else {
+      printf("  FAILED (expected %s)\n",cases[i][2]);
+      ret=1;
+    }
+  }
+
+  exit(ret);
+}
+
+
+int main(int argc,char *argv[])
+{
+  QCoreApplication a(argc,argv);
+
+  new MainObject();
+
+  return a.exec();
+}